@@ -0,0 +1,271 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector3.h"
+#include <vector>
+
+namespace mars
+{
+	//Interpolation between two keyframes.
+	enum class AnimationInterpolation : uint8_t
+	{
+		Step,
+		Linear,
+		Cubic	//Cubic Hermite using the per-key in/out tangents (glTF CUBICSPLINE). Tangents are in units of value per unit time.
+	};
+
+	//Animated property of a target (bone/node).
+	enum class AnimationChannel : uint8_t
+	{
+		Translation,
+		Rotation,
+		Scale
+	};
+
+	//All tracks of one channel of a clip, with the keys of every track concatenated in SoA arrays.
+	//Track n owns keys [keyOffsets[n], keyOffsets[n + 1]).
+	template<typename T, size_t Components>
+	struct AnimationTrackSet
+	{
+		std::vector<uint32_t> targets;
+		std::vector<AnimationInterpolation> interpolations;
+		std::vector<uint32_t> keyOffsets = { 0 };
+		std::vector<T> times;
+		std::vector<T> values[Components];
+		std::vector<T> inTangents[Components];
+		std::vector<T> outTangents[Components];
+
+		inline size_t GetTrackCount() const { return targets.size(); }
+	};
+
+	//Sampled local transforms, indexed by target.
+	template<typename T>
+	struct AnimationPose
+	{
+		std::vector<Vector3<T>> translations;
+		std::vector<Quaternion> rotations;
+		std::vector<Vector3<T>> scales;
+
+		//Resizes the pose to targetCount targets with an identity transform.
+		void Reset(size_t targetCount)
+		{
+			translations.assign(targetCount, Vector3<T>(0, 0, 0));
+			rotations.assign(targetCount, Quaternion(1, 0, 0, 0));
+			scales.assign(targetCount, Vector3<T>(1, 1, 1));
+		}
+	};
+
+	//Per-instance playback state of a clip. Caches the last key of every track, so sequential playback finds keys in O(1).
+	//Also holds the scratch arrays of the batched evaluation, so sampling does not allocate after the first call.
+	template<typename T>
+	struct AnimationCursor
+	{
+		std::vector<uint32_t> keys[3];
+
+		std::vector<uint32_t> index0, index1;
+		std::vector<T> w0, w1, wt0, wt1;
+		std::vector<T> results[4];
+	};
+
+	//Keyframe animation clip of Vector3 translation/scale tracks and Quaternion rotation tracks, with a batched sampler.
+	template<typename T>
+	class AnimationClip
+	{
+		static_assert(std::is_floating_point_v<T>, "AnimationClip requires a floating point type.");
+
+	public:
+		AnimationTrackSet<T, 3> translations;
+		AnimationTrackSet<T, 4> rotations;	//Components are (s, i, j, k).
+		AnimationTrackSet<T, 3> scales;
+		T duration = 0;
+
+		//Adds a translation or scale track. times must be increasing. inTangents and outTangents are only used for Cubic, and must then match times in size.
+		void AddTrack(AnimationChannel channel, uint32_t target, AnimationInterpolation interpolation, std::span<const T> times, std::span<const Vector3<T>> values,
+			std::span<const Vector3<T>> inTangents = {}, std::span<const Vector3<T>> outTangents = {})
+		{
+			AnimationTrackSet<T, 3>& set = channel == AnimationChannel::Scale ? scales : translations;
+			AddTrack(set, target, interpolation, times, values.size(), [&](size_t key, size_t comp) { return values[key].GetData()[comp]; },
+				[&](size_t key, size_t comp) { return key < inTangents.size() ? inTangents[key].GetData()[comp] : T(0); },
+				[&](size_t key, size_t comp) { return key < outTangents.size() ? outTangents[key].GetData()[comp] : T(0); });
+		}
+		//Adds a rotation track. times must be increasing. inTangents and outTangents are only used for Cubic, and must then match times in size.
+		void AddTrack(uint32_t target, AnimationInterpolation interpolation, std::span<const T> times, std::span<const Quaternion> values,
+			std::span<const Quaternion> inTangents = {}, std::span<const Quaternion> outTangents = {})
+		{
+			AddTrack(rotations, target, interpolation, times, values.size(), [&](size_t key, size_t comp) { return static_cast<T>(values[key].GetData()[comp]); },
+				[&](size_t key, size_t comp) { return key < inTangents.size() ? static_cast<T>(inTangents[key].GetData()[comp]) : T(0); },
+				[&](size_t key, size_t comp) { return key < outTangents.size() ? static_cast<T>(outTangents[key].GetData()[comp]) : T(0); });
+		}
+
+		//Samples every track of the clip at time into outPose, which must already be sized for every target (see AnimationPose::Reset).
+		//Targets without a track keep their current value. Time is clamped to the keys of each track.
+		//Rotations are blended component-wise along the shortest arc and normalised (nlerp), which matches Slerp closely for dense keys.
+		void SampleClip(T time, AnimationCursor<T>& cursor, AnimationPose<T>& outPose) const
+		{
+			SampleTrackSet(translations, time, cursor.keys[0], cursor, [&](size_t n, const T* value)
+			{
+				outPose.translations[translations.targets[n]] = Vector3<T>(value[0], value[1], value[2]);
+			});
+			SampleTrackSet(scales, time, cursor.keys[2], cursor, [&](size_t n, const T* value)
+			{
+				outPose.scales[scales.targets[n]] = Vector3<T>(value[0], value[1], value[2]);
+			});
+			SampleTrackSet(rotations, time, cursor.keys[1], cursor, [&](size_t n, const T* value)
+			{
+				outPose.rotations[rotations.targets[n]] = Quaternion::Normalise(Quaternion(value[0], value[1], value[2], value[3]));
+			});
+		}
+
+		//Finds the key k of the track [begin, end) with times[k] <= time < times[k + 1], starting from the cached key.
+		//Advances linearly for small steps forward and falls back to a binary search otherwise. Returns a key local to the track.
+		static uint32_t FindKey(const std::vector<T>& times, uint32_t begin, uint32_t end, T time, uint32_t cachedKey)
+		{
+			const uint32_t count = end - begin;
+			if (count < 2 || time <= times[begin])
+				return 0;
+			if (time >= times[end - 1])
+				return count - 1;
+
+			uint32_t key = std::min(cachedKey, count - 2);
+			if (times[begin + key] <= time)
+			{
+				constexpr uint32_t maxLinearSteps = 4;
+				for (uint32_t step = 0; step < maxLinearSteps; step++)
+				{
+					if (time < times[begin + key + 1])
+						return key;
+					key++;
+				}
+			}
+
+			auto it = std::upper_bound(times.begin() + begin, times.begin() + end, time);
+			return static_cast<uint32_t>(it - (times.begin() + begin)) - 1;
+		}
+
+	private:
+		template<size_t Components, typename ValueFunc, typename InFunc, typename OutFunc>
+		void AddTrack(AnimationTrackSet<T, Components>& set, uint32_t target, AnimationInterpolation interpolation, std::span<const T> times, size_t valueCount,
+			ValueFunc&& value, InFunc&& inTangent, OutFunc&& outTangent)
+		{
+			const size_t count = std::min(times.size(), valueCount);
+			if (count == 0)
+				return;
+
+			set.targets.push_back(target);
+			set.interpolations.push_back(interpolation);
+			set.keyOffsets.push_back(set.keyOffsets.back() + static_cast<uint32_t>(count));
+			set.times.insert(set.times.end(), times.begin(), times.begin() + count);
+			for (size_t comp = 0; comp < Components; comp++)
+			{
+				for (size_t key = 0; key < count; key++)
+				{
+					set.values[comp].push_back(value(key, comp));
+					set.inTangents[comp].push_back(inTangent(key, comp));
+					set.outTangents[comp].push_back(outTangent(key, comp));
+				}
+			}
+			duration = std::max(duration, times[count - 1]);
+		}
+
+		//Resolves the keys and Hermite weights of every track, then evaluates all tracks per component in one branch-free loop:
+		//value = w0 * p0 + w1 * p1 + wt0 * outTangent0 + wt1 * inTangent1.
+		template<size_t Components, typename WriteFunc>
+		static void SampleTrackSet(const AnimationTrackSet<T, Components>& set, T time, std::vector<uint32_t>& keys, AnimationCursor<T>& cursor, WriteFunc&& write)
+		{
+			const size_t trackCount = set.GetTrackCount();
+			if (trackCount == 0)
+				return;
+
+			keys.resize(trackCount, 0);
+			cursor.index0.resize(trackCount);
+			cursor.index1.resize(trackCount);
+			cursor.w0.resize(trackCount);
+			cursor.w1.resize(trackCount);
+			cursor.wt0.resize(trackCount);
+			cursor.wt1.resize(trackCount);
+
+			for (size_t n = 0; n < trackCount; n++)
+			{
+				const uint32_t begin = set.keyOffsets[n];
+				const uint32_t end = set.keyOffsets[n + 1];
+				const uint32_t key = FindKey(set.times, begin, end, time, keys[n]);
+				keys[n] = key;
+
+				const uint32_t i0 = begin + key;
+				const uint32_t i1 = std::min(i0 + 1, end - 1);
+				const T dt = set.times[i1] - set.times[i0];
+				const T u = dt > 0 ? std::clamp((time - set.times[i0]) / dt, T(0), T(1)) : T(0);
+
+				T w0 = 1, w1 = 0, wt0 = 0, wt1 = 0;
+				switch (set.interpolations[n])
+				{
+				case AnimationInterpolation::Step:
+					break;
+				case AnimationInterpolation::Linear:
+					w0 = 1 - u;
+					w1 = u;
+					break;
+				case AnimationInterpolation::Cubic:
+				{
+					const T u2 = u * u;
+					const T u3 = u2 * u;
+					w0 = 2 * u3 - 3 * u2 + 1;
+					w1 = -2 * u3 + 3 * u2;
+					wt0 = (u3 - 2 * u2 + u) * dt;
+					wt1 = (u3 - u2) * dt;
+					break;
+				}
+				}
+
+				//Blend rotations along the shortest arc.
+				if constexpr (Components == 4)
+				{
+					if (set.interpolations[n] != AnimationInterpolation::Cubic)
+					{
+						T dot = 0;
+						for (size_t comp = 0; comp < Components; comp++)
+							dot += set.values[comp][i0] * set.values[comp][i1];
+						if (dot < 0)
+							w1 = -w1;
+					}
+				}
+
+				cursor.index0[n] = i0;
+				cursor.index1[n] = i1;
+				cursor.w0[n] = w0;
+				cursor.w1[n] = w1;
+				cursor.wt0[n] = wt0;
+				cursor.wt1[n] = wt1;
+			}
+
+			std::vector<T>* results = cursor.results;
+			for (size_t comp = 0; comp < Components; comp++)
+			{
+				results[comp].resize(trackCount);
+				const T* values = set.values[comp].data();
+				const T* inTangents = set.inTangents[comp].data();
+				const T* outTangents = set.outTangents[comp].data();
+				const uint32_t* index0 = cursor.index0.data();
+				const uint32_t* index1 = cursor.index1.data();
+				const T* w0 = cursor.w0.data();
+				const T* w1 = cursor.w1.data();
+				const T* wt0 = cursor.wt0.data();
+				const T* wt1 = cursor.wt1.data();
+				T* result = results[comp].data();
+				for (size_t n = 0; n < trackCount; n++)
+				{
+					result[n] = w0[n] * values[index0[n]] + w1[n] * values[index1[n]]
+						+ wt0[n] * outTangents[index0[n]] + wt1[n] * inTangents[index1[n]];
+				}
+			}
+
+			for (size_t n = 0; n < trackCount; n++)
+			{
+				T value[Components];
+				for (size_t comp = 0; comp < Components; comp++)
+					value[comp] = results[comp][n];
+				write(n, value);
+			}
+		}
+	};
+}
@@ -0,0 +1,318 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Layout/BufferLayout.h"
+#include "../Vector/Vector.h"
+#include <vector>
+
+namespace mars
+{
+	//Type of cubic curve, and how its control points are interpreted.
+	enum class CurveType : uint8_t
+	{
+		CatmullRom,		//Passes through p1 .. pn-2. Segment i uses p[i .. i+3].
+		CubicBezier,	//Passes through p0, p3, p6, ... Segment i uses p[3i .. 3i+3].
+		Hermite,		//Control points alternate position and tangent: p0, m0, p1, m1, ... Segment i uses p[2i .. 2i+3].
+		BSpline			//Uniform cubic B-spline, C2 continuous but approximating. Segment i uses p[i .. i+3].
+	};
+
+	//Piecewise cubic curve over Vector2 or Vector3 points. The global parameter u runs from 0 to GetSegmentCount(), with segment floor(u).
+	//Control points are stored SoA, so batched evaluation computes the basis weights for a block of parameters and then evaluates each component in one loop.
+	template<typename Point>
+	class Curve
+	{
+	public:
+		using T = typename LayoutTraits<Point>::ComponentType;
+		static constexpr size_t Dim = LayoutTraits<Point>::Rows;
+		static_assert(std::is_floating_point_v<T> && LayoutTraits<Point>::Columns == 1, "Curve requires floating point vector points.");
+
+	private:
+		static constexpr size_t BlockSize = 64;
+
+		CurveType m_Type;
+		size_t m_SegmentCount = 0;
+		std::vector<T> m_Points[Dim];
+
+		//Arc-length table: cumulative length m_ArcLengths[n] at parameter m_ArcParams[n].
+		std::vector<T> m_ArcParams;
+		std::vector<T> m_ArcLengths;
+
+	public:
+		//Constructs a Curve of the type from the control points.
+		Curve(CurveType type, std::span<const Point> controlPoints)
+			: m_Type(type)
+		{
+			const size_t count = controlPoints.size();
+			for (size_t c = 0; c < Dim; c++)
+			{
+				m_Points[c].resize(count);
+				for (size_t idx = 0; idx < count; idx++)
+					m_Points[c][idx] = controlPoints[idx].GetData()[c];
+			}
+
+			switch (type)
+			{
+			case CurveType::CubicBezier:
+				m_SegmentCount = count >= 4 ? (count - 1) / 3 : 0;
+				break;
+			case CurveType::Hermite:
+				m_SegmentCount = count >= 4 ? (count - 2) / 2 : 0;
+				break;
+			case CurveType::CatmullRom:
+			case CurveType::BSpline:
+				m_SegmentCount = count >= 4 ? count - 3 : 0;
+				break;
+			}
+		}
+
+		//Destructs the Curve.
+		~Curve() {}
+
+		inline CurveType GetType() const { return m_Type; }
+		inline size_t GetSegmentCount() const { return m_SegmentCount; }
+
+		//Calculates the cubic basis weights w and their derivatives dw at the local parameter t in [0, 1].
+		static void BasisWeights(CurveType type, T t, T w[4], T dw[4])
+		{
+			const T t2 = t * t;
+			const T t3 = t2 * t;
+			const T s = 1 - t;
+			switch (type)
+			{
+			case CurveType::CatmullRom:
+				w[0] = T(0.5) * (-t3 + 2 * t2 - t);
+				w[1] = T(0.5) * (3 * t3 - 5 * t2 + 2);
+				w[2] = T(0.5) * (-3 * t3 + 4 * t2 + t);
+				w[3] = T(0.5) * (t3 - t2);
+				dw[0] = T(0.5) * (-3 * t2 + 4 * t - 1);
+				dw[1] = T(0.5) * (9 * t2 - 10 * t);
+				dw[2] = T(0.5) * (-9 * t2 + 8 * t + 1);
+				dw[3] = T(0.5) * (3 * t2 - 2 * t);
+				break;
+			case CurveType::CubicBezier:
+				w[0] = s * s * s;
+				w[1] = 3 * t * s * s;
+				w[2] = 3 * t2 * s;
+				w[3] = t3;
+				dw[0] = -3 * s * s;
+				dw[1] = 3 * s * s - 6 * t * s;
+				dw[2] = 6 * t * s - 3 * t2;
+				dw[3] = 3 * t2;
+				break;
+			case CurveType::Hermite:
+				w[0] = 2 * t3 - 3 * t2 + 1;
+				w[1] = t3 - 2 * t2 + t;
+				w[2] = -2 * t3 + 3 * t2;
+				w[3] = t3 - t2;
+				dw[0] = 6 * t2 - 6 * t;
+				dw[1] = 3 * t2 - 4 * t + 1;
+				dw[2] = -6 * t2 + 6 * t;
+				dw[3] = 3 * t2 - 2 * t;
+				break;
+			case CurveType::BSpline:
+				w[0] = s * s * s / 6;
+				w[1] = (3 * t3 - 6 * t2 + 4) / 6;
+				w[2] = (-3 * t3 + 3 * t2 + 3 * t + 1) / 6;
+				w[3] = t3 / 6;
+				dw[0] = -s * s / 2;
+				dw[1] = (3 * t2 - 4 * t) / 2;
+				dw[2] = (-3 * t2 + 2 * t + 1) / 2;
+				dw[3] = t2 / 2;
+				break;
+			}
+		}
+
+		//Returns the position on the curve at the global parameter u, clamped to [0, GetSegmentCount()].
+		Point Evaluate(T u) const
+		{
+			Point position, tangent;
+			Evaluate(std::span<const T>(&u, 1), std::span<Point>(&position, 1), std::span<Point>(&tangent, 1));
+			return position;
+		}
+		//Returns the tangent (derivative with respect to u) on the curve at the global parameter u, clamped to [0, GetSegmentCount()].
+		Point EvaluateTangent(T u) const
+		{
+			Point position, tangent;
+			Evaluate(std::span<const T>(&u, 1), std::span<Point>(&position, 1), std::span<Point>(&tangent, 1));
+			return tangent;
+		}
+
+		//Evaluates positions, and tangents if the span is not empty, at many global parameters.
+		//Processes min(parameters.size(), positions.size()) parameters; tangents must be empty or at least as large.
+		void Evaluate(std::span<const T> parameters, std::span<Point> positions, std::span<Point> tangents = {}) const
+		{
+			if (m_SegmentCount == 0)
+				return;
+
+			const size_t count = std::min(parameters.size(), positions.size());
+			const bool writeTangents = tangents.size() >= count;
+			const size_t stride = m_Type == CurveType::CubicBezier ? 3 : (m_Type == CurveType::Hermite ? 2 : 1);
+
+			uint32_t first[BlockSize];
+			T w[4][BlockSize], dw[4][BlockSize];
+			T pos[Dim][BlockSize], tan[Dim][BlockSize];
+
+			for (size_t base = 0; base < count; base += BlockSize)
+			{
+				const size_t blockCount = std::min(BlockSize, count - base);
+				for (size_t idx = 0; idx < blockCount; idx++)
+				{
+					T u = std::clamp(parameters[base + idx], T(0), static_cast<T>(m_SegmentCount));
+					size_t segment = std::min(static_cast<size_t>(u), m_SegmentCount - 1);
+					T weights[4], derivatives[4];
+					BasisWeights(m_Type, u - static_cast<T>(segment), weights, derivatives);
+
+					first[idx] = static_cast<uint32_t>(segment * stride);
+					for (size_t k = 0; k < 4; k++)
+					{
+						w[k][idx] = weights[k];
+						dw[k][idx] = derivatives[k];
+					}
+				}
+
+				for (size_t c = 0; c < Dim; c++)
+				{
+					const T* p = m_Points[c].data();
+					for (size_t idx = 0; idx < blockCount; idx++)
+					{
+						const T* g = p + first[idx];
+						pos[c][idx] = w[0][idx] * g[0] + w[1][idx] * g[1] + w[2][idx] * g[2] + w[3][idx] * g[3];
+						tan[c][idx] = dw[0][idx] * g[0] + dw[1][idx] * g[1] + dw[2][idx] * g[2] + dw[3][idx] * g[3];
+					}
+				}
+
+				for (size_t idx = 0; idx < blockCount; idx++)
+				{
+					Vector<T, Dim> position, tangent;
+					for (size_t c = 0; c < Dim; c++)
+					{
+						position.data[c] = pos[c][idx];
+						tangent.data[c] = tan[c][idx];
+					}
+					positions[base + idx] = position;
+					if (writeTangents)
+						tangents[base + idx] = tangent;
+				}
+			}
+		}
+
+		//Builds the arc-length lookup table by sampling each segment samplesPerSegment times. Required by the distance-based functions.
+		void BuildArcLengthTable(size_t samplesPerSegment = 32)
+		{
+			samplesPerSegment = std::max<size_t>(samplesPerSegment, 1);
+			const size_t count = m_SegmentCount * samplesPerSegment + 1;
+			m_ArcParams.resize(count);
+			m_ArcLengths.resize(count);
+			if (m_SegmentCount == 0)
+			{
+				m_ArcParams.assign(1, T(0));
+				m_ArcLengths.assign(1, T(0));
+				return;
+			}
+
+			for (size_t idx = 0; idx < count; idx++)
+				m_ArcParams[idx] = static_cast<T>(idx) / static_cast<T>(samplesPerSegment);
+
+			std::vector<Point> samples(count);
+			Evaluate(m_ArcParams, samples);
+
+			m_ArcLengths[0] = 0;
+			for (size_t idx = 1; idx < count; idx++)
+				m_ArcLengths[idx] = m_ArcLengths[idx - 1] + Distance(samples[idx - 1], samples[idx]);
+		}
+
+		//Returns the total length of the curve from the arc-length table.
+		T GetLength() const
+		{
+			return m_ArcLengths.empty() ? T(0) : m_ArcLengths.back();
+		}
+
+		//Returns the global parameter at the distance along the curve, clamped to [0, GetLength()].
+		T ParameterAtDistance(T distance) const
+		{
+			if (m_ArcLengths.size() < 2)
+				return 0;
+
+			distance = std::clamp(distance, T(0), m_ArcLengths.back());
+			auto it = std::upper_bound(m_ArcLengths.begin(), m_ArcLengths.end(), distance);
+			size_t idx = std::min(static_cast<size_t>(it - m_ArcLengths.begin()), m_ArcLengths.size() - 1);
+			const T s0 = m_ArcLengths[idx - 1];
+			const T s1 = m_ArcLengths[idx];
+			const T t = s1 > s0 ? (distance - s0) / (s1 - s0) : T(0);
+			return m_ArcParams[idx - 1] + (m_ArcParams[idx] - m_ArcParams[idx - 1]) * t;
+		}
+
+		//Evaluates positions, and tangents if the span is not empty, at many distances along the curve, for constant-speed motion.
+		void EvaluateAtDistance(std::span<const T> distances, std::span<Point> positions, std::span<Point> tangents = {}) const
+		{
+			const size_t count = std::min(distances.size(), positions.size());
+			T parameters[BlockSize];
+			for (size_t base = 0; base < count; base += BlockSize)
+			{
+				const size_t blockCount = std::min(BlockSize, count - base);
+				for (size_t idx = 0; idx < blockCount; idx++)
+					parameters[idx] = ParameterAtDistance(distances[base + idx]);
+
+				Evaluate(std::span<const T>(parameters, blockCount), positions.subspan(base, blockCount),
+					tangents.size() >= count ? tangents.subspan(base, blockCount) : std::span<Point>());
+			}
+		}
+
+		//Flattens the curve to a polyline, appending the vertices to output. Each segment is subdivided adaptively until the
+		//curve deviates from the chord by at most tolerance, or maxDepth is reached.
+		void Flatten(T tolerance, std::vector<Point>& output, uint32_t maxDepth = 16) const
+		{
+			if (m_SegmentCount == 0)
+				return;
+
+			output.push_back(Evaluate(0));
+			for (size_t segment = 0; segment < m_SegmentCount; segment++)
+			{
+				const T u0 = static_cast<T>(segment);
+				FlattenRange(u0, u0 + 1, Evaluate(u0), Evaluate(u0 + 1), tolerance, maxDepth, output);
+			}
+		}
+
+	private:
+		static T Distance(const Point& a, const Point& b)
+		{
+			T sum = 0;
+			for (size_t c = 0; c < Dim; c++)
+			{
+				T d = a.GetData()[c] - b.GetData()[c];
+				sum += d * d;
+			}
+			return std::sqrt(sum);
+		}
+
+		static T DistanceToMidpoint(const Point& p, const Point& a, const Point& b, T t)
+		{
+			T sum = 0;
+			for (size_t c = 0; c < Dim; c++)
+			{
+				T d = p.GetData()[c] - (a.GetData()[c] + (b.GetData()[c] - a.GetData()[c]) * t);
+				sum += d * d;
+			}
+			return std::sqrt(sum);
+		}
+
+		void FlattenRange(T u0, T u1, const Point& p0, const Point& p1, T tolerance, uint32_t depth, std::vector<Point>& output) const
+		{
+			const T um = (u0 + u1) / 2;
+			const Point pm = Evaluate(um);
+			if (depth > 0)
+			{
+				//Test the quarter points as well, so an S-shaped span is not mistaken for a flat one.
+				const T error = std::max({ DistanceToMidpoint(pm, p0, p1, T(0.5)),
+					DistanceToMidpoint(Evaluate((u0 + um) / 2), p0, p1, T(0.25)),
+					DistanceToMidpoint(Evaluate((um + u1) / 2), p0, p1, T(0.75)) });
+				if (error > tolerance)
+				{
+					FlattenRange(u0, um, p0, pm, tolerance, depth - 1, output);
+					FlattenRange(um, u1, pm, p1, tolerance, depth - 1, output);
+					return;
+				}
+			}
+			output.push_back(p1);
+		}
+	};
+}
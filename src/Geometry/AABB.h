@@ -0,0 +1,225 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Matrix/Matrix4.h"
+#include "../Other/Parallel.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector3.h"
+#include "../Vector/Vector4.h"
+#include <atomic>
+#include <limits>
+#include <vector>
+
+namespace mars
+{
+	//Axis-aligned bounding box. The default AABB is empty: minimum is +max and maximum is -max, so merging anything into it gives that thing.
+	template<typename T>
+	class AABB
+	{
+	private:
+		static constexpr size_t Lanes = 8;
+		static constexpr size_t BlockSize = 64;
+
+		//Frustum planes (nx, ny, nz, d), inside where n.p + d >= 0, of a view-projection mapping to clip space with 0 <= z <= w.
+		template<StorageOrder O>
+		static void ExtractPlanes(const Matrix4<T, O>& m, T planes[6][4])
+		{
+			const T rows[4][4] = { { m.a, m.b, m.c, m.d }, { m.e, m.f, m.g, m.h }, { m.i, m.j, m.k, m.l }, { m.m, m.n, m.o, m.p } };
+			Unroll<4>([&](auto c)
+			{
+				planes[0][c] = rows[3][c] + rows[0][c];
+				planes[1][c] = rows[3][c] - rows[0][c];
+				planes[2][c] = rows[3][c] + rows[1][c];
+				planes[3][c] = rows[3][c] - rows[1][c];
+				planes[4][c] = rows[2][c];
+				planes[5][c] = rows[3][c] - rows[2][c];
+			});
+		}
+
+	public:
+		Vector3<T> minimum;
+		Vector3<T> maximum;
+
+		//Constructs an empty AABB.
+		AABB()
+			: minimum(std::numeric_limits<T>::max(), std::numeric_limits<T>::max(), std::numeric_limits<T>::max()),
+			maximum(std::numeric_limits<T>::lowest(), std::numeric_limits<T>::lowest(), std::numeric_limits<T>::lowest()) {}
+		//Constructs an AABB taking minimum, maximum.
+		AABB(const Vector3<T>& minimum, const Vector3<T>& maximum)
+			: minimum(minimum), maximum(maximum) {}
+
+		//Destructs the AABB.
+		~AABB() {}
+
+		//Returns whether the box contains no point.
+		inline bool IsEmpty() const { return minimum.x > maximum.x || minimum.y > maximum.y || minimum.z > maximum.z; }
+		inline Vector3<T> GetCenter() const { return Vector3<T>((minimum.x + maximum.x) / 2, (minimum.y + maximum.y) / 2, (minimum.z + maximum.z) / 2); }
+		inline Vector3<T> GetHalfExtents() const { return Vector3<T>((maximum.x - minimum.x) / 2, (maximum.y - minimum.y) / 2, (maximum.z - minimum.z) / 2); }
+
+		//Grows the box to contain the point.
+		void Merge(const Vector3<T>& point)
+		{
+			minimum = Vector3<T>::Min(minimum, point);
+			maximum = Vector3<T>::Max(maximum, point);
+		}
+		//Grows the box to contain the other box.
+		void Merge(const AABB& other)
+		{
+			minimum = Vector3<T>::Min(minimum, other.minimum);
+			maximum = Vector3<T>::Max(maximum, other.maximum);
+		}
+
+		//Returns the AABB of the input box transformed by the matrix (Arvo's method). An empty box stays empty.
+		template<StorageOrder O>
+		static AABB Transform(const AABB& input, const Matrix4<T, O>& matrix)
+		{
+			if (input.IsEmpty())
+				return input;
+			const Vector3<T> center = input.GetCenter();
+			const Vector3<T> half = input.GetHalfExtents();
+			const Vector3<T> newCenter(matrix.a * center.x + matrix.b * center.y + matrix.c * center.z + matrix.d,
+				matrix.e * center.x + matrix.f * center.y + matrix.g * center.z + matrix.h,
+				matrix.i * center.x + matrix.j * center.y + matrix.k * center.z + matrix.l);
+			const Vector3<T> newHalf(std::abs(matrix.a) * half.x + std::abs(matrix.b) * half.y + std::abs(matrix.c) * half.z,
+				std::abs(matrix.e) * half.x + std::abs(matrix.f) * half.y + std::abs(matrix.g) * half.z,
+				std::abs(matrix.i) * half.x + std::abs(matrix.j) * half.y + std::abs(matrix.k) * half.z);
+			return AABB(Vector3<T>(newCenter.x - newHalf.x, newCenter.y - newHalf.y, newCenter.z - newHalf.z),
+				Vector3<T>(newCenter.x + newHalf.x, newCenter.y + newHalf.y, newCenter.z + newHalf.z));
+		}
+		//Transforms the input boxes by the matrix into outputs. Processes min(inputs.size(), outputs.size()) boxes.
+		template<StorageOrder O>
+		static void Transform(std::span<const AABB> inputs, const Matrix4<T, O>& matrix, std::span<AABB> outputs, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			const size_t count = std::min(inputs.size(), outputs.size());
+			Parallel::For(policy, count, Parallel::GetChunkSize(count, 4096), [&](size_t begin, size_t end)
+			{
+				for (size_t idx = begin; idx < end; idx++)
+					outputs[idx] = AABB::Transform(inputs[idx], matrix);
+			});
+		}
+
+		//Returns the AABB of the points, or an empty AABB if points is empty.
+		static AABB Compute(std::span<const Vector3<T>> points, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			const size_t count = points.size();
+			const size_t chunkSize = Parallel::GetChunkSize(count, 16384);
+			std::vector<AABB> chunkBounds(policy == ExecutionPolicy::ParallelSimd ? (count + chunkSize - 1) / chunkSize : 1);
+			Parallel::For(policy, count, chunkSize, [&](size_t begin, size_t end)
+			{
+				AABB& result = chunkBounds[begin / chunkSize];
+				if (policy == ExecutionPolicy::Sequential)
+				{
+					for (size_t idx = begin; idx < end; idx++)
+						result.Merge(points[idx]);
+					return;
+				}
+
+				//Per-lane minima and maxima, with no dependency between neighbouring points.
+				T lo[3][Lanes], hi[3][Lanes];
+				Unroll<Lanes>([&](auto lane)
+				{
+					lo[0][lane] = lo[1][lane] = lo[2][lane] = std::numeric_limits<T>::max();
+					hi[0][lane] = hi[1][lane] = hi[2][lane] = std::numeric_limits<T>::lowest();
+				});
+				size_t idx = begin;
+				for (; idx + Lanes <= end; idx += Lanes)
+				{
+					Unroll<Lanes>([&](auto lane)
+					{
+						const Vector3<T>& p = points[idx + lane];
+						lo[0][lane] = std::min(lo[0][lane], p.x);
+						lo[1][lane] = std::min(lo[1][lane], p.y);
+						lo[2][lane] = std::min(lo[2][lane], p.z);
+						hi[0][lane] = std::max(hi[0][lane], p.x);
+						hi[1][lane] = std::max(hi[1][lane], p.y);
+						hi[2][lane] = std::max(hi[2][lane], p.z);
+					});
+				}
+				for (; idx < end; idx++)
+					result.Merge(points[idx]);
+				Unroll<Lanes>([&](auto lane)
+				{
+					result.Merge(AABB(Vector3<T>(lo[0][lane], lo[1][lane], lo[2][lane]), Vector3<T>(hi[0][lane], hi[1][lane], hi[2][lane])));
+				});
+			});
+
+			AABB result;
+			for (const AABB& bounds : chunkBounds)
+				result.Merge(bounds);
+			return result;
+		}
+
+		//Tests the boxes against the frustum of the view-projection, which maps to clip space with 0 <= z <= w (reverse-Z included),
+		//writing 1 to visible for a box that may be inside and 0 for one that is outside a frustum plane. The test is conservative:
+		//a box outside the frustum near a corner may be reported visible. Processes min(boxes.size(), visible.size()) boxes and returns the number visible.
+		template<StorageOrder O>
+		static size_t Cull(std::span<const AABB> boxes, const Matrix4<T, O>& viewProjection, std::span<uint8_t> visible, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			T planes[6][4];
+			ExtractPlanes(viewProjection, planes);
+			const size_t count = std::min(boxes.size(), visible.size());
+			std::atomic<size_t> visibleCount = 0;
+			Parallel::For(policy, count, Parallel::GetChunkSize(count, 4096), [&](size_t begin, size_t end)
+			{
+				size_t localCount = 0;
+				if (policy == ExecutionPolicy::Sequential)
+				{
+					for (size_t idx = begin; idx < end; idx++)
+					{
+						const Vector3<T> center = boxes[idx].GetCenter();
+						const Vector3<T> half = boxes[idx].GetHalfExtents();
+						bool inside = true;
+						for (size_t plane = 0; plane < 6 && inside; plane++)
+						{
+							const T distance = planes[plane][0] * center.x + planes[plane][1] * center.y + planes[plane][2] * center.z + planes[plane][3];
+							const T radius = std::abs(planes[plane][0]) * half.x + std::abs(planes[plane][1]) * half.y + std::abs(planes[plane][2]) * half.z;
+							inside = distance + radius >= 0;
+						}
+						visible[idx] = inside ? 1 : 0;
+						localCount += inside ? 1 : 0;
+					}
+				}
+				else
+				{
+					//Each block is transposed to SoA and tested against every plane without branches.
+					for (size_t base = begin; base < end; base += BlockSize)
+					{
+						const size_t blockCount = std::min(BlockSize, end - base);
+						T cx[BlockSize], cy[BlockSize], cz[BlockSize], hx[BlockSize], hy[BlockSize], hz[BlockSize];
+						uint8_t inside[BlockSize];
+						for (size_t idx = 0; idx < blockCount; idx++)
+						{
+							const AABB& box = boxes[base + idx];
+							cx[idx] = (box.minimum.x + box.maximum.x) / 2;
+							cy[idx] = (box.minimum.y + box.maximum.y) / 2;
+							cz[idx] = (box.minimum.z + box.maximum.z) / 2;
+							hx[idx] = (box.maximum.x - box.minimum.x) / 2;
+							hy[idx] = (box.maximum.y - box.minimum.y) / 2;
+							hz[idx] = (box.maximum.z - box.minimum.z) / 2;
+							inside[idx] = 1;
+						}
+						for (size_t plane = 0; plane < 6; plane++)
+						{
+							const T nx = planes[plane][0], ny = planes[plane][1], nz = planes[plane][2], d = planes[plane][3];
+							const T ax = std::abs(nx), ay = std::abs(ny), az = std::abs(nz);
+							for (size_t idx = 0; idx < blockCount; idx++)
+							{
+								const T distance = nx * cx[idx] + ny * cy[idx] + nz * cz[idx] + d + ax * hx[idx] + ay * hy[idx] + az * hz[idx];
+								inside[idx] &= static_cast<uint8_t>(distance >= 0);
+							}
+						}
+						for (size_t idx = 0; idx < blockCount; idx++)
+						{
+							visible[base + idx] = inside[idx];
+							localCount += inside[idx];
+						}
+					}
+				}
+				visibleCount.fetch_add(localCount, std::memory_order_relaxed);
+			});
+			return visibleCount.load(std::memory_order_relaxed);
+		}
+	};
+
+	typedef AABB<float> floatAABB;
+	typedef AABB<double> doubleAABB;
+}
@@ -0,0 +1,240 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Matrix/Decomposition.h"
+#include "../Other/Parallel.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector3.h"
+
+namespace mars
+{
+	//Running mean and covariance of 3D points. Points are accumulated a block at a time (block mean, then the squared deviations
+	//from it) and blocks are merged with Chan et al.'s pairwise update, which keeps the sums accurate for points far from the origin.
+	template<typename T>
+	class Covariance3
+	{
+	private:
+		static constexpr size_t BlockSize = 256;
+		static constexpr size_t Lanes = 8;
+
+		//Returns the sum of the partial sums of the lanes.
+		static inline T Sum(const T (&partials)[Lanes])
+		{
+			T result = 0;
+			Unroll<Lanes>([&](auto lane) { result += partials[lane]; });
+			return result;
+		}
+
+	public:
+		size_t count;
+		Vector3<T> mean;
+		//Sums of the products of the deviations from the mean.
+		T xx, xy, xz, yy, yz, zz;
+
+		//Constructs an empty Covariance3.
+		Covariance3()
+			: count(0), mean(), xx(0), xy(0), xz(0), yy(0), yz(0), zz(0) {}
+
+		//Destructs the Covariance3.
+		~Covariance3() {}
+
+		//Adds the points.
+		template<typename U>
+		void Add(std::span<const Vector3<U>> points)
+		{
+			for (size_t base = 0; base < points.size(); base += BlockSize)
+			{
+				const size_t blockCount = std::min(BlockSize, points.size() - base);
+				const size_t paddedCount = (blockCount + Lanes - 1) / Lanes * Lanes;
+				T x[BlockSize], y[BlockSize], z[BlockSize];
+				for (size_t idx = 0; idx < blockCount; idx++)
+				{
+					x[idx] = static_cast<T>(points[base + idx].x);
+					y[idx] = static_cast<T>(points[base + idx].y);
+					z[idx] = static_cast<T>(points[base + idx].z);
+				}
+				for (size_t idx = blockCount; idx < paddedCount; idx++)
+					x[idx] = y[idx] = z[idx] = 0;
+
+				//Every sum is kept in Lanes partial sums, so the loops vectorise without reassociating a single running sum.
+				T sx[Lanes] = {}, sy[Lanes] = {}, sz[Lanes] = {};
+				for (size_t idx = 0; idx < paddedCount; idx += Lanes)
+				{
+					for (size_t lane = 0; lane < Lanes; lane++)
+					{
+						sx[lane] += x[idx + lane];
+						sy[lane] += y[idx + lane];
+						sz[lane] += z[idx + lane];
+					}
+				}
+				const T invCount = T(1) / static_cast<T>(blockCount);
+				Covariance3 block;
+				block.count = blockCount;
+				block.mean = Vector3<T>(Sum(sx) * invCount, Sum(sy) * invCount, Sum(sz) * invCount);
+
+				//The padding gets the mean, so it adds nothing to the deviations.
+				for (size_t idx = blockCount; idx < paddedCount; idx++)
+				{
+					x[idx] = block.mean.x;
+					y[idx] = block.mean.y;
+					z[idx] = block.mean.z;
+				}
+				T sxx[Lanes] = {}, sxy[Lanes] = {}, sxz[Lanes] = {}, syy[Lanes] = {}, syz[Lanes] = {}, szz[Lanes] = {};
+				for (size_t idx = 0; idx < paddedCount; idx += Lanes)
+				{
+					for (size_t lane = 0; lane < Lanes; lane++)
+					{
+						const T dx = x[idx + lane] - block.mean.x, dy = y[idx + lane] - block.mean.y, dz = z[idx + lane] - block.mean.z;
+						sxx[lane] += dx * dx;
+						sxy[lane] += dx * dy;
+						sxz[lane] += dx * dz;
+						syy[lane] += dy * dy;
+						syz[lane] += dy * dz;
+						szz[lane] += dz * dz;
+					}
+				}
+				block.xx = Sum(sxx);
+				block.xy = Sum(sxy);
+				block.xz = Sum(sxz);
+				block.yy = Sum(syy);
+				block.yz = Sum(syz);
+				block.zz = Sum(szz);
+				Merge(block);
+			}
+		}
+
+		//Merges the points accumulated by another Covariance3.
+		void Merge(const Covariance3& other)
+		{
+			if (other.count == 0)
+				return;
+			if (count == 0)
+			{
+				*this = other;
+				return;
+			}
+
+			const T total = static_cast<T>(count + other.count);
+			const T weight = static_cast<T>(count) * static_cast<T>(other.count) / total;
+			const T dx = other.mean.x - mean.x, dy = other.mean.y - mean.y, dz = other.mean.z - mean.z;
+			xx += other.xx + dx * dx * weight;
+			xy += other.xy + dx * dy * weight;
+			xz += other.xz + dx * dz * weight;
+			yy += other.yy + dy * dy * weight;
+			yz += other.yz + dy * dz * weight;
+			zz += other.zz + dz * dz * weight;
+
+			const T otherFraction = static_cast<T>(other.count) / total;
+			mean = Vector3<T>(mean.x + dx * otherFraction, mean.y + dy * otherFraction, mean.z + dz * otherFraction);
+			count += other.count;
+		}
+
+		//Returns the population covariance matrix, or 0 if no points were added.
+		template<StorageOrder O = StorageOrder::RowMajor>
+		Matrix3<T, O> GetMatrix() const
+		{
+			const T invCount = count ? T(1) / static_cast<T>(count) : T(0);
+			return Matrix3<T, O>(xx * invCount, xy * invCount, xz * invCount,
+				xy * invCount, yy * invCount, yz * invCount,
+				xz * invCount, yz * invCount, zz * invCount);
+		}
+
+		//Returns the Covariance3 of the points.
+		template<typename U>
+		static Covariance3 Compute(std::span<const Vector3<U>> points)
+		{
+			Covariance3 result;
+			result.Add(points);
+			return result;
+		}
+	};
+
+	//Oriented bounding box. The box axes are the columns of axes, a proper rotation, and halfExtents are measured along them.
+	template<typename T>
+	class OBB
+	{
+	public:
+		Vector3<T> center;
+		Vector3<T> halfExtents;
+		Matrix3<T> axes;
+
+		//Constructs an OBB of 0 size at the origin, aligned with the world axes.
+		OBB()
+			: center(), halfExtents(), axes(1, 0, 0, 0, 1, 0, 0, 0, 1) {}
+		//Constructs an OBB taking center, halfExtents, axes.
+		OBB(const Vector3<T>& center, const Vector3<T>& halfExtents, const Matrix3<T>& axes)
+			: center(center), halfExtents(halfExtents), axes(axes) {}
+
+		//Destructs the OBB.
+		~OBB() {}
+
+		//Returns the corner of the box at the index in [0, 8); bit k of the index selects the positive side of axis k.
+		Vector3<T> GetCorner(uint32_t index) const
+		{
+			const T sx = (index & 1u) ? halfExtents.x : -halfExtents.x;
+			const T sy = (index & 2u) ? halfExtents.y : -halfExtents.y;
+			const T sz = (index & 4u) ? halfExtents.z : -halfExtents.z;
+			return Vector3<T>(center.x + axes.a * sx + axes.b * sy + axes.c * sz,
+				center.y + axes.d * sx + axes.e * sy + axes.f * sz,
+				center.z + axes.g * sx + axes.h * sy + axes.i * sz);
+		}
+
+		//Fits an OBB to the points, with the axes along the principal components of the point covariance.
+		//The covariance and eigen-decomposition are computed in double. Returns the default OBB if points is empty.
+		static OBB Fit(std::span<const Vector3<T>> points)
+		{
+			if (points.empty())
+				return OBB();
+
+			const Matrix3<double> covariance = Covariance3<double>::Compute(points).GetMatrix();
+			const Matrix3<double> eigenvectors = Decomposition::SymmetricEigen(covariance).eigenvectors;
+			const Matrix3<T> axes(static_cast<T>(eigenvectors.a), static_cast<T>(eigenvectors.b), static_cast<T>(eigenvectors.c),
+				static_cast<T>(eigenvectors.d), static_cast<T>(eigenvectors.e), static_cast<T>(eigenvectors.f),
+				static_cast<T>(eigenvectors.g), static_cast<T>(eigenvectors.h), static_cast<T>(eigenvectors.i));
+
+			//Project onto the axes to find the extents.
+			T minimum[3], maximum[3];
+			Unroll<3>([&](auto k)
+			{
+				minimum[k] = std::numeric_limits<T>::max();
+				maximum[k] = std::numeric_limits<T>::lowest();
+			});
+			for (const Vector3<T>& p : points)
+			{
+				const T u = p.x * axes.a + p.y * axes.d + p.z * axes.g;
+				const T v = p.x * axes.b + p.y * axes.e + p.z * axes.h;
+				const T w = p.x * axes.c + p.y * axes.f + p.z * axes.i;
+				minimum[0] = std::min(minimum[0], u);
+				maximum[0] = std::max(maximum[0], u);
+				minimum[1] = std::min(minimum[1], v);
+				maximum[1] = std::max(maximum[1], v);
+				minimum[2] = std::min(minimum[2], w);
+				maximum[2] = std::max(maximum[2], w);
+			}
+
+			const T mu = (minimum[0] + maximum[0]) / 2, mv = (minimum[1] + maximum[1]) / 2, mw = (minimum[2] + maximum[2]) / 2;
+			const Vector3<T> center(axes.a * mu + axes.b * mv + axes.c * mw,
+				axes.d * mu + axes.e * mv + axes.f * mw,
+				axes.g * mu + axes.h * mv + axes.i * mw);
+			const Vector3<T> halfExtents((maximum[0] - minimum[0]) / 2, (maximum[1] - minimum[1]) / 2, (maximum[2] - minimum[2]) / 2);
+			return OBB(center, halfExtents, axes);
+		}
+		//Fits an OBB to every cluster of points, across threads. Cluster c is points[clusterOffsets[c]] to points[clusterOffsets[c + 1] - 1].
+		//Processes min(clusterOffsets.size() - 1, outputs.size()) clusters.
+		static void Fit(std::span<const Vector3<T>> points, std::span<const uint32_t> clusterOffsets, std::span<OBB> outputs)
+		{
+			const size_t count = clusterOffsets.empty() ? 0 : std::min(clusterOffsets.size() - 1, outputs.size());
+			Parallel::For(count, 64, [&](size_t begin, size_t end)
+			{
+				for (size_t cluster = begin; cluster < end; cluster++)
+				{
+					const size_t first = clusterOffsets[cluster];
+					const size_t last = std::max<size_t>(first, clusterOffsets[cluster + 1]);
+					outputs[cluster] = Fit(points.subspan(first, last - first));
+				}
+			});
+		}
+	};
+
+	typedef OBB<float> floatOBB;
+	typedef OBB<double> doubleOBB;
+}
@@ -0,0 +1,381 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector2.h"
+#include "../Vector/Vector3.h"
+#include <vector>
+
+namespace mars
+{
+	//Exact floating point expansion: a sum of non-overlapping doubles in increasing magnitude, with zeros removed.
+	//Used by the exact stage of the Predicates; the sign of the value is the sign of the largest component.
+	//https://www.cs.cmu.edu/~quake/robust.html
+	class Expansion
+	{
+	public:
+		std::vector<double> components;
+
+	private:
+		//a + b = x + y exactly.
+		static inline void TwoSum(double a, double b, double& x, double& y)
+		{
+			x = a + b;
+			const double bVirtual = x - a;
+			const double aVirtual = x - bVirtual;
+			y = (a - aVirtual) + (b - bVirtual);
+		}
+		//a + b = x + y exactly, requires |a| >= |b|.
+		static inline void FastTwoSum(double a, double b, double& x, double& y)
+		{
+			x = a + b;
+			y = b - (x - a);
+		}
+		//a * b = x + y exactly.
+		static inline void TwoProduct(double a, double b, double& x, double& y)
+		{
+			x = a * b;
+			y = std::fma(a, b, -x);
+		}
+
+		//Adds b to the expansion (Shewchuk's GROW-EXPANSION with zero elimination).
+		void Grow(double b)
+		{
+			std::vector<double> result;
+			result.reserve(components.size() + 1);
+			double q = b;
+			for (double e : components)
+			{
+				double sum, error;
+				TwoSum(q, e, sum, error);
+				if (error != 0.0)
+					result.push_back(error);
+				q = sum;
+			}
+			if (q != 0.0)
+				result.push_back(q);
+			components = std::move(result);
+		}
+
+	public:
+		//Constructs an Expansion of 0.
+		Expansion() {}
+		//Constructs an Expansion of the value.
+		explicit Expansion(double value)
+		{
+			if (value != 0.0)
+				components.push_back(value);
+		}
+
+		//Destructs the Expansion.
+		~Expansion() {}
+
+		//Returns the exact difference a - b.
+		static Expansion Difference(double a, double b)
+		{
+			double x, y;
+			TwoSum(a, -b, x, y);
+			Expansion result;
+			if (y != 0.0)
+				result.components.push_back(y);
+			if (x != 0.0)
+				result.components.push_back(x);
+			return result;
+		}
+
+		//Adds two Expansions.
+		Expansion operator+ (const Expansion& other) const
+		{
+			Expansion result = *this;
+			for (double f : other.components)
+				result.Grow(f);
+			return result;
+		}
+		//Negates the Expansion.
+		Expansion operator- () const
+		{
+			Expansion result = *this;
+			for (double& e : result.components)
+				e = -e;
+			return result;
+		}
+		//Subtracts two Expansions.
+		Expansion operator- (const Expansion& other) const
+		{
+			return *this + (-other);
+		}
+		//Scales the Expansion by the double b (Shewchuk's SCALE-EXPANSION with zero elimination).
+		Expansion operator* (double b) const
+		{
+			Expansion result;
+			if (components.empty() || b == 0.0)
+				return result;
+			result.components.reserve(2 * components.size());
+			double q, error;
+			TwoProduct(components[0], b, q, error);
+			if (error != 0.0)
+				result.components.push_back(error);
+			for (size_t idx = 1; idx < components.size(); idx++)
+			{
+				double product1, product0, sum;
+				TwoProduct(components[idx], b, product1, product0);
+				TwoSum(q, product0, sum, error);
+				if (error != 0.0)
+					result.components.push_back(error);
+				FastTwoSum(product1, sum, q, error);
+				if (error != 0.0)
+					result.components.push_back(error);
+			}
+			if (q != 0.0)
+				result.components.push_back(q);
+			return result;
+		}
+		//Multiplies two Expansions.
+		Expansion operator* (const Expansion& other) const
+		{
+			Expansion result;
+			for (double f : other.components)
+				result = result + *this * f;
+			return result;
+		}
+
+		//Returns the approximate value of the Expansion.
+		double Estimate() const
+		{
+			double result = 0.0;
+			for (double e : components)
+				result += e;
+			return result;
+		}
+		//Returns -1, 0 or +1.
+		int Sign() const
+		{
+			if (components.empty())
+				return 0;
+			return components.back() > 0.0 ? 1 : -1;
+		}
+	};
+
+	//Robust geometric predicates on double precision points, after Shewchuk. Each predicate evaluates the determinant in
+	//floating point and checks it against a forward error bound; only when the bound cannot certify the sign is the
+	//determinant re-evaluated exactly with Expansions. The returned value always has the correct sign, and is an
+	//approximation of the determinant otherwise. The batched overloads run the filter as a branch-free loop over all
+	//queries, then evaluate the uncertain ones exactly, and return how many needed the exact stage.
+	class Predicates
+	{
+	private:
+		static constexpr double Epsilon = 0x1p-53;
+		static constexpr double Orient2DBound = (3.0 + 16.0 * Epsilon) * Epsilon;
+		static constexpr double Orient3DBound = (7.0 + 56.0 * Epsilon) * Epsilon;
+		static constexpr double InCircleBound = (10.0 + 96.0 * Epsilon) * Epsilon;
+		static constexpr double InSphereBound = (16.0 + 224.0 * Epsilon) * Epsilon;
+
+		//Filter stages; set certain to whether the sign of the returned determinant is guaranteed.
+		static inline double Orient2DFilter(const double2& a, const double2& b, const double2& c, bool& certain)
+		{
+			const double left = (a.x - c.x) * (b.y - c.y);
+			const double right = (a.y - c.y) * (b.x - c.x);
+			const double det = left - right;
+			certain = std::abs(det) >= Orient2DBound * (std::abs(left) + std::abs(right));
+			return det;
+		}
+		static inline double Orient3DFilter(const double3& a, const double3& b, const double3& c, const double3& d, bool& certain)
+		{
+			const double adx = a.x - d.x, ady = a.y - d.y, adz = a.z - d.z;
+			const double bdx = b.x - d.x, bdy = b.y - d.y, bdz = b.z - d.z;
+			const double cdx = c.x - d.x, cdy = c.y - d.y, cdz = c.z - d.z;
+			const double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+			const double cdxady = cdx * ady, adxcdy = adx * cdy;
+			const double adxbdy = adx * bdy, bdxady = bdx * ady;
+			const double det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+			const double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * std::abs(adz)
+				+ (std::abs(cdxady) + std::abs(adxcdy)) * std::abs(bdz)
+				+ (std::abs(adxbdy) + std::abs(bdxady)) * std::abs(cdz);
+			certain = std::abs(det) >= Orient3DBound * permanent;
+			return det;
+		}
+		static inline double InCircleFilter(const double2& a, const double2& b, const double2& c, const double2& d, bool& certain)
+		{
+			const double adx = a.x - d.x, ady = a.y - d.y;
+			const double bdx = b.x - d.x, bdy = b.y - d.y;
+			const double cdx = c.x - d.x, cdy = c.y - d.y;
+			const double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy, alift = adx * adx + ady * ady;
+			const double cdxady = cdx * ady, adxcdy = adx * cdy, blift = bdx * bdx + bdy * bdy;
+			const double adxbdy = adx * bdy, bdxady = bdx * ady, clift = cdx * cdx + cdy * cdy;
+			const double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+			const double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * alift
+				+ (std::abs(cdxady) + std::abs(adxcdy)) * blift
+				+ (std::abs(adxbdy) + std::abs(bdxady)) * clift;
+			certain = std::abs(det) >= InCircleBound * permanent;
+			return det;
+		}
+		static inline double InSphereFilter(const double3& a, const double3& b, const double3& c, const double3& d, const double3& e, bool& certain)
+		{
+			const double aex = a.x - e.x, aey = a.y - e.y, aez = a.z - e.z;
+			const double bex = b.x - e.x, bey = b.y - e.y, bez = b.z - e.z;
+			const double cex = c.x - e.x, cey = c.y - e.y, cez = c.z - e.z;
+			const double dex = d.x - e.x, dey = d.y - e.y, dez = d.z - e.z;
+
+			const double aexbey = aex * bey, bexaey = bex * aey;
+			const double bexcey = bex * cey, cexbey = cex * bey;
+			const double cexdey = cex * dey, dexcey = dex * cey;
+			const double dexaey = dex * aey, aexdey = aex * dey;
+			const double aexcey = aex * cey, cexaey = cex * aey;
+			const double bexdey = bex * dey, dexbey = dex * bey;
+			const double ab = aexbey - bexaey, bc = bexcey - cexbey, cd = cexdey - dexcey;
+			const double da = dexaey - aexdey, ac = aexcey - cexaey, bd = bexdey - dexbey;
+
+			const double abc = aez * bc - bez * ac + cez * ab;
+			const double bcd = bez * cd - cez * bd + dez * bc;
+			const double cda = cez * da + dez * ac + aez * cd;
+			const double dab = dez * ab + aez * bd + bez * da;
+			const double alift = aex * aex + aey * aey + aez * aez;
+			const double blift = bex * bex + bey * bey + bez * bez;
+			const double clift = cex * cex + cey * cey + cez * cez;
+			const double dlift = dex * dex + dey * dey + dez * dez;
+			const double det = (dlift * abc - clift * dab) + (blift * cda - alift * bcd);
+
+			const double aezPlus = std::abs(aez), bezPlus = std::abs(bez), cezPlus = std::abs(cez), dezPlus = std::abs(dez);
+			const double abPlus = std::abs(aexbey) + std::abs(bexaey), bcPlus = std::abs(bexcey) + std::abs(cexbey);
+			const double cdPlus = std::abs(cexdey) + std::abs(dexcey), daPlus = std::abs(dexaey) + std::abs(aexdey);
+			const double acPlus = std::abs(aexcey) + std::abs(cexaey), bdPlus = std::abs(bexdey) + std::abs(dexbey);
+			const double permanent = (cdPlus * bezPlus + bdPlus * cezPlus + bcPlus * dezPlus) * alift
+				+ (daPlus * cezPlus + acPlus * dezPlus + cdPlus * aezPlus) * blift
+				+ (abPlus * dezPlus + bdPlus * aezPlus + daPlus * bezPlus) * clift
+				+ (bcPlus * aezPlus + acPlus * bezPlus + abPlus * cezPlus) * dlift;
+			certain = std::abs(det) >= InSphereBound * permanent;
+			return det;
+		}
+
+		//Exact stages, evaluating the same determinants on exact coordinate differences.
+		static Expansion Orient2DExact(const double2& a, const double2& b, const double2& c)
+		{
+			const Expansion acx = Expansion::Difference(a.x, c.x), acy = Expansion::Difference(a.y, c.y);
+			const Expansion bcx = Expansion::Difference(b.x, c.x), bcy = Expansion::Difference(b.y, c.y);
+			return acx * bcy - acy * bcx;
+		}
+		static Expansion Orient3DExact(const double3& a, const double3& b, const double3& c, const double3& d)
+		{
+			const Expansion adx = Expansion::Difference(a.x, d.x), ady = Expansion::Difference(a.y, d.y), adz = Expansion::Difference(a.z, d.z);
+			const Expansion bdx = Expansion::Difference(b.x, d.x), bdy = Expansion::Difference(b.y, d.y), bdz = Expansion::Difference(b.z, d.z);
+			const Expansion cdx = Expansion::Difference(c.x, d.x), cdy = Expansion::Difference(c.y, d.y), cdz = Expansion::Difference(c.z, d.z);
+			return adz * (bdx * cdy - cdx * bdy) + bdz * (cdx * ady - adx * cdy) + cdz * (adx * bdy - bdx * ady);
+		}
+		static Expansion InCircleExact(const double2& a, const double2& b, const double2& c, const double2& d)
+		{
+			const Expansion adx = Expansion::Difference(a.x, d.x), ady = Expansion::Difference(a.y, d.y);
+			const Expansion bdx = Expansion::Difference(b.x, d.x), bdy = Expansion::Difference(b.y, d.y);
+			const Expansion cdx = Expansion::Difference(c.x, d.x), cdy = Expansion::Difference(c.y, d.y);
+			const Expansion alift = adx * adx + ady * ady;
+			const Expansion blift = bdx * bdx + bdy * bdy;
+			const Expansion clift = cdx * cdx + cdy * cdy;
+			return alift * (bdx * cdy - cdx * bdy) + blift * (cdx * ady - adx * cdy) + clift * (adx * bdy - bdx * ady);
+		}
+		static Expansion InSphereExact(const double3& a, const double3& b, const double3& c, const double3& d, const double3& e)
+		{
+			const Expansion aex = Expansion::Difference(a.x, e.x), aey = Expansion::Difference(a.y, e.y), aez = Expansion::Difference(a.z, e.z);
+			const Expansion bex = Expansion::Difference(b.x, e.x), bey = Expansion::Difference(b.y, e.y), bez = Expansion::Difference(b.z, e.z);
+			const Expansion cex = Expansion::Difference(c.x, e.x), cey = Expansion::Difference(c.y, e.y), cez = Expansion::Difference(c.z, e.z);
+			const Expansion dex = Expansion::Difference(d.x, e.x), dey = Expansion::Difference(d.y, e.y), dez = Expansion::Difference(d.z, e.z);
+
+			const Expansion ab = aex * bey - bex * aey, bc = bex * cey - cex * bey, cd = cex * dey - dex * cey;
+			const Expansion da = dex * aey - aex * dey, ac = aex * cey - cex * aey, bd = bex * dey - dex * bey;
+			const Expansion abc = aez * bc - bez * ac + cez * ab;
+			const Expansion bcd = bez * cd - cez * bd + dez * bc;
+			const Expansion cda = cez * da + dez * ac + aez * cd;
+			const Expansion dab = dez * ab + aez * bd + bez * da;
+			const Expansion alift = aex * aex + aey * aey + aez * aez;
+			const Expansion blift = bex * bex + bey * bey + bez * bez;
+			const Expansion clift = cex * cex + cey * cey + cez * cez;
+			const Expansion dlift = dex * dex + dey * dey + dez * dez;
+			return (dlift * abc - clift * dab) + (blift * cda - alift * bcd);
+		}
+
+		//Runs filter(idx, certain) over count queries, then replaces the uncertain results with exact(idx). Returns the number of exact evaluations.
+		template<typename FilterFunc, typename ExactFunc>
+		static size_t RunBatch(size_t count, std::span<double> results, FilterFunc&& filter, ExactFunc&& exact)
+		{
+			constexpr size_t BlockSize = 256;
+			size_t exactCount = 0;
+			for (size_t base = 0; base < count; base += BlockSize)
+			{
+				const size_t blockCount = std::min(BlockSize, count - base);
+				bool certain[BlockSize];
+				for (size_t idx = 0; idx < blockCount; idx++)
+					results[base + idx] = filter(base + idx, certain[idx]);
+				for (size_t idx = 0; idx < blockCount; idx++)
+				{
+					if (!certain[idx])
+					{
+						results[base + idx] = exact(base + idx).Estimate();
+						exactCount++;
+					}
+				}
+			}
+			return exactCount;
+		}
+
+	public:
+		//Returns a positive value if a, b, c are in counterclockwise order, negative if clockwise, and 0 if collinear.
+		static double Orient2D(const double2& a, const double2& b, const double2& c)
+		{
+			bool certain;
+			const double det = Orient2DFilter(a, b, c, certain);
+			return certain ? det : Orient2DExact(a, b, c).Estimate();
+		}
+		//Returns a positive value if d lies below the plane through a, b, c, where a, b, c appear counterclockwise seen from above;
+		//negative if above, and 0 if coplanar.
+		static double Orient3D(const double3& a, const double3& b, const double3& c, const double3& d)
+		{
+			bool certain;
+			const double det = Orient3DFilter(a, b, c, d, certain);
+			return certain ? det : Orient3DExact(a, b, c, d).Estimate();
+		}
+		//Returns a positive value if d lies inside the circle through the counterclockwise a, b, c; negative if outside, and 0 if cocircular.
+		static double InCircle(const double2& a, const double2& b, const double2& c, const double2& d)
+		{
+			bool certain;
+			const double det = InCircleFilter(a, b, c, d, certain);
+			return certain ? det : InCircleExact(a, b, c, d).Estimate();
+		}
+		//Returns a positive value if e lies inside the sphere through a, b, c, d (with Orient3D(a, b, c, d) > 0); negative if outside, and 0 if cospherical.
+		static double InSphere(const double3& a, const double3& b, const double3& c, const double3& d, const double3& e)
+		{
+			bool certain;
+			const double det = InSphereFilter(a, b, c, d, e, certain);
+			return certain ? det : InSphereExact(a, b, c, d, e).Estimate();
+		}
+
+		//Evaluates Orient2D for min of all the span sizes queries. Returns the number of queries that needed the exact stage.
+		static size_t Orient2D(std::span<const double2> a, std::span<const double2> b, std::span<const double2> c, std::span<double> results)
+		{
+			const size_t count = std::min({ a.size(), b.size(), c.size(), results.size() });
+			return RunBatch(count, results,
+				[&](size_t idx, bool& certain) { return Orient2DFilter(a[idx], b[idx], c[idx], certain); },
+				[&](size_t idx) { return Orient2DExact(a[idx], b[idx], c[idx]); });
+		}
+		//Evaluates Orient3D for min of all the span sizes queries. Returns the number of queries that needed the exact stage.
+		static size_t Orient3D(std::span<const double3> a, std::span<const double3> b, std::span<const double3> c, std::span<const double3> d, std::span<double> results)
+		{
+			const size_t count = std::min({ a.size(), b.size(), c.size(), d.size(), results.size() });
+			return RunBatch(count, results,
+				[&](size_t idx, bool& certain) { return Orient3DFilter(a[idx], b[idx], c[idx], d[idx], certain); },
+				[&](size_t idx) { return Orient3DExact(a[idx], b[idx], c[idx], d[idx]); });
+		}
+		//Evaluates InCircle for min of all the span sizes queries. Returns the number of queries that needed the exact stage.
+		static size_t InCircle(std::span<const double2> a, std::span<const double2> b, std::span<const double2> c, std::span<const double2> d, std::span<double> results)
+		{
+			const size_t count = std::min({ a.size(), b.size(), c.size(), d.size(), results.size() });
+			return RunBatch(count, results,
+				[&](size_t idx, bool& certain) { return InCircleFilter(a[idx], b[idx], c[idx], d[idx], certain); },
+				[&](size_t idx) { return InCircleExact(a[idx], b[idx], c[idx], d[idx]); });
+		}
+		//Evaluates InSphere for min of all the span sizes queries. Returns the number of queries that needed the exact stage.
+		static size_t InSphere(std::span<const double3> a, std::span<const double3> b, std::span<const double3> c, std::span<const double3> d, std::span<const double3> e, std::span<double> results)
+		{
+			const size_t count = std::min({ a.size(), b.size(), c.size(), d.size(), e.size(), results.size() });
+			return RunBatch(count, results,
+				[&](size_t idx, bool& certain) { return InSphereFilter(a[idx], b[idx], c[idx], d[idx], e[idx], certain); },
+				[&](size_t idx) { return InSphereExact(a[idx], b[idx], c[idx], d[idx], e[idx]); });
+		}
+	};
+}
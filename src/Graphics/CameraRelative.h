@@ -0,0 +1,140 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Matrix/Matrix4.h"
+#include "../Other/Parallel.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector3.h"
+
+namespace mars
+{
+	//Camera-relative rendering for worlds whose positions and transforms are stored in double. Everything is moved so that the
+	//camera origin is at 0 while still in double, and only then narrowed to float, so the float results keep their precision near
+	//the camera however far it is from the world origin. Transforms map column vectors: the translation is in d, h, l.
+	class CameraRelative
+	{
+	private:
+		static constexpr size_t BlockSize = 64;
+
+		template<StorageOrder O>
+		static Matrix4<float, O> Narrow(const Matrix4<double, O>& m)
+		{
+			return Matrix4<float, O>(static_cast<float>(m.a), static_cast<float>(m.b), static_cast<float>(m.c), static_cast<float>(m.d),
+				static_cast<float>(m.e), static_cast<float>(m.f), static_cast<float>(m.g), static_cast<float>(m.h),
+				static_cast<float>(m.i), static_cast<float>(m.j), static_cast<float>(m.k), static_cast<float>(m.l),
+				static_cast<float>(m.m), static_cast<float>(m.n), static_cast<float>(m.o), static_cast<float>(m.p));
+		}
+
+	public:
+		//Returns Translation(-origin) * world in double, i.e. the world transform with the origin moved to the camera origin.
+		template<StorageOrder O>
+		static Matrix4<double, O> RelativeWorld(const Matrix4<double, O>& world, const double3& origin)
+		{
+			Matrix4<double, O> result = world;
+			result.a -= origin.x * world.m; result.b -= origin.x * world.n; result.c -= origin.x * world.o; result.d -= origin.x * world.p;
+			result.e -= origin.y * world.m; result.f -= origin.y * world.n; result.g -= origin.y * world.o; result.h -= origin.y * world.p;
+			result.i -= origin.z * world.m; result.j -= origin.z * world.n; result.k -= origin.z * world.o; result.l -= origin.z * world.p;
+			return result;
+		}
+		//Returns view * Translation(origin) in double, the view transform of camera-relative positions. With the camera position as the origin, the translation is 0.
+		template<StorageOrder O>
+		static Matrix4<double, O> RelativeView(const Matrix4<double, O>& view, const double3& origin)
+		{
+			Matrix4<double, O> result = view;
+			result.d += view.a * origin.x + view.b * origin.y + view.c * origin.z;
+			result.h += view.e * origin.x + view.f * origin.y + view.g * origin.z;
+			result.l += view.i * origin.x + view.j * origin.y + view.k * origin.z;
+			result.p += view.m * origin.x + view.n * origin.y + view.o * origin.z;
+			return result;
+		}
+
+		//Returns the camera-relative world transform narrowed to float.
+		template<StorageOrder O>
+		static Matrix4<float, O> WorldToFloat(const Matrix4<double, O>& world, const double3& origin)
+		{
+			return Narrow(RelativeWorld(world, origin));
+		}
+		//Returns the camera-relative view transform narrowed to float.
+		template<StorageOrder O>
+		static Matrix4<float, O> ViewToFloat(const Matrix4<double, O>& view, const double3& origin)
+		{
+			return Narrow(RelativeView(view, origin));
+		}
+		//Returns the model-view transform, view * world, multiplied in double with both made camera-relative, narrowed to float.
+		template<StorageOrder O>
+		static Matrix4<float, O> ModelViewToFloat(const Matrix4<double, O>& world, const Matrix4<double, O>& view, const double3& origin)
+		{
+			return Narrow(Matrix4<double, O>(RelativeView(view, origin) * RelativeWorld(world, origin)));
+		}
+
+		//Writes the camera-relative world transforms narrowed to float into outputs. Processes min(worlds.size(), outputs.size()) transforms.
+		template<StorageOrder O>
+		static void WorldToFloat(std::span<const Matrix4<double, O>> worlds, const double3& origin, std::span<Matrix4<float, O>> outputs, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			const size_t count = std::min(worlds.size(), outputs.size());
+			Parallel::For(policy, count, Parallel::GetChunkSize(count, 1024), [&](size_t begin, size_t end)
+			{
+				for (size_t idx = begin; idx < end; idx++)
+					outputs[idx] = WorldToFloat(worlds[idx], origin);
+			});
+		}
+		//Writes the model-view transforms, see ModelViewToFloat, into outputs. Processes min(worlds.size(), outputs.size()) transforms.
+		template<StorageOrder O>
+		static void ModelViewToFloat(std::span<const Matrix4<double, O>> worlds, const Matrix4<double, O>& view, const double3& origin, std::span<Matrix4<float, O>> outputs, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			const Matrix4<double, O> relativeView = RelativeView(view, origin);
+			const size_t count = std::min(worlds.size(), outputs.size());
+			Parallel::For(policy, count, Parallel::GetChunkSize(count, 1024), [&](size_t begin, size_t end)
+			{
+				for (size_t idx = begin; idx < end; idx++)
+					outputs[idx] = Narrow(Matrix4<double, O>(relativeView * RelativeWorld(worlds[idx], origin)));
+			});
+		}
+
+		//Writes position - origin, subtracted in double and narrowed to float, into outputs. Processes min(positions.size(), outputs.size()) positions.
+		static void PositionsToFloat(std::span<const double3> positions, const double3& origin, std::span<float3> outputs, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			const size_t count = std::min(positions.size(), outputs.size());
+			Parallel::For(policy, count, Parallel::GetChunkSize(count, 4096), [&](size_t begin, size_t end)
+			{
+				if (policy == ExecutionPolicy::Sequential)
+				{
+					for (size_t idx = begin; idx < end; idx++)
+					{
+						const double3& p = positions[idx];
+						outputs[idx] = float3(static_cast<float>(p.x - origin.x), static_cast<float>(p.y - origin.y), static_cast<float>(p.z - origin.z));
+					}
+					return;
+				}
+
+				//Transpose each block to SoA, subtract and narrow whole registers, then interleave again.
+				for (size_t base = begin; base < end; base += BlockSize)
+				{
+					const size_t blockCount = std::min(BlockSize, end - base);
+					double x[BlockSize], y[BlockSize], z[BlockSize];
+					for (size_t idx = 0; idx < blockCount; idx++)
+					{
+						x[idx] = positions[base + idx].x;
+						y[idx] = positions[base + idx].y;
+						z[idx] = positions[base + idx].z;
+					}
+					float rx[BlockSize], ry[BlockSize], rz[BlockSize];
+					for (size_t idx = 0; idx < blockCount; idx++)
+					{
+						rx[idx] = static_cast<float>(x[idx] - origin.x);
+						ry[idx] = static_cast<float>(y[idx] - origin.y);
+						rz[idx] = static_cast<float>(z[idx] - origin.z);
+					}
+					for (size_t idx = 0; idx < blockCount; idx++)
+						outputs[base + idx] = float3(rx[idx], ry[idx], rz[idx]);
+				}
+			});
+		}
+		//Transforms object-space float vertices by the camera-relative world transform, computed in double and narrowed once, into outputs.
+		//Processes min(vertices.size(), outputs.size()) vertices.
+		template<StorageOrder O>
+		static void VerticesToFloat(const Matrix4<double, O>& world, const double3& origin, std::span<const float3> vertices, std::span<float3> outputs, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			Matrix4<float, O>::TransformPoints(WorldToFloat(world, origin), vertices, outputs, policy);
+		}
+	};
+}
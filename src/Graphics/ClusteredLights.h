@@ -0,0 +1,302 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Geometry/AABB.h"
+#include "../Matrix/Matrix4.h"
+#include "../Other/Parallel.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector3.h"
+#include "../Vector/Vector4.h"
+#include <vector>
+
+namespace mars
+{
+	//Point light for clustered shading, in world space.
+	struct ClusterPointLight
+	{
+		float3 position;
+		float radius;
+	};
+
+	//Spot light for clustered shading, in world space. angle is the outer half-angle of the cone in radians.
+	struct ClusterSpotLight
+	{
+		float3 position;
+		float range;
+		float3 direction;
+		float angle;
+	};
+
+	//Clustered (froxel) light assignment for forward+ shading. The view frustum of a perspective projection is divided into
+	//tilesX x tilesY screen tiles and slices exponentially spaced depth slices; each froxel is bounded by a view-space AABB.
+	//Assign tests every light against the froxels of each slice in parallel, with branch-free sphere-AABB and cone-sphere tests over SoA
+	//arrays of lights, and stores the light indices of every cluster as compressed rows. Tile (x, y) covers NDC
+	//x in [-1 + 2x / tilesX, -1 + 2(x + 1) / tilesX], and likewise for y from the bottom (-1) up.
+	class ClusteredLights
+	{
+	private:
+		uint32_t m_TilesX, m_TilesY, m_Slices;
+		float m_ZNear, m_ZFar;
+		float m_LogScale;
+		std::vector<floatAABB> m_Froxels;
+		std::vector<floatAABB> m_SliceBounds;
+		std::vector<uint32_t> m_Offsets;
+		std::vector<uint32_t> m_Indices;
+
+		//Lights in view space, one array per component. Point lights have a cone that always passes.
+		struct LightSoA
+		{
+			std::vector<float> x, y, z, radius, dirX, dirY, dirZ, cosAngle, sinAngle;
+
+			void Resize(size_t count)
+			{
+				for (std::vector<float>* component : { &x, &y, &z, &radius, &dirX, &dirY, &dirZ, &cosAngle, &sinAngle })
+					component->resize(count);
+			}
+		};
+
+		inline float GetSliceDepth(uint32_t slice) const
+		{
+			return m_ZNear * std::pow(m_ZFar / m_ZNear, static_cast<float>(slice) / static_cast<float>(m_Slices));
+		}
+
+	public:
+		//Constructs a ClusteredLights of tilesX x tilesY x slices clusters. Call Build before Assign.
+		ClusteredLights(uint32_t tilesX = 16, uint32_t tilesY = 9, uint32_t slices = 24)
+			: m_TilesX(std::max(tilesX, 1u)), m_TilesY(std::max(tilesY, 1u)), m_Slices(std::max(slices, 1u)), m_ZNear(0), m_ZFar(0), m_LogScale(0) {}
+
+		//Destructs the ClusteredLights.
+		~ClusteredLights() {}
+
+		//Builds the froxel bounds of the perspective projection, slicing the view distances from zNear to zFar. The projection may be reverse-Z,
+		//infinite or right-handed, as built by Perspective, PerspectiveOffset or InfinitePerspective. Returns false, leaving no froxels,
+		//if the projection is not perspective or 0 < zNear < zFar does not hold.
+		template<StorageOrder O>
+		bool Build(const Matrix4<float, O>& projection, float zNear, float zFar)
+		{
+			m_Froxels.clear();
+			m_SliceBounds.clear();
+			if (projection.p != 0 || !(zNear > 0) || !(zFar > zNear))
+				return false;
+
+			m_ZNear = zNear;
+			m_ZFar = zFar;
+			m_LogScale = static_cast<float>(m_Slices) / std::log(zFar / zNear);
+			const Matrix4<float, O> inverse = Matrix4<float, O>::InverseProjection(projection);
+
+			//View-space rays through the tile corners, scaled to a view distance of 1. Depth 0.5 is finite for every supported projection.
+			const uint32_t cornerCountX = m_TilesX + 1, cornerCountY = m_TilesY + 1;
+			std::vector<float3> rays(cornerCountX * cornerCountY);
+			for (uint32_t y = 0; y < cornerCountY; y++)
+			{
+				for (uint32_t x = 0; x < cornerCountX; x++)
+				{
+					const float4 ndc(-1.0f + 2.0f * x / m_TilesX, -1.0f + 2.0f * y / m_TilesY, 0.5f, 1.0f);
+					const float4 view = inverse * ndc;
+					const float scale = 1.0f / std::abs(view.z);
+					rays[y * cornerCountX + x] = float3(view.x * scale, view.y * scale, view.z * scale);
+				}
+			}
+
+			m_Froxels.resize(static_cast<size_t>(m_TilesX) * m_TilesY * m_Slices);
+			m_SliceBounds.resize(m_Slices);
+			Parallel::For(m_Slices, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t slice = begin; slice < end; slice++)
+				{
+					const float nearDepth = GetSliceDepth(static_cast<uint32_t>(slice));
+					const float farDepth = GetSliceDepth(static_cast<uint32_t>(slice + 1));
+					floatAABB sliceBounds;
+					for (uint32_t y = 0; y < m_TilesY; y++)
+					{
+						for (uint32_t x = 0; x < m_TilesX; x++)
+						{
+							floatAABB froxel;
+							for (uint32_t corner = 0; corner < 4; corner++)
+							{
+								const float3& ray = rays[(y + (corner >> 1)) * cornerCountX + x + (corner & 1)];
+								froxel.Merge(ray * nearDepth);
+								froxel.Merge(ray * farDepth);
+							}
+							m_Froxels[GetClusterIndex(x, y, static_cast<uint32_t>(slice))] = froxel;
+							sliceBounds.Merge(froxel);
+						}
+					}
+					m_SliceBounds[slice] = sliceBounds;
+				}
+			});
+			return true;
+		}
+
+		//Assigns the lights to the clusters. Light indices are [0, pointLights.size()) for the point lights, then the spot lights follow.
+		//view is the world-to-view transform that the projection given to Build is used with. Does nothing if Build has not succeeded.
+		template<StorageOrder O>
+		void Assign(const Matrix4<float, O>& view, std::span<const ClusterPointLight> pointLights, std::span<const ClusterSpotLight> spotLights)
+		{
+			m_Offsets.assign(m_Froxels.size() + 1, 0);
+			m_Indices.clear();
+			if (m_Froxels.empty())
+				return;
+
+			//Move the lights into view space.
+			const size_t lightCount = pointLights.size() + spotLights.size();
+			LightSoA lights;
+			lights.Resize(lightCount);
+			Parallel::For(lightCount, Parallel::GetChunkSize(lightCount, 1024), [&](size_t begin, size_t end)
+			{
+				for (size_t idx = begin; idx < end; idx++)
+				{
+					const bool spot = idx >= pointLights.size();
+					const float3& position = spot ? spotLights[idx - pointLights.size()].position : pointLights[idx].position;
+					lights.x[idx] = view.a * position.x + view.b * position.y + view.c * position.z + view.d;
+					lights.y[idx] = view.e * position.x + view.f * position.y + view.g * position.z + view.h;
+					lights.z[idx] = view.i * position.x + view.j * position.y + view.k * position.z + view.l;
+					if (!spot)
+					{
+						lights.radius[idx] = pointLights[idx].radius;
+						lights.dirX[idx] = lights.dirY[idx] = 0.0f;
+						lights.dirZ[idx] = 1.0f;
+						lights.cosAngle[idx] = -1.0f;
+						lights.sinAngle[idx] = 0.0f;
+						continue;
+					}
+					const ClusterSpotLight& light = spotLights[idx - pointLights.size()];
+					const float3 direction(view.a * light.direction.x + view.b * light.direction.y + view.c * light.direction.z,
+						view.e * light.direction.x + view.f * light.direction.y + view.g * light.direction.z,
+						view.i * light.direction.x + view.j * light.direction.y + view.k * light.direction.z);
+					const float3 unit = float3::Normalise(direction);
+					lights.radius[idx] = light.range;
+					lights.dirX[idx] = unit.x;
+					lights.dirY[idx] = unit.y;
+					lights.dirZ[idx] = unit.z;
+					lights.cosAngle[idx] = std::cos(light.angle);
+					lights.sinAngle[idx] = std::sin(light.angle);
+				}
+			});
+
+			const size_t froxelsPerSlice = static_cast<size_t>(m_TilesX) * m_TilesY;
+			std::vector<std::vector<uint32_t>> sliceIndices(m_Slices);
+			Parallel::For(m_Slices, 1, [&](size_t begin, size_t end)
+			{
+				LightSoA candidates;
+				std::vector<uint32_t> candidateIndices;
+				std::vector<uint32_t> mask;
+				for (size_t slice = begin; slice < end; slice++)
+				{
+					//Keep the lights whose bounding sphere touches the slice.
+					const floatAABB& bounds = m_SliceBounds[slice];
+					candidateIndices.clear();
+					for (size_t idx = 0; idx < lightCount; idx++)
+					{
+						const float dx = std::max({ bounds.minimum.x - lights.x[idx], 0.0f, lights.x[idx] - bounds.maximum.x });
+						const float dy = std::max({ bounds.minimum.y - lights.y[idx], 0.0f, lights.y[idx] - bounds.maximum.y });
+						const float dz = std::max({ bounds.minimum.z - lights.z[idx], 0.0f, lights.z[idx] - bounds.maximum.z });
+						if (dx * dx + dy * dy + dz * dz <= lights.radius[idx] * lights.radius[idx])
+							candidateIndices.push_back(static_cast<uint32_t>(idx));
+					}
+					const size_t candidateCount = candidateIndices.size();
+					candidates.Resize(candidateCount);
+					mask.resize(candidateCount);
+					for (size_t idx = 0; idx < candidateCount; idx++)
+					{
+						const uint32_t light = candidateIndices[idx];
+						candidates.x[idx] = lights.x[light];
+						candidates.y[idx] = lights.y[light];
+						candidates.z[idx] = lights.z[light];
+						candidates.radius[idx] = lights.radius[light];
+						candidates.dirX[idx] = lights.dirX[light];
+						candidates.dirY[idx] = lights.dirY[light];
+						candidates.dirZ[idx] = lights.dirZ[light];
+						candidates.cosAngle[idx] = lights.cosAngle[light];
+						candidates.sinAngle[idx] = lights.sinAngle[light];
+					}
+
+					std::vector<uint32_t>& output = sliceIndices[slice];
+					for (size_t froxelIndex = 0; froxelIndex < froxelsPerSlice; froxelIndex++)
+					{
+						const size_t cluster = slice * froxelsPerSlice + froxelIndex;
+						const floatAABB& froxel = m_Froxels[cluster];
+						const float3 minimum = froxel.minimum, maximum = froxel.maximum;
+						const float3 center = froxel.GetCenter();
+						const float3 half = froxel.GetHalfExtents();
+						const float froxelRadius = half.Length<float>();
+
+						//Sphere against the froxel AABB, and the cone against the froxel's bounding sphere (Wronski). The loop vectorises: every
+						//test is a 32-bit integer combined with & and |, and the clamps are (v + |v|) / 2 rather than float max, which is a branch.
+						const auto positive = [](float v) { return (v + std::abs(v)) * 0.5f; };
+						for (size_t idx = 0; idx < candidateCount; idx++)
+						{
+							//At most one side of each axis is positive, so the sum is the clamped distance outside the box.
+							const float dx = positive(minimum.x - candidates.x[idx]) + positive(candidates.x[idx] - maximum.x);
+							const float dy = positive(minimum.y - candidates.y[idx]) + positive(candidates.y[idx] - maximum.y);
+							const float dz = positive(minimum.z - candidates.z[idx]) + positive(candidates.z[idx] - maximum.z);
+							const uint32_t sphere = dx * dx + dy * dy + dz * dz <= candidates.radius[idx] * candidates.radius[idx];
+
+							//The cone passes if along >= -froxelRadius and cosAngle * sqrt(distanceSq) - along * sinAngle <= froxelRadius, with
+							//distanceSq the squared distance of the center from the axis. The first makes limit = froxelRadius + along * sinAngle
+							//non-negative, so the second always holds for cones wider than a half-space and otherwise compares the squares; a
+							//distanceSq rounded below zero passes as zero would.
+							const float vx = center.x - candidates.x[idx], vy = center.y - candidates.y[idx], vz = center.z - candidates.z[idx];
+							const float along = vx * candidates.dirX[idx] + vy * candidates.dirY[idx] + vz * candidates.dirZ[idx];
+							const float distanceSq = vx * vx + vy * vy + vz * vz - along * along;
+							const float cosAngle = candidates.cosAngle[idx];
+							const float limit = froxelRadius + along * candidates.sinAngle[idx];
+							const uint32_t closest = static_cast<uint32_t>(cosAngle < 0.0f) | static_cast<uint32_t>(cosAngle * cosAngle * distanceSq <= limit * limit);
+							const uint32_t cone = static_cast<uint32_t>(cosAngle <= -1.0f) | (static_cast<uint32_t>(along >= -froxelRadius) & closest);
+							mask[idx] = sphere & cone;
+						}
+
+						uint32_t count = 0;
+						for (size_t idx = 0; idx < candidateCount; idx++)
+						{
+							if (mask[idx])
+							{
+								output.push_back(candidateIndices[idx]);
+								count++;
+							}
+						}
+						m_Offsets[cluster + 1] = count;
+					}
+				}
+			});
+
+			for (size_t cluster = 0; cluster < m_Froxels.size(); cluster++)
+				m_Offsets[cluster + 1] += m_Offsets[cluster];
+			m_Indices.resize(m_Offsets.back());
+			Parallel::For(m_Slices, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t slice = begin; slice < end; slice++)
+					std::copy(sliceIndices[slice].begin(), sliceIndices[slice].end(), m_Indices.begin() + m_Offsets[slice * froxelsPerSlice]);
+			});
+		}
+
+		//Returns the cluster index of tile (x, y) in slice z.
+		inline size_t GetClusterIndex(uint32_t x, uint32_t y, uint32_t z) const
+		{
+			return (static_cast<size_t>(z) * m_TilesY + y) * m_TilesX + x;
+		}
+		//Returns the slice containing the view distance, clamped to the slices.
+		uint32_t GetSlice(float viewDistance) const
+		{
+			if (!(viewDistance > m_ZNear))
+				return 0;
+			return std::min(static_cast<uint32_t>(std::log(viewDistance / m_ZNear) * m_LogScale), m_Slices - 1);
+		}
+		//Returns the indices of the lights assigned to the cluster.
+		std::span<const uint32_t> GetLights(size_t cluster) const
+		{
+			if (cluster + 1 >= m_Offsets.size())
+				return {};
+			return std::span<const uint32_t>(m_Indices).subspan(m_Offsets[cluster], m_Offsets[cluster + 1] - m_Offsets[cluster]);
+		}
+
+		inline uint32_t GetTilesX() const { return m_TilesX; }
+		inline uint32_t GetTilesY() const { return m_TilesY; }
+		inline uint32_t GetSlices() const { return m_Slices; }
+		inline size_t GetClusterCount() const { return m_Froxels.size(); }
+		//Returns the view-space bounds of the cluster.
+		inline const floatAABB& GetFroxel(size_t cluster) const { return m_Froxels[cluster]; }
+		//Returns the light lists as compressed rows: the lights of cluster c are GetIndices()[GetOffsets()[c]] to GetIndices()[GetOffsets()[c + 1] - 1].
+		inline std::span<const uint32_t> GetOffsets() const { return m_Offsets; }
+		inline std::span<const uint32_t> GetIndices() const { return m_Indices; }
+	};
+}
@@ -0,0 +1,363 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Geometry/AABB.h"
+#include "../Matrix/Matrix4.h"
+#include "../Other/Parallel.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector3.h"
+#include "../Vector/Vector4.h"
+#include <atomic>
+#include <limits>
+#include <vector>
+
+namespace mars
+{
+	//Low-resolution software depth buffer for occlusion culling on the CPU. Occluder triangles are transformed by a view-projection,
+	//clipped against the near plane, binned into screen tiles and rasterised tile by tile in parallel, with the pixels of
+	//a row evaluated Lanes at a time without branches. A hierarchical Z-buffer of the farthest depth per 2x2 block then answers
+	//AABB queries with a few reads. Depth follows the projection conventions of Matrix4 (NDC depth 0 to 1, or 1 to 0 with reverseZ);
+	//internally it is stored so that smaller is nearer.
+	class OcclusionBuffer
+	{
+	public:
+		static constexpr uint32_t TileSize = 32;
+		static constexpr uint32_t Lanes = 8;
+
+	private:
+		//Vertices closer to the camera plane than this w are clipped.
+		static constexpr float MinW = 1e-5f;
+
+		//Screen-space triangle: pixel coordinates and depth (smaller is nearer) of the vertices, with its pixel bounds.
+		struct Triangle
+		{
+			float x[3], y[3], depth[3];
+			int32_t minX, minY, maxX, maxY;
+		};
+
+		uint32_t m_Width, m_Height;
+		uint32_t m_TilesX, m_TilesY;
+		bool m_ReverseZ;
+		std::vector<float> m_Depth;
+		//m_HiZ[0] is the depth buffer at half resolution, each level after it half of the one before, storing the farthest depth of each 2x2 block.
+		std::vector<std::vector<float>> m_HiZ;
+		std::vector<uint32_t> m_HiZWidth, m_HiZHeight;
+
+		template<StorageOrder O>
+		static float4 ToClip(const Matrix4<float, O>& m, const float3& p)
+		{
+			return float4(m.a * p.x + m.b * p.y + m.c * p.z + m.d, m.e * p.x + m.f * p.y + m.g * p.z + m.h,
+				m.i * p.x + m.j * p.y + m.k * p.z + m.l, m.m * p.x + m.n * p.y + m.o * p.z + m.p);
+		}
+
+		//Projects a clip-space vertex with w >= MinW to pixel coordinates and depth.
+		inline void ToScreen(const float4& clip, float& x, float& y, float& depth) const
+		{
+			const float invW = 1.0f / clip.w;
+			x = (clip.x * invW * 0.5f + 0.5f) * static_cast<float>(m_Width);
+			y = (clip.y * invW * 0.5f + 0.5f) * static_cast<float>(m_Height);
+			depth = m_ReverseZ ? 1.0f - clip.z * invW : clip.z * invW;
+		}
+
+		//Clips the polygon against the plane where distance(vertex) >= 0, writing the result to output. Returns the output vertex count.
+		template<typename F>
+		static size_t ClipPolygon(const float4* input, size_t count, float4* output, F&& distance)
+		{
+			size_t outputCount = 0;
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				const float4& a = input[idx];
+				const float4& b = input[(idx + 1) % count];
+				const float da = distance(a), db = distance(b);
+				if (da >= 0.0f)
+					output[outputCount++] = a;
+				if ((da >= 0.0f) != (db >= 0.0f))
+				{
+					const float t = da / (da - db);
+					output[outputCount++] = float4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
+				}
+			}
+			return outputCount;
+		}
+
+		//Clips the clip-space triangle against the near plane (z >= 0, or z <= w with reverseZ) and w >= MinW, which only cuts
+		//anything for degenerate projections, and appends the visible, non-degenerate screen triangles.
+		void SetupTriangle(const float4 (&clip)[3], std::vector<Triangle>& output) const
+		{
+			float4 nearClipped[4], polygon[5];
+			const bool reverseZ = m_ReverseZ;
+			size_t count = ClipPolygon(clip, 3, nearClipped, [reverseZ](const float4& v) { return reverseZ ? v.w - v.z : v.z; });
+			count = ClipPolygon(nearClipped, count, polygon, [](const float4& v) { return v.w - MinW; });
+
+			for (size_t fan = 1; fan + 1 < count; fan++)
+			{
+				Triangle triangle;
+				const float4* vertices[3] = { &polygon[0], &polygon[fan], &polygon[fan + 1] };
+				for (size_t idx = 0; idx < 3; idx++)
+					ToScreen(*vertices[idx], triangle.x[idx], triangle.y[idx], triangle.depth[idx]);
+
+				const float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+				if (!(std::abs(area) > 0.0f))
+					continue;
+				//Make every triangle counter-clockwise, so occluders are two-sided.
+				if (area < 0.0f)
+				{
+					std::swap(triangle.x[1], triangle.x[2]);
+					std::swap(triangle.y[1], triangle.y[2]);
+					std::swap(triangle.depth[1], triangle.depth[2]);
+				}
+
+				//Pixels whose centers may be covered, clamped to the screen.
+				const float minX = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+				const float maxX = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+				const float minY = std::min({ triangle.y[0], triangle.y[1], triangle.y[2] });
+				const float maxY = std::max({ triangle.y[0], triangle.y[1], triangle.y[2] });
+				if (maxX < 0.0f || maxY < 0.0f || minX >= static_cast<float>(m_Width) || minY >= static_cast<float>(m_Height))
+					continue;
+				triangle.minX = std::max(static_cast<int32_t>(std::floor(minX - 0.5f)), 0);
+				triangle.minY = std::max(static_cast<int32_t>(std::floor(minY - 0.5f)), 0);
+				triangle.maxX = std::min(static_cast<int32_t>(std::ceil(maxX - 0.5f)), static_cast<int32_t>(m_Width) - 1);
+				triangle.maxY = std::min(static_cast<int32_t>(std::ceil(maxY - 0.5f)), static_cast<int32_t>(m_Height) - 1);
+				if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+					continue;
+				output.push_back(triangle);
+			}
+		}
+
+		//Rasterises the triangle into the pixels of the tile, keeping the nearest depth.
+		void RasterizeInTile(const Triangle& triangle, uint32_t tileX, uint32_t tileY)
+		{
+			const int32_t x0 = std::max(triangle.minX, static_cast<int32_t>(tileX * TileSize));
+			const int32_t x1 = std::min(triangle.maxX, static_cast<int32_t>((tileX + 1) * TileSize) - 1);
+			const int32_t y0 = std::max(triangle.minY, static_cast<int32_t>(tileY * TileSize));
+			const int32_t y1 = std::min(triangle.maxY, static_cast<int32_t>((tileY + 1) * TileSize) - 1);
+			if (x0 > x1 || y0 > y1)
+				return;
+
+			//Edge functions E(x, y) = A * x + B * y + C, positive inside, and the depth plane.
+			float edgeA[3], edgeB[3], edgeC[3];
+			for (size_t edge = 0; edge < 3; edge++)
+			{
+				const size_t next = (edge + 1) % 3;
+				edgeA[edge] = triangle.y[edge] - triangle.y[next];
+				edgeB[edge] = triangle.x[next] - triangle.x[edge];
+				edgeC[edge] = triangle.x[edge] * triangle.y[next] - triangle.x[next] * triangle.y[edge];
+			}
+			const float area = edgeC[0] + edgeC[1] + edgeC[2];
+			const float d10 = triangle.depth[1] - triangle.depth[0], d20 = triangle.depth[2] - triangle.depth[0];
+			const float depthA = (d10 * (triangle.y[2] - triangle.y[0]) - d20 * (triangle.y[1] - triangle.y[0])) / area;
+			const float depthB = (d20 * (triangle.x[1] - triangle.x[0]) - d10 * (triangle.x[2] - triangle.x[0])) / area;
+			const float depthC = triangle.depth[0] - depthA * triangle.x[0] - depthB * triangle.y[0];
+
+			//Whole lane groups from the tile's lane-aligned start; lanes outside [x0, x1] are masked off.
+			const int32_t groupStart = x0 - (x0 - static_cast<int32_t>(tileX * TileSize)) % static_cast<int32_t>(Lanes);
+			for (int32_t y = y0; y <= y1; y++)
+			{
+				const float py = static_cast<float>(y) + 0.5f;
+				float* row = &m_Depth[static_cast<size_t>(y) * m_Width];
+				for (int32_t group = groupStart; group <= x1; group += Lanes)
+				{
+					for (uint32_t lane = 0; lane < Lanes; lane++)
+					{
+						const int32_t x = group + static_cast<int32_t>(lane);
+						const float px = static_cast<float>(x) + 0.5f;
+						const bool inside = (x >= x0) & (x <= x1) &
+							(edgeA[0] * px + edgeB[0] * py + edgeC[0] >= 0.0f) &
+							(edgeA[1] * px + edgeB[1] * py + edgeC[1] >= 0.0f) &
+							(edgeA[2] * px + edgeB[2] * py + edgeC[2] >= 0.0f);
+						const float depth = std::max(depthA * px + depthB * py + depthC, 0.0f);
+						float& stored = row[x];
+						stored = inside ? std::min(stored, depth) : stored;
+					}
+				}
+			}
+		}
+
+		void BuildHiZ()
+		{
+			uint32_t width = m_Width, height = m_Height;
+			const std::vector<float>* source = &m_Depth;
+			for (size_t level = 0; level < m_HiZ.size(); level++)
+			{
+				const uint32_t levelWidth = m_HiZWidth[level], levelHeight = m_HiZHeight[level];
+				std::vector<float>& target = m_HiZ[level];
+				Parallel::For(levelHeight, 16, [&](size_t begin, size_t end)
+				{
+					for (size_t y = begin; y < end; y++)
+					{
+						const size_t y0 = std::min<size_t>(2 * y, height - 1), y1 = std::min<size_t>(2 * y + 1, height - 1);
+						for (size_t x = 0; x < levelWidth; x++)
+						{
+							const size_t x0 = std::min<size_t>(2 * x, width - 1), x1 = std::min<size_t>(2 * x + 1, width - 1);
+							target[y * levelWidth + x] = std::max({ (*source)[y0 * width + x0], (*source)[y0 * width + x1], (*source)[y1 * width + x0], (*source)[y1 * width + x1] });
+						}
+					}
+				});
+				source = &target;
+				width = levelWidth;
+				height = levelHeight;
+			}
+		}
+
+	public:
+		//Constructs an OcclusionBuffer. The size is rounded up to whole tiles.
+		OcclusionBuffer(uint32_t width = 256, uint32_t height = 128, bool reverseZ = false)
+			: m_ReverseZ(reverseZ)
+		{
+			m_TilesX = (std::max(width, 1u) + TileSize - 1) / TileSize;
+			m_TilesY = (std::max(height, 1u) + TileSize - 1) / TileSize;
+			m_Width = m_TilesX * TileSize;
+			m_Height = m_TilesY * TileSize;
+			m_Depth.assign(static_cast<size_t>(m_Width) * m_Height, 1.0f);
+
+			uint32_t levelWidth = m_Width, levelHeight = m_Height;
+			while (levelWidth > 1 || levelHeight > 1)
+			{
+				levelWidth = (levelWidth + 1) / 2;
+				levelHeight = (levelHeight + 1) / 2;
+				m_HiZWidth.push_back(levelWidth);
+				m_HiZHeight.push_back(levelHeight);
+				m_HiZ.emplace_back(static_cast<size_t>(levelWidth) * levelHeight, 1.0f);
+			}
+		}
+
+		//Destructs the OcclusionBuffer.
+		~OcclusionBuffer() {}
+
+		//Resets every pixel to the far plane.
+		void Clear()
+		{
+			std::fill(m_Depth.begin(), m_Depth.end(), 1.0f);
+			for (std::vector<float>& level : m_HiZ)
+				std::fill(level.begin(), level.end(), 1.0f);
+		}
+
+		//Rasterises the occluder triangles (three indices each) into the buffer and rebuilds the hierarchical Z-buffer.
+		//Triangles are two-sided. Indices must be smaller than vertices.size(); a trailing partial triangle is ignored.
+		template<StorageOrder O>
+		void RasterizeOccluders(const Matrix4<float, O>& viewProjection, std::span<const float3> vertices, std::span<const uint32_t> indices)
+		{
+			//Transform and set up the triangles in parallel chunks, binning each chunk's triangles by tile.
+			const size_t triangleCount = indices.size() / 3;
+			const size_t tileCount = static_cast<size_t>(m_TilesX) * m_TilesY;
+			const size_t chunkSize = Parallel::GetChunkSize(triangleCount, 1024);
+			const size_t chunkCount = (triangleCount + chunkSize - 1) / chunkSize;
+			std::vector<std::vector<Triangle>> chunkTriangles(chunkCount);
+			//A single-threaded For runs everything as chunk 0, so every chunk's bins exist even if it is never called.
+			std::vector<std::vector<std::vector<uint32_t>>> chunkBins(chunkCount, std::vector<std::vector<uint32_t>>(tileCount));
+			Parallel::For(triangleCount, chunkSize, [&](size_t begin, size_t end)
+			{
+				const size_t chunk = begin / chunkSize;
+				std::vector<Triangle>& triangles = chunkTriangles[chunk];
+				for (size_t triangle = begin; triangle < end; triangle++)
+				{
+					const float4 clip[3] = { ToClip(viewProjection, vertices[indices[3 * triangle]]),
+						ToClip(viewProjection, vertices[indices[3 * triangle + 1]]),
+						ToClip(viewProjection, vertices[indices[3 * triangle + 2]]) };
+					SetupTriangle(clip, triangles);
+				}
+
+				std::vector<std::vector<uint32_t>>& bins = chunkBins[chunk];
+				for (size_t idx = 0; idx < triangles.size(); idx++)
+				{
+					const Triangle& triangle = triangles[idx];
+					for (int32_t tileY = triangle.minY / static_cast<int32_t>(TileSize); tileY <= triangle.maxY / static_cast<int32_t>(TileSize); tileY++)
+					{
+						for (int32_t tileX = triangle.minX / static_cast<int32_t>(TileSize); tileX <= triangle.maxX / static_cast<int32_t>(TileSize); tileX++)
+							bins[static_cast<size_t>(tileY) * m_TilesX + tileX].push_back(static_cast<uint32_t>(idx));
+					}
+				}
+			});
+
+			//Each tile is owned by one thread, so the depth writes need no synchronisation.
+			Parallel::For(tileCount, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t tile = begin; tile < end; tile++)
+				{
+					const uint32_t tileX = static_cast<uint32_t>(tile % m_TilesX), tileY = static_cast<uint32_t>(tile / m_TilesX);
+					for (size_t chunk = 0; chunk < chunkCount; chunk++)
+					{
+						for (uint32_t idx : chunkBins[chunk][tile])
+							RasterizeInTile(chunkTriangles[chunk][idx], tileX, tileY);
+					}
+				}
+			});
+
+			BuildHiZ();
+		}
+
+		//Tests the boxes against the occluders rasterised with the same view-projection, writing 1 to visible for a box that may be
+		//visible and 0 for one that is hidden by the occluders or outside the screen. Boxes crossing the camera plane are visible.
+		//Processes min(boxes.size(), visible.size()) boxes and returns the number visible.
+		template<StorageOrder O>
+		size_t TestAABBs(const Matrix4<float, O>& viewProjection, std::span<const floatAABB> boxes, std::span<uint8_t> visible, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd) const
+		{
+			const size_t count = std::min(boxes.size(), visible.size());
+			std::atomic<size_t> visibleCount = 0;
+			Parallel::For(policy, count, Parallel::GetChunkSize(count, 256), [&](size_t begin, size_t end)
+			{
+				size_t localCount = 0;
+				for (size_t idx = begin; idx < end; idx++)
+				{
+					const uint8_t result = IsVisible(viewProjection, boxes[idx]) ? 1 : 0;
+					visible[idx] = result;
+					localCount += result;
+				}
+				visibleCount.fetch_add(localCount, std::memory_order_relaxed);
+			});
+			return visibleCount.load(std::memory_order_relaxed);
+		}
+		//Returns whether the box may be visible, see TestAABBs.
+		template<StorageOrder O>
+		bool IsVisible(const Matrix4<float, O>& viewProjection, const floatAABB& box) const
+		{
+			if (box.IsEmpty())
+				return false;
+
+			float minX = std::numeric_limits<float>::max(), minY = minX, nearest = minX;
+			float maxX = std::numeric_limits<float>::lowest(), maxY = maxX;
+			for (uint32_t corner = 0; corner < 8; corner++)
+			{
+				const float3 p((corner & 1) ? box.maximum.x : box.minimum.x, (corner & 2) ? box.maximum.y : box.minimum.y, (corner & 4) ? box.maximum.z : box.minimum.z);
+				const float4 clip = ToClip(viewProjection, p);
+				if (clip.w < MinW)
+					return true;
+				float x, y, depth;
+				ToScreen(clip, x, y, depth);
+				minX = std::min(minX, x);
+				maxX = std::max(maxX, x);
+				minY = std::min(minY, y);
+				maxY = std::max(maxY, y);
+				nearest = std::min(nearest, depth);
+			}
+			if (maxX < 0.0f || maxY < 0.0f || minX > static_cast<float>(m_Width) || minY > static_cast<float>(m_Height) || nearest > 1.0f)
+				return false;
+
+			//The pixel rectangle, then the finest level at which it spans at most 2x2 texels.
+			uint32_t x0 = static_cast<uint32_t>(std::clamp(minX, 0.0f, static_cast<float>(m_Width - 1)));
+			uint32_t x1 = static_cast<uint32_t>(std::clamp(maxX, 0.0f, static_cast<float>(m_Width - 1)));
+			uint32_t y0 = static_cast<uint32_t>(std::clamp(minY, 0.0f, static_cast<float>(m_Height - 1)));
+			uint32_t y1 = static_cast<uint32_t>(std::clamp(maxY, 0.0f, static_cast<float>(m_Height - 1)));
+			const std::vector<float>* level = &m_Depth;
+			uint32_t levelWidth = m_Width;
+			for (size_t idx = 0; idx < m_HiZ.size() && (x1 - x0 > 1 || y1 - y0 > 1); idx++)
+			{
+				x0 >>= 1; x1 >>= 1; y0 >>= 1; y1 >>= 1;
+				level = &m_HiZ[idx];
+				levelWidth = m_HiZWidth[idx];
+			}
+
+			float farthest = 0.0f;
+			for (uint32_t y = y0; y <= y1; y++)
+			{
+				for (uint32_t x = x0; x <= x1; x++)
+					farthest = std::max(farthest, (*level)[static_cast<size_t>(y) * levelWidth + x]);
+			}
+			return nearest <= farthest;
+		}
+
+		inline uint32_t GetWidth() const { return m_Width; }
+		inline uint32_t GetHeight() const { return m_Height; }
+		//Returns the depth buffer, row 0 at the bottom of the screen, with smaller values nearer (1 - NDC depth with reverseZ).
+		inline std::span<const float> GetDepth() const { return m_Depth; }
+	};
+}
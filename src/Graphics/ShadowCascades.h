@@ -0,0 +1,178 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Matrix/Matrix4.h"
+#include "../Other/Parallel.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector3.h"
+#include "../Vector/Vector4.h"
+#include <vector>
+
+namespace mars
+{
+	//Settings shared by all the cascades of a Fit.
+	struct ShadowCascadeSettings
+	{
+		//Width and height of each cascade's shadow map in texels.
+		uint32_t resolution = 2048;
+		//How far beyond the cascade's bounding sphere, towards the light, shadow casters are kept.
+		float casterDistance = 0.0f;
+		bool reverseZ = false;
+		bool rightHanded = false;
+	};
+
+	//View and orthographic projection of one cascade of one light.
+	struct ShadowCascade
+	{
+		float4x4 view;
+		float4x4 projection;
+		float4x4 viewProjection;
+		//The view distances of the camera covered by the cascade.
+		float splitNear;
+		float splitFar;
+		//World-space size of a shadow map texel.
+		float texelSize;
+	};
+
+	//Cascaded shadow map setup for directional lights. Each cascade is fitted around the bounding sphere of its slice of the camera
+	//frustum, which does not change size as the camera rotates, and its light-space position is snapped to whole texels, so the
+	//shadow map does not shimmer as the camera moves. The slices are shared by all lights, so many lights are fitted in one call.
+	class ShadowCascades
+	{
+	private:
+		struct Sphere
+		{
+			float3 center;
+			float radius;
+		};
+
+		//Returns an up vector that is not parallel to the direction.
+		static float3 GetUp(const float3& direction)
+		{
+			return std::abs(direction.y) > 0.99f ? float3(0, 0, 1) : float3(0, 1, 0);
+		}
+
+	public:
+		//Writes the split distances of the practical split scheme (Zhang et al.), a blend by lambda of the logarithmic (lambda = 1)
+		//and uniform (lambda = 0) schemes. splits.size() - 1 cascades are split, with splits[0] = zNear and splits.back() = zFar.
+		static void ComputeSplits(float zNear, float zFar, float lambda, std::span<float> splits)
+		{
+			if (splits.empty())
+				return;
+			const size_t cascadeCount = std::max<size_t>(splits.size() - 1, 1);
+			for (size_t idx = 0; idx < splits.size(); idx++)
+			{
+				const double fraction = static_cast<double>(idx) / static_cast<double>(cascadeCount);
+				const double logarithmic = zNear * pow(static_cast<double>(zFar) / zNear, fraction);
+				const double uniform = zNear + (static_cast<double>(zFar) - zNear) * fraction;
+				splits[idx] = static_cast<float>(lambda * logarithmic + (1.0 - lambda) * uniform);
+			}
+			splits.front() = zNear;
+			splits.back() = zFar;
+		}
+
+		//Writes the world-space corners of the camera frustum, unprojected from the corners of clip space by the inverse view-projection:
+		//0 to 3 on the near plane and 4 to 7 on the far plane, in the same order. The projection must have a finite far plane; the plane
+		//with the smaller cross-section is taken as near, so the depth direction (reverse-Z or not) does not matter.
+		static void FrustumCorners(const float4x4& inverseViewProjection, std::span<float3, 8> corners)
+		{
+			for (size_t idx = 0; idx < 8; idx++)
+			{
+				const float4 ndc((idx & 1) ? 1.0f : -1.0f, (idx & 2) ? 1.0f : -1.0f, (idx & 4) ? 1.0f : 0.0f, 1.0f);
+				const float4 world = inverseViewProjection * ndc;
+				corners[idx] = float3(world.x / world.w, world.y / world.w, world.z / world.w);
+			}
+			auto diagonalSq = [&](size_t first)
+			{
+				const float3 diagonal = corners[first + 3] - corners[first];
+				return diagonal.x * diagonal.x + diagonal.y * diagonal.y + diagonal.z * diagonal.z;
+			};
+			if (diagonalSq(0) > diagonalSq(4))
+			{
+				for (size_t idx = 0; idx < 4; idx++)
+					std::swap(corners[idx], corners[idx + 4]);
+			}
+		}
+		//Writes the corners of the slice of the camera frustum between the view distances splitNear and splitFar, interpolated along the
+		//frustum edges. frustumCorners are from FrustumCorners for a camera projection from zNear to zFar.
+		static void SliceCorners(std::span<const float3, 8> frustumCorners, float zNear, float zFar, float splitNear, float splitFar, std::span<float3, 8> corners)
+		{
+			const float tNear = (splitNear - zNear) / (zFar - zNear);
+			const float tFar = (splitFar - zNear) / (zFar - zNear);
+			for (size_t idx = 0; idx < 4; idx++)
+			{
+				const float3 edge = frustumCorners[idx + 4] - frustumCorners[idx];
+				corners[idx] = frustumCorners[idx] + edge * tNear;
+				corners[idx + 4] = frustumCorners[idx] + edge * tFar;
+			}
+		}
+
+		//Fits the cascades of one directional light. lightDirection points from the light into the scene. splits are from ComputeSplits;
+		//splits.size() - 1 cascades are written to outputs. Processes min(splits.size() - 1, outputs.size()) cascades.
+		static void Fit(const float4x4& cameraViewProjection, float zNear, float zFar, std::span<const float> splits, const float3& lightDirection,
+			const ShadowCascadeSettings& settings, std::span<ShadowCascade> outputs)
+		{
+			Fit(cameraViewProjection, zNear, zFar, splits, std::span<const float3>(&lightDirection, 1), settings, outputs, ExecutionPolicy::Sequential);
+		}
+		//Fits the cascades of many directional lights, in parallel over lights. The cascades of light l are at outputs[l * cascadeCount + c],
+		//where cascadeCount is splits.size() - 1. Processes min(lightDirections.size(), outputs.size() / cascadeCount) lights.
+		static void Fit(const float4x4& cameraViewProjection, float zNear, float zFar, std::span<const float> splits, std::span<const float3> lightDirections,
+			const ShadowCascadeSettings& settings, std::span<ShadowCascade> outputs, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			if (splits.size() < 2)
+				return;
+			const size_t cascadeCount = splits.size() - 1;
+			const size_t lightCount = std::min(lightDirections.size(), outputs.size() / cascadeCount);
+
+			//The bounding spheres of the slices are the same for every light. The radius is rounded up to 1/16 so float noise does not change the texel size.
+			float3 frustumCorners[8];
+			FrustumCorners(float4x4::Inverse(cameraViewProjection), frustumCorners);
+			std::vector<Sphere> spheres(cascadeCount);
+			for (size_t cascade = 0; cascade < cascadeCount; cascade++)
+			{
+				float3 corners[8];
+				SliceCorners(frustumCorners, zNear, zFar, splits[cascade], splits[cascade + 1], corners);
+				float3 center(0, 0, 0);
+				for (const float3& corner : corners)
+					center += corner;
+				center *= 1.0f / 8.0f;
+				float radius = 0.0f;
+				for (const float3& corner : corners)
+					radius = std::max(radius, (corner - center).Length<float>());
+				spheres[cascade] = { center, std::ceil(radius * 16.0f) / 16.0f };
+			}
+
+			Parallel::For(policy, lightCount, Parallel::GetChunkSize(lightCount, 16), [&](size_t begin, size_t end)
+			{
+				for (size_t light = begin; light < end; light++)
+				{
+					const float3 direction = float3::Normalise(lightDirections[light]);
+					const float3 up = GetUp(direction);
+					//Light rotation, used to snap the sphere center to whole texels in light space.
+					const float4x4 rotation = float4x4::LookAt(float3(0, 0, 0), direction, up, settings.rightHanded);
+					for (size_t cascade = 0; cascade < cascadeCount; cascade++)
+					{
+						const Sphere& sphere = spheres[cascade];
+						const float texelSize = 2.0f * sphere.radius / static_cast<float>(settings.resolution);
+						const float lx = std::floor((rotation.a * sphere.center.x + rotation.b * sphere.center.y + rotation.c * sphere.center.z) / texelSize) * texelSize;
+						const float ly = std::floor((rotation.e * sphere.center.x + rotation.f * sphere.center.y + rotation.g * sphere.center.z) / texelSize) * texelSize;
+						const float lz = rotation.i * sphere.center.x + rotation.j * sphere.center.y + rotation.k * sphere.center.z;
+						//Back to world space with the transpose of the rotation.
+						const float3 center(rotation.a * lx + rotation.e * ly + rotation.i * lz,
+							rotation.b * lx + rotation.f * ly + rotation.j * lz,
+							rotation.c * lx + rotation.g * ly + rotation.k * lz);
+
+						const float distance = sphere.radius + settings.casterDistance;
+						ShadowCascade& output = outputs[light * cascadeCount + cascade];
+						output.view = float4x4::LookAt(center - direction * distance, center, up, settings.rightHanded);
+						output.projection = float4x4::Orthographic(-sphere.radius, sphere.radius, -sphere.radius, sphere.radius, 0.0f, distance + sphere.radius,
+							settings.reverseZ, settings.rightHanded);
+						output.viewProjection = output.projection * output.view;
+						output.splitNear = splits[cascade];
+						output.splitFar = splits[cascade + 1];
+						output.texelSize = texelSize;
+					}
+				}
+			});
+		}
+	};
+}
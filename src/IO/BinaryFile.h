@@ -0,0 +1,412 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Layout/BufferLayout.h"
+#include <bit>
+#include <fstream>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mars
+{
+	//Kind of element stored in a binary file.
+	enum class BinaryElementKind : uint8_t
+	{
+		Scalar,
+		Vector,
+		Matrix,
+		Quaternion
+	};
+
+	//Component type (precision) of the elements stored in a binary file.
+	enum class BinaryComponentType : uint8_t
+	{
+		Int32,
+		UInt32,
+		Float32,
+		Float64
+	};
+
+	//Header at the start of every mars binary file. All fields are in native byte order.
+	//The element array starts at dataOffset, which is a multiple of alignment.
+	struct BinaryFileHeader
+	{
+		char magic[4];
+		uint16_t version;
+		BinaryElementKind elementKind;
+		BinaryComponentType componentType;
+		uint8_t rows;
+		uint8_t columns;
+		StorageOrder storageOrder;
+		uint8_t reserved0;
+		uint32_t elementSize;
+		uint32_t alignment;
+		uint32_t reserved1;
+		uint64_t elementCount;
+		uint64_t dataOffset;
+	};
+	static_assert(sizeof(BinaryFileHeader) == 40, "BinaryFileHeader must be tightly packed.");
+
+	//Describes how a mars type is stored in a binary file, and creates and validates headers for it.
+	template<typename Type>
+	class BinaryFormat
+	{
+	private:
+		using Traits = LayoutTraits<Type>;
+		using ComponentType = typename Traits::ComponentType;
+
+		template<typename U> struct MatrixStorageOrder { static constexpr StorageOrder Value = StorageOrder::RowMajor; };
+		template<typename U, StorageOrder O> struct MatrixStorageOrder<Matrix2<U, O>> { static constexpr StorageOrder Value = O; };
+		template<typename U, StorageOrder O> struct MatrixStorageOrder<Matrix3<U, O>> { static constexpr StorageOrder Value = O; };
+		template<typename U, StorageOrder O> struct MatrixStorageOrder<Matrix4<U, O>> { static constexpr StorageOrder Value = O; };
+
+		static_assert(sizeof(Type) == sizeof(ComponentType) * Traits::Rows * Traits::Columns, "Type must be tightly packed to be stored in a binary file.");
+
+	public:
+		static constexpr char Magic[4] = { 'M', 'A', 'R', 'S' };
+		static constexpr uint16_t Version = 1;
+		static constexpr uint32_t DefaultAlignment = 64;
+
+		static constexpr BinaryElementKind ElementKind()
+		{
+			if constexpr (std::is_same_v<Type, Quaternion>)
+				return BinaryElementKind::Quaternion;
+			else if constexpr (Traits::Columns > 1)
+				return BinaryElementKind::Matrix;
+			else if constexpr (Traits::Rows > 1)
+				return BinaryElementKind::Vector;
+			else
+				return BinaryElementKind::Scalar;
+		}
+
+		static constexpr BinaryComponentType ComponentTypeOf()
+		{
+			if constexpr (std::is_same_v<ComponentType, double>)
+				return BinaryComponentType::Float64;
+			else if constexpr (std::is_same_v<ComponentType, float>)
+				return BinaryComponentType::Float32;
+			else if constexpr (std::is_same_v<ComponentType, uint32_t>)
+				return BinaryComponentType::UInt32;
+			else
+			{
+				static_assert(std::is_same_v<ComponentType, int32_t>, "Unsupported component type.");
+				return BinaryComponentType::Int32;
+			}
+		}
+
+		//Creates a header for elementCount elements with the data aligned to alignment bytes, rounded up to a power of 2 no smaller than the component alignment.
+		static BinaryFileHeader MakeHeader(uint64_t elementCount, uint32_t alignment = DefaultAlignment)
+		{
+			alignment = std::bit_ceil(std::max<uint32_t>(alignment, static_cast<uint32_t>(alignof(ComponentType))));
+
+			BinaryFileHeader header = {};
+			std::copy(std::begin(Magic), std::end(Magic), header.magic);
+			header.version = Version;
+			header.elementKind = ElementKind();
+			header.componentType = ComponentTypeOf();
+			header.rows = static_cast<uint8_t>(Traits::Rows);
+			header.columns = static_cast<uint8_t>(Traits::Columns);
+			header.storageOrder = MatrixStorageOrder<Type>::Value;
+			header.elementSize = static_cast<uint32_t>(sizeof(Type));
+			header.alignment = alignment;
+			header.elementCount = elementCount;
+			header.dataOffset = (sizeof(BinaryFileHeader) + alignment - 1) / alignment * alignment;
+			return header;
+		}
+
+		//Checks that the header describes Type in this version of the format, that its alignment is a power of 2 the data offset
+		//honours, and that fileSize holds all the elements.
+		static bool Validate(const BinaryFileHeader& header, uint64_t fileSize)
+		{
+			if (!std::has_single_bit(header.alignment) || header.alignment < alignof(ComponentType))
+				return false;
+			const BinaryFileHeader expected = MakeHeader(header.elementCount, header.alignment);
+			return std::equal(std::begin(Magic), std::end(Magic), header.magic)
+				&& header.version == Version
+				&& header.elementKind == expected.elementKind
+				&& header.componentType == expected.componentType
+				&& header.rows == expected.rows
+				&& header.columns == expected.columns
+				&& header.storageOrder == expected.storageOrder
+				&& header.elementSize == expected.elementSize
+				&& header.dataOffset >= sizeof(BinaryFileHeader)
+				&& header.dataOffset % header.alignment == 0
+				&& header.dataOffset <= fileSize
+				&& header.elementCount <= (fileSize - header.dataOffset) / sizeof(Type);
+		}
+	};
+
+	//Read-only memory mapping of a whole file.
+	class MappedFile
+	{
+	private:
+		const uint8_t* m_Data = nullptr;
+		uint64_t m_Size = 0;
+#if defined(_WIN32)
+		HANDLE m_File = INVALID_HANDLE_VALUE;
+		HANDLE m_Mapping = nullptr;
+#else
+		int m_File = -1;
+#endif
+
+	public:
+		MappedFile() {}
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		//Destructs the MappedFile, unmapping the file.
+		~MappedFile()
+		{
+			Close();
+		}
+
+		//Maps the file at path. Returns false if the file can not be opened or mapped.
+		bool Open(const std::string& path)
+		{
+			Close();
+#if defined(_WIN32)
+			m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (m_File == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER size = {};
+			if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+			{
+				Close();
+				return false;
+			}
+			m_Size = static_cast<uint64_t>(size.QuadPart);
+
+			m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!m_Mapping)
+			{
+				Close();
+				return false;
+			}
+			m_Data = reinterpret_cast<const uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+			m_File = open(path.c_str(), O_RDONLY);
+			if (m_File < 0)
+				return false;
+
+			struct stat info = {};
+			if (fstat(m_File, &info) != 0 || info.st_size == 0)
+			{
+				Close();
+				return false;
+			}
+			m_Size = static_cast<uint64_t>(info.st_size);
+
+			void* data = mmap(nullptr, static_cast<size_t>(m_Size), PROT_READ, MAP_SHARED, m_File, 0);
+			m_Data = data == MAP_FAILED ? nullptr : reinterpret_cast<const uint8_t*>(data);
+#endif
+			if (!m_Data)
+			{
+				Close();
+				return false;
+			}
+			return true;
+		}
+
+		//Unmaps and closes the file.
+		void Close()
+		{
+#if defined(_WIN32)
+			if (m_Data)
+				UnmapViewOfFile(m_Data);
+			if (m_Mapping)
+				CloseHandle(m_Mapping);
+			if (m_File != INVALID_HANDLE_VALUE)
+				CloseHandle(m_File);
+			m_Mapping = nullptr;
+			m_File = INVALID_HANDLE_VALUE;
+#else
+			if (m_Data)
+				munmap(const_cast<uint8_t*>(m_Data), static_cast<size_t>(m_Size));
+			if (m_File >= 0)
+				close(m_File);
+			m_File = -1;
+#endif
+			m_Data = nullptr;
+			m_Size = 0;
+		}
+
+		inline const uint8_t* GetData() const { return m_Data; }
+		inline uint64_t GetSize() const { return m_Size; }
+	};
+
+	//Writes an array of Type to a binary file, one span at a time. The element count in the header is patched on Close().
+	template<typename Type>
+	class BinaryFileWriter
+	{
+	private:
+		std::ofstream m_Stream;
+		BinaryFileHeader m_Header = {};
+
+	public:
+		BinaryFileWriter() {}
+		//Destructs the BinaryFileWriter, finalising the file.
+		~BinaryFileWriter()
+		{
+			Close();
+		}
+
+		//Creates the file at path and writes a provisional header. Returns false if the file can not be created.
+		bool Open(const std::string& path, uint32_t alignment = BinaryFormat<Type>::DefaultAlignment)
+		{
+			Close();
+			m_Stream.open(path, std::ios::binary | std::ios::trunc);
+			if (!m_Stream)
+				return false;
+
+			m_Header = BinaryFormat<Type>::MakeHeader(0, alignment);
+			m_Stream.write(reinterpret_cast<const char*>(&m_Header), sizeof(BinaryFileHeader));
+			for (uint64_t idx = sizeof(BinaryFileHeader); idx < m_Header.dataOffset; idx++)
+				m_Stream.put(0);
+			return static_cast<bool>(m_Stream);
+		}
+
+		//Appends the elements to the file. Returns false on a write error.
+		bool Write(std::span<const Type> elements)
+		{
+			if (!m_Stream.is_open())
+				return false;
+
+			m_Stream.write(reinterpret_cast<const char*>(elements.data()), static_cast<std::streamsize>(elements.size_bytes()));
+			m_Header.elementCount += elements.size();
+			return static_cast<bool>(m_Stream);
+		}
+
+		//Writes the final header and closes the file. Returns false on a write error.
+		bool Close()
+		{
+			if (!m_Stream.is_open())
+				return true;
+
+			m_Stream.seekp(0);
+			m_Stream.write(reinterpret_cast<const char*>(&m_Header), sizeof(BinaryFileHeader));
+			bool result = static_cast<bool>(m_Stream);
+			m_Stream.close();
+			return result;
+		}
+
+		inline uint64_t GetElementCount() const { return m_Header.elementCount; }
+	};
+
+	//Memory maps a binary file of Type and exposes its elements as a zero-copy span.
+	template<typename Type>
+	class BinaryFileReader
+	{
+	private:
+		MappedFile m_File;
+		BinaryFileHeader m_Header = {};
+
+	public:
+		//Maps the file at path and validates its header against Type. Returns false if the file can not be mapped or does not hold Type.
+		bool Open(const std::string& path)
+		{
+			if (!m_File.Open(path))
+				return false;
+
+			if (m_File.GetSize() < sizeof(BinaryFileHeader))
+			{
+				m_File.Close();
+				return false;
+			}
+
+			memcpy(&m_Header, m_File.GetData(), sizeof(BinaryFileHeader));
+			if (!BinaryFormat<Type>::Validate(m_Header, m_File.GetSize()))
+			{
+				m_File.Close();
+				return false;
+			}
+			return true;
+		}
+
+		//Unmaps the file. Any spans returned by GetElements() are invalidated.
+		void Close()
+		{
+			m_File.Close();
+			m_Header = {};
+		}
+
+		//Returns the elements in the mapped file. The span is valid until Close() is called or the reader is destroyed.
+		std::span<const Type> GetElements() const
+		{
+			if (!m_File.GetData())
+				return {};
+
+			const Type* elements = reinterpret_cast<const Type*>(m_File.GetData() + m_Header.dataOffset);
+			return std::span<const Type>(elements, static_cast<size_t>(m_Header.elementCount));
+		}
+
+		inline const BinaryFileHeader& GetHeader() const { return m_Header; }
+	};
+
+	//Reads a binary file of Type in chunks into a caller-provided buffer, for files too large to map or hold in memory.
+	template<typename Type>
+	class BinaryFileChunkReader
+	{
+	private:
+		std::ifstream m_Stream;
+		BinaryFileHeader m_Header = {};
+		uint64_t m_Remaining = 0;
+
+	public:
+		//Opens the file at path and validates its header against Type. Returns false if the file can not be opened or does not hold Type.
+		bool Open(const std::string& path)
+		{
+			m_Stream.close();
+			m_Remaining = 0;
+			m_Stream.open(path, std::ios::binary | std::ios::ate);
+			if (!m_Stream)
+				return false;
+
+			const uint64_t fileSize = static_cast<uint64_t>(m_Stream.tellg());
+			m_Stream.seekg(0);
+			m_Stream.read(reinterpret_cast<char*>(&m_Header), sizeof(BinaryFileHeader));
+			if (!m_Stream || !BinaryFormat<Type>::Validate(m_Header, fileSize))
+			{
+				m_Stream.close();
+				return false;
+			}
+
+			m_Stream.seekg(static_cast<std::streamoff>(m_Header.dataOffset));
+			m_Remaining = m_Header.elementCount;
+			return true;
+		}
+
+		//Reads up to output.size() elements into output. Returns the number of elements read, 0 at the end of the file or on error.
+		size_t Read(std::span<Type> output)
+		{
+			const size_t count = static_cast<size_t>(std::min<uint64_t>(output.size(), m_Remaining));
+			if (count == 0)
+				return 0;
+
+			m_Stream.read(reinterpret_cast<char*>(output.data()), static_cast<std::streamsize>(count * sizeof(Type)));
+			if (!m_Stream)
+			{
+				m_Remaining = 0;
+				return 0;
+			}
+			m_Remaining -= count;
+			return count;
+		}
+
+		inline uint64_t GetRemaining() const { return m_Remaining; }
+		inline const BinaryFileHeader& GetHeader() const { return m_Header; }
+	};
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Layout/BufferLayout.h"
+#include <charconv>
+#include <limits>
+#include <string>
+
+namespace mars
+{
+	//Options for writing mars types as text.
+	struct TextFormat
+	{
+		//Digits after the point for fixed and scientific, significant digits for general. Negative writes the shortest text that parses back to the same value.
+		int32_t precision = -1;
+		std::chars_format floatFormat = std::chars_format::general;
+		//Written between the components of an element.
+		char componentSeparator = ' ';
+		//Written after every element.
+		char elementSeparator = '\n';
+	};
+
+	//Bulk text formatting and parsing of spans of scalars, vectors, quaternions and matrices on std::to_chars/std::from_chars,
+	//so there is no locale or stream state involved. Elements are written as their components in logical row-major order
+	//(quaternions as s, i, j, k), the same order as LayoutTraits::Gather.
+	class Text
+	{
+	private:
+		template<typename C>
+		static char* WriteComponent(char* first, char* last, C value, const TextFormat& format)
+		{
+			std::to_chars_result result;
+			if constexpr (std::is_floating_point_v<C>)
+			{
+				if (format.precision < 0)
+					result = std::to_chars(first, last, value, format.floatFormat);
+				else
+					result = std::to_chars(first, last, value, format.floatFormat, format.precision);
+			}
+			else
+				result = std::to_chars(first, last, value);
+			return result.ec == std::errc() ? result.ptr : nullptr;
+		}
+
+		//Parenthesis, brackets, commas, semicolons and whitespace may appear between components.
+		static inline bool IsSeparator(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ',' || c == ';' || c == '(' || c == ')' || c == '[' || c == ']';
+		}
+		//The quaternion units operator<< writes after the i, j and k components.
+		static inline bool IsUnit(char c)
+		{
+			return c == 'i' || c == 'j' || c == 'k';
+		}
+
+	public:
+		//Returns an upper bound on the number of chars ToChars writes for count elements of Type.
+		template<typename Type>
+		static size_t GetMaxLength(size_t count, const TextFormat& format = TextFormat())
+		{
+			using Traits = LayoutTraits<Type>;
+			using C = typename Traits::ComponentType;
+			size_t componentLength;
+			if constexpr (std::is_floating_point_v<C>)
+			{
+				//Sign, point, exponent and the digits; fixed notation can need every digit of the largest exponent.
+				const size_t digits = format.precision < 0 ? std::numeric_limits<C>::max_digits10 : static_cast<size_t>(format.precision);
+				const size_t fixedDigits = format.floatFormat == std::chars_format::fixed ? std::numeric_limits<C>::max_exponent10 + 1 : 0;
+				componentLength = digits + fixedDigits + 8;
+			}
+			else
+				componentLength = std::numeric_limits<C>::digits10 + 2;
+			return count * Traits::Rows * Traits::Columns * (componentLength + 1);
+		}
+
+		//Writes the values to output, ending every element with format.elementSeparator. Sets length to the number of chars written.
+		//Returns false if output is too small, in which case length covers only the complete elements written.
+		template<typename Type>
+		static bool ToChars(std::span<const Type> values, std::span<char> output, size_t& length, const TextFormat& format = TextFormat())
+		{
+			using Traits = LayoutTraits<Type>;
+			constexpr size_t ComponentCount = Traits::Rows * Traits::Columns;
+			char* const first = output.data();
+			char* const last = first + output.size();
+			char* cursor = first;
+			length = 0;
+			for (const Type& value : values)
+			{
+				typename Traits::ComponentType components[ComponentCount];
+				Traits::Gather(value, components);
+				for (size_t idx = 0; idx < ComponentCount; idx++)
+				{
+					cursor = WriteComponent(cursor, last, components[idx], format);
+					if (!cursor || cursor == last)
+						return false;
+					*cursor++ = idx + 1 < ComponentCount ? format.componentSeparator : format.elementSeparator;
+				}
+				length = static_cast<size_t>(cursor - first);
+			}
+			return true;
+		}
+		//Returns the values as a string, see ToChars.
+		template<typename Type>
+		static std::string ToString(std::span<const Type> values, const TextFormat& format = TextFormat())
+		{
+			std::string result(GetMaxLength<Type>(values.size(), format), '\0');
+			size_t length = 0;
+			ToChars(values, std::span<char>(result), length, format);
+			result.resize(length);
+			return result;
+		}
+
+		//Parses elements from input into values until either is exhausted or a component fails to parse. Components may be separated by
+		//whitespace, commas, semicolons, parentheses or brackets, may have a leading '+' and may end in a quaternion unit i, j or k,
+		//so operator<< output is accepted too.
+		//Returns the number of complete elements parsed.
+		template<typename Type>
+		static size_t FromChars(std::span<const char> input, std::span<Type> values)
+		{
+			using Traits = LayoutTraits<Type>;
+			using C = typename Traits::ComponentType;
+			constexpr size_t ComponentCount = Traits::Rows * Traits::Columns;
+			const char* cursor = input.data();
+			const char* const last = cursor + input.size();
+			for (size_t element = 0; element < values.size(); element++)
+			{
+				C components[ComponentCount];
+				for (size_t idx = 0; idx < ComponentCount; idx++)
+				{
+					while (cursor != last && IsSeparator(*cursor))
+						cursor++;
+					if (cursor != last && *cursor == '+')
+						cursor++;
+					const std::from_chars_result result = std::from_chars(cursor, last, components[idx]);
+					if (result.ec != std::errc())
+						return element;
+					cursor = result.ptr;
+					if (cursor != last && IsUnit(*cursor))
+						cursor++;
+				}
+				Traits::Scatter(components, values[element]);
+			}
+			return values.size();
+		}
+		//Parses elements from the string into values, see FromChars.
+		template<typename Type>
+		static size_t FromString(const std::string& input, std::span<Type> values)
+		{
+			return FromChars(std::span<const char>(input.data(), input.size()), values);
+		}
+	};
+}
@@ -0,0 +1,276 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Matrix/Matrix.h"
+#include "../Quaternion/Quaternion.h"
+#include <cstring>
+
+namespace mars
+{
+	template<typename T> class Vector2;
+	template<typename T> class Vector3;
+	template<typename T> class Vector4;
+
+	//Layout rules for GPU uniform (std140) and storage (std430) buffers.
+	enum class BufferLayoutRule : uint8_t
+	{
+		Std140,
+		Std430
+	};
+
+	//Reflection traits for types that can be written to a GPU buffer. Rows and Columns are the logical shape, vectors are Rows x 1.
+	//Gather(value, output) writes the Rows * Columns logical components to output in row-major order, Scatter(input, value) reads them back.
+	template<typename Type>
+	struct LayoutTraits;
+
+	template<typename T> requires std::is_arithmetic_v<T>
+	struct LayoutTraits<T>
+	{
+		using ComponentType = T;
+		static constexpr size_t Rows = 1;
+		static constexpr size_t Columns = 1;
+		static void Gather(const T& value, T* output) { output[0] = value; }
+		static void Scatter(const T* input, T& value) { value = input[0]; }
+	};
+	template<typename T>
+	struct LayoutTraits<Vector2<T>>
+	{
+		using ComponentType = T;
+		static constexpr size_t Rows = 2;
+		static constexpr size_t Columns = 1;
+		static void Gather(const Vector2<T>& value, T* output) { memcpy(output, value.GetData(), sizeof(T) * 2); }
+		static void Scatter(const T* input, Vector2<T>& value) { value = Vector2<T>(input[0], input[1]); }
+	};
+	template<typename T>
+	struct LayoutTraits<Vector3<T>>
+	{
+		using ComponentType = T;
+		static constexpr size_t Rows = 3;
+		static constexpr size_t Columns = 1;
+		static void Gather(const Vector3<T>& value, T* output) { memcpy(output, value.GetData(), sizeof(T) * 3); }
+		static void Scatter(const T* input, Vector3<T>& value) { value = Vector3<T>(input[0], input[1], input[2]); }
+	};
+	template<typename T>
+	struct LayoutTraits<Vector4<T>>
+	{
+		using ComponentType = T;
+		static constexpr size_t Rows = 4;
+		static constexpr size_t Columns = 1;
+		static void Gather(const Vector4<T>& value, T* output) { memcpy(output, value.GetData(), sizeof(T) * 4); }
+		static void Scatter(const T* input, Vector4<T>& value) { value = Vector4<T>(input[0], input[1], input[2], input[3]); }
+	};
+	template<typename T, size_t N>
+	struct LayoutTraits<Vector<T, N>>
+	{
+		using ComponentType = T;
+		static constexpr size_t Rows = N;
+		static constexpr size_t Columns = 1;
+		static void Gather(const Vector<T, N>& value, T* output) { memcpy(output, value.data, sizeof(T) * N); }
+		static void Scatter(const T* input, Vector<T, N>& value) { memcpy(value.data, input, sizeof(T) * N); }
+	};
+	template<typename T, StorageOrder O>
+	struct LayoutTraits<Matrix2<T, O>>
+	{
+		using ComponentType = T;
+		static constexpr size_t Rows = 2;
+		static constexpr size_t Columns = 2;
+		static void Gather(const Matrix2<T, O>& value, T* output) { memcpy(output, Matrix<T, 2, 2>(value).data, sizeof(T) * 4); }
+		static void Scatter(const T* input, Matrix2<T, O>& value) { Matrix<T, 2, 2> m; memcpy(m.data, input, sizeof(T) * 4); value = Matrix2<T, O>(m); }
+	};
+	template<typename T, StorageOrder O>
+	struct LayoutTraits<Matrix3<T, O>>
+	{
+		using ComponentType = T;
+		static constexpr size_t Rows = 3;
+		static constexpr size_t Columns = 3;
+		static void Gather(const Matrix3<T, O>& value, T* output) { memcpy(output, Matrix<T, 3, 3>(value).data, sizeof(T) * 9); }
+		static void Scatter(const T* input, Matrix3<T, O>& value) { Matrix<T, 3, 3> m; memcpy(m.data, input, sizeof(T) * 9); value = Matrix3<T, O>(m); }
+	};
+	template<typename T, StorageOrder O>
+	struct LayoutTraits<Matrix4<T, O>>
+	{
+		using ComponentType = T;
+		static constexpr size_t Rows = 4;
+		static constexpr size_t Columns = 4;
+		static void Gather(const Matrix4<T, O>& value, T* output) { memcpy(output, Matrix<T, 4, 4>(value).data, sizeof(T) * 16); }
+		static void Scatter(const T* input, Matrix4<T, O>& value) { Matrix<T, 4, 4> m; memcpy(m.data, input, sizeof(T) * 16); value = Matrix4<T, O>(m); }
+	};
+	template<typename T, size_t R, size_t C>
+	struct LayoutTraits<Matrix<T, R, C>>
+	{
+		using ComponentType = T;
+		static constexpr size_t Rows = R;
+		static constexpr size_t Columns = C;
+		static void Gather(const Matrix<T, R, C>& value, T* output) { memcpy(output, value.data, sizeof(T) * R * C); }
+		static void Scatter(const T* input, Matrix<T, R, C>& value) { memcpy(value.data, input, sizeof(T) * R * C); }
+	};
+	//Quaternions are written as a dvec4 of (s, i, j, k).
+	template<>
+	struct LayoutTraits<Quaternion>
+	{
+		using ComponentType = double;
+		static constexpr size_t Rows = 4;
+		static constexpr size_t Columns = 1;
+		static void Gather(const Quaternion& value, double* output) { memcpy(output, value.GetData(), sizeof(double) * 4); }
+		static void Scatter(const double* input, Quaternion& value) { value = Quaternion(input[0], input[1], input[2], input[3]); }
+	};
+
+	//Computes std140/std430 offsets, sizes and strides, and serialises mars types into mapped GPU buffers with the correct padding.
+	//BufferOrder is the matrix layout declared in the shader: ColumnMajor for the GLSL default, RowMajor for layout(row_major).
+	template<BufferLayoutRule Rule, StorageOrder BufferOrder = StorageOrder::ColumnMajor>
+	class BufferLayout
+	{
+	private:
+		static constexpr size_t RoundUp(size_t value, size_t alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		//Base alignment of a vector of count components of the given size.
+		static constexpr size_t VectorAlignment(size_t count, size_t componentSize)
+		{
+			return componentSize * (count == 1 ? 1 : (count == 2 ? 2 : 4));
+		}
+
+		//The number of component vectors and the number of components in each, as stored in the buffer.
+		template<typename Type>
+		static constexpr size_t VectorCount()
+		{
+			using Traits = LayoutTraits<Type>;
+			if constexpr (Traits::Columns == 1)
+				return 1;
+			else
+				return BufferOrder == StorageOrder::ColumnMajor ? Traits::Columns : Traits::Rows;
+		}
+		template<typename Type>
+		static constexpr size_t VectorLength()
+		{
+			using Traits = LayoutTraits<Type>;
+			if constexpr (Traits::Columns == 1)
+				return Traits::Rows;
+			else
+				return BufferOrder == StorageOrder::ColumnMajor ? Traits::Rows : Traits::Columns;
+		}
+
+		//Stride between the column (or row) vectors of a matrix.
+		template<typename Type>
+		static constexpr size_t VectorStride()
+		{
+			constexpr size_t componentSize = sizeof(typename LayoutTraits<Type>::ComponentType);
+			constexpr size_t alignment = VectorAlignment(VectorLength<Type>(), componentSize);
+			if constexpr (Rule == BufferLayoutRule::Std140)
+				return RoundUp(alignment, 16);
+			else
+				return alignment;
+		}
+
+	public:
+		//Returns the base alignment of the type.
+		template<typename Type>
+		static constexpr size_t Alignment()
+		{
+			using Traits = LayoutTraits<Type>;
+			if constexpr (Traits::Columns == 1)
+				return VectorAlignment(Traits::Rows, sizeof(typename Traits::ComponentType));
+			else
+				return VectorStride<Type>();
+		}
+
+		//Returns the size of a single element of the type, excluding trailing padding.
+		template<typename Type>
+		static constexpr size_t Size()
+		{
+			using Traits = LayoutTraits<Type>;
+			if constexpr (Traits::Columns == 1)
+				return Traits::Rows * sizeof(typename Traits::ComponentType);
+			else
+				return VectorCount<Type>() * VectorStride<Type>();
+		}
+
+		//Returns the stride between consecutive elements of an array of the type.
+		template<typename Type>
+		static constexpr size_t ArrayStride()
+		{
+			if constexpr (Rule == BufferLayoutRule::Std140)
+				return RoundUp(Size<Type>(), RoundUp(Alignment<Type>(), 16));
+			else
+				return RoundUp(Size<Type>(), Alignment<Type>());
+		}
+
+		//Returns the offset at which a member of the type is placed, given the end offset of the previous member.
+		template<typename Type>
+		static constexpr size_t Offset(size_t currentOffset)
+		{
+			return RoundUp(currentOffset, Alignment<Type>());
+		}
+		//Returns the offset at which an array of the type is placed, given the end offset of the previous member.
+		template<typename Type>
+		static constexpr size_t ArrayOffset(size_t currentOffset)
+		{
+			if constexpr (Rule == BufferLayoutRule::Std140)
+				return RoundUp(currentOffset, RoundUp(Alignment<Type>(), 16));
+			else
+				return RoundUp(currentOffset, Alignment<Type>());
+		}
+
+		//Writes a single value to dst, which must be at a correctly aligned offset. Returns the number of bytes written, i.e. Size<Type>().
+		template<typename Type>
+		static size_t Write(const Type& value, void* dst)
+		{
+			using Traits = LayoutTraits<Type>;
+			using ComponentType = typename Traits::ComponentType;
+			constexpr size_t componentCount = ArrayStride<Type>() / sizeof(ComponentType);
+
+			ComponentType staging[componentCount] = {};
+			PackElement(value, staging);
+			memcpy(dst, staging, Size<Type>());
+			return Size<Type>();
+		}
+
+		//Writes the input array to dst with the array stride of the layout rule, zeroing all padding. Returns the number of bytes written.
+		template<typename Type>
+		static size_t Write(std::span<const Type> input, void* dst)
+		{
+			using Traits = LayoutTraits<Type>;
+			using ComponentType = typename Traits::ComponentType;
+			constexpr size_t stride = ArrayStride<Type>();
+			constexpr size_t componentCount = stride / sizeof(ComponentType);
+
+			uint8_t* output = reinterpret_cast<uint8_t*>(dst);
+			for (size_t idx = 0; idx < input.size(); idx++, output += stride)
+			{
+				ComponentType staging[componentCount] = {};
+				PackElement(input[idx], staging);
+				memcpy(output, staging, stride);
+			}
+			return input.size() * stride;
+		}
+
+	private:
+		//Packs an element into staging, which holds ArrayStride<Type>() bytes of zeroed components.
+		template<typename Type, typename ComponentType>
+		static void PackElement(const Type& value, ComponentType* staging)
+		{
+			using Traits = LayoutTraits<Type>;
+			constexpr size_t vectorStride = VectorStride<Type>() / sizeof(ComponentType);
+			if constexpr (Traits::Columns == 1)
+			{
+				Traits::Gather(value, staging);
+			}
+			else
+			{
+				ComponentType components[Traits::Rows * Traits::Columns];
+				Traits::Gather(value, components);
+				Unroll<Traits::Rows * Traits::Columns>([&](auto idx)
+				{
+					constexpr size_t row = idx / Traits::Columns;
+					constexpr size_t col = idx % Traits::Columns;
+					constexpr size_t offset = BufferOrder == StorageOrder::ColumnMajor ? col * vectorStride + row : row * vectorStride + col;
+					staging[offset] = components[idx];
+				});
+			}
+		}
+	};
+
+	typedef BufferLayout<BufferLayoutRule::Std140> Std140Layout;
+	typedef BufferLayout<BufferLayoutRule::Std430> Std430Layout;
+}
@@ -0,0 +1,335 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector3.h"
+#include "Matrix3.h"
+#include "MatrixBlock.h"
+
+namespace mars
+{
+	//Singular value decomposition A = U * diag(singularValues) * V^T with U and V proper rotations.
+	//The singular values are sorted by decreasing magnitude, only the last one can be negative (when det(A) < 0).
+	template<typename T, StorageOrder O = StorageOrder::RowMajor>
+	struct SVD3
+	{
+		Matrix3<T, O> U;
+		Vector3<T> singularValues;
+		Matrix3<T, O> V;
+	};
+
+	//Polar decomposition A = R * S with R a proper rotation and S symmetric.
+	template<typename T, StorageOrder O = StorageOrder::RowMajor>
+	struct Polar3
+	{
+		Matrix3<T, O> R;
+		Matrix3<T, O> S;
+	};
+
+	//Eigen-decomposition of a symmetric matrix, A = eigenvectors * diag(eigenvalues) * eigenvectors^T.
+	//The eigenvalues are sorted in decreasing order, the eigenvectors are the columns of a proper rotation.
+	template<typename T, StorageOrder O = StorageOrder::RowMajor>
+	struct SymmetricEigen3
+	{
+		Vector3<T> eigenvalues;
+		Matrix3<T, O> eigenvectors;
+	};
+
+	//Decompositions of 3x3 matrices.
+	//The SVD follows McAdams et al.: a fixed number of Jacobi sweeps on A^T A with approximate Givens rotations accumulated
+	//in a quaternion, a sort of the columns of A * V, then a Givens QR. The symmetric eigen-decomposition is the Jacobi stage alone.
+	//There is no data-dependent branching, so the batched variants run the same kernels on LaneArray values, one instruction stream for Lanes matrices.
+	//https://pages.cs.wisc.edu/~sifakis/papers/SVD_TR1690.pdf
+	class Decomposition
+	{
+	public:
+		//The paper uses 4 sweeps; with nearly repeated singular values that leaves errors around 1e-2, 6 sweeps reach float precision.
+		static constexpr uint32_t JacobiSweeps = 6;
+
+	private:
+		//Rotates the symmetric s by the approximate Jacobi rotation about the axis K (in the plane (P, Q)) and accumulates it into q.
+		template<typename V, size_t P, size_t Q, size_t K>
+		static inline void JacobiConjugate(V (&s)[3][3], V (&q)[4])
+		{
+			const V gamma = static_cast<V>(5.82842712474619); //3 + 2 * sqrt(2)
+			const V cosPi8 = static_cast<V>(0.9238795325112867);
+			const V sinPi8 = static_cast<V>(0.3826834323650898);
+
+			V ch = 2 * (s[P][P] - s[Q][Q]);
+			V sh = s[P][Q];
+			const auto useApproximation = gamma * sh * sh < ch * ch;
+			const V w = 1 / Sqrt(ch * ch + sh * sh);
+			ch = Select(useApproximation, w * ch, cosPi8);
+			sh = Select(useApproximation, w * sh, sinPi8);
+
+			const V c = ch * ch - sh * sh;
+			const V sn = 2 * ch * sh;
+			const V spp = s[P][P], sqq = s[Q][Q], spq = s[P][Q], spk = s[P][K], sqk = s[Q][K];
+			s[P][P] = c * c * spp + 2 * c * sn * spq + sn * sn * sqq;
+			s[Q][Q] = sn * sn * spp - 2 * c * sn * spq + c * c * sqq;
+			s[P][Q] = s[Q][P] = c * sn * (sqq - spp) + (c * c - sn * sn) * spq;
+			s[P][K] = s[K][P] = c * spk + sn * sqk;
+			s[Q][K] = s[K][Q] = c * sqk - sn * spk;
+
+			//q = q * (ch, sh * e_K)
+			const V qw = q[0];
+			const V qv[3] = { q[1], q[2], q[3] };
+			q[0] = qw * ch - sh * qv[K];
+			q[1 + K] = qw * sh + ch * qv[K];
+			q[1 + P] = ch * qv[P] + sh * qv[Q];
+			q[1 + Q] = ch * qv[Q] - sh * qv[P];
+		}
+
+		//Swaps the columns I and J of every matrix if keys[J] > keys[I], negating one of them to keep the determinant.
+		template<typename V, size_t I, size_t J, typename... Matrices>
+		static inline void SortColumns(V (&keys)[3], Matrices&... matrices)
+		{
+			const auto swap = keys[I] < keys[J];
+			auto swapColumns = [&](V (&m)[3][3])
+			{
+				Unroll<3>([&](auto r)
+				{
+					const V mi = m[r][I], mj = m[r][J];
+					m[r][I] = Select(swap, mj, mi);
+					m[r][J] = Select(swap, -mi, mj);
+				});
+			};
+			(swapColumns(matrices), ...);
+			const V ki = keys[I], kj = keys[J];
+			keys[I] = Select(swap, kj, ki);
+			keys[J] = Select(swap, ki, kj);
+		}
+
+		//Diagonalises the symmetric s in place with the Jacobi sweeps, writing the accumulated rotation to v.
+		template<typename V>
+		static inline void JacobiEigen(V (&s)[3][3], V (&v)[3][3])
+		{
+			V q[4] = { V(1), V(0), V(0), V(0) };
+			for (uint32_t sweep = 0; sweep < JacobiSweeps; sweep++)
+			{
+				JacobiConjugate<V, 0, 1, 2>(s, q);
+				JacobiConjugate<V, 1, 2, 0>(s, q);
+				JacobiConjugate<V, 2, 0, 1>(s, q);
+			}
+
+			const V invLength = 1 / Sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+			const V qw = q[0] * invLength, qx = q[1] * invLength, qy = q[2] * invLength, qz = q[3] * invLength;
+			v[0][0] = 1 - 2 * (qy * qy + qz * qz);
+			v[0][1] = 2 * (qx * qy - qw * qz);
+			v[0][2] = 2 * (qx * qz + qw * qy);
+			v[1][0] = 2 * (qx * qy + qw * qz);
+			v[1][1] = 1 - 2 * (qx * qx + qz * qz);
+			v[1][2] = 2 * (qy * qz - qw * qx);
+			v[2][0] = 2 * (qx * qz - qw * qy);
+			v[2][1] = 2 * (qy * qz + qw * qx);
+			v[2][2] = 1 - 2 * (qx * qx + qy * qy);
+		}
+
+		//Applies the Givens rotation that zeroes b[Q][P] to the rows of b, and accumulates it into the columns of u.
+		template<typename V, size_t P, size_t Q>
+		static inline void QRGivens(V (&b)[3][3], V (&u)[3][3])
+		{
+			const V epsilon = std::numeric_limits<typename LaneTraits<V>::Scalar>::epsilon();
+			const V app = b[P][P];
+			const V aqp = b[Q][P];
+			const V rho = Sqrt(app * app + aqp * aqp);
+			V sh = Select(rho > epsilon, aqp, V(0));
+			V ch = Abs(app) + Max(rho, epsilon);
+			const auto swap = app < V(0);
+			const V tmp = sh;
+			sh = Select(swap, ch, sh);
+			ch = Select(swap, tmp, ch);
+			const V w = 1 / Sqrt(ch * ch + sh * sh);
+			ch *= w;
+			sh *= w;
+
+			const V c = ch * ch - sh * sh;
+			const V sn = 2 * ch * sh;
+			Unroll<3>([&](auto col)
+			{
+				const V bp = b[P][col], bq = b[Q][col];
+				b[P][col] = c * bp + sn * bq;
+				b[Q][col] = c * bq - sn * bp;
+			});
+			Unroll<3>([&](auto row)
+			{
+				const V up = u[row][P], uq = u[row][Q];
+				u[row][P] = c * up + sn * uq;
+				u[row][Q] = c * uq - sn * up;
+			});
+		}
+
+		//Branch-free 3x3 SVD of a, row-major arrays.
+		template<typename V>
+		static inline void SVDKernel(const V (&a)[3][3], V (&u)[3][3], V (&sigma)[3], V (&v)[3][3])
+		{
+			//Jacobi eigen-analysis of A^T A.
+			V s[3][3];
+			Unroll<3>([&](auto r)
+			{
+				Unroll<3>([&](auto c) { s[r][c] = a[0][r] * a[0][c] + a[1][r] * a[1][c] + a[2][r] * a[2][c]; });
+			});
+			JacobiEigen(s, v);
+
+			//B = A * V, with columns sorted by decreasing length.
+			V b[3][3];
+			Unroll<3>([&](auto r)
+			{
+				Unroll<3>([&](auto c) { b[r][c] = a[r][0] * v[0][c] + a[r][1] * v[1][c] + a[r][2] * v[2][c]; });
+			});
+			V lengthSq[3];
+			Unroll<3>([&](auto c) { lengthSq[c] = b[0][c] * b[0][c] + b[1][c] * b[1][c] + b[2][c] * b[2][c]; });
+			SortColumns<V, 0, 1>(lengthSq, b, v);
+			SortColumns<V, 0, 2>(lengthSq, b, v);
+			SortColumns<V, 1, 2>(lengthSq, b, v);
+
+			//QR of B; R is diagonal up to the Jacobi error.
+			Unroll<3>([&](auto r)
+			{
+				Unroll<3>([&](auto c) { u[r][c] = V(r == c ? 1 : 0); });
+			});
+			QRGivens<V, 0, 1>(b, u);
+			QRGivens<V, 0, 2>(b, u);
+			QRGivens<V, 1, 2>(b, u);
+
+			//Move any negative sign of the first two values onto the last one, keeping det(U) = 1.
+			Unroll<3>([&](auto idx) { sigma[idx] = b[idx][idx]; });
+			Unroll<2>([&](auto idx)
+			{
+				const V sign = Select(sigma[idx] < V(0), V(-1), V(1));
+				sigma[idx] *= sign;
+				sigma[2] *= sign;
+				Unroll<3>([&](auto r)
+				{
+					u[r][idx] *= sign;
+					u[r][2] *= sign;
+				});
+			});
+		}
+
+		//Eigen-decomposition of the symmetric a, eigenvalues in decreasing order and eigenvectors in the columns of vectors.
+		template<typename V>
+		static inline void SymmetricEigenKernel(const V (&a)[3][3], V (&values)[3], V (&vectors)[3][3])
+		{
+			V s[3][3];
+			Unroll<9>([&](auto e) { s[e / 3][e % 3] = a[e / 3][e % 3]; });
+			JacobiEigen(s, vectors);
+			Unroll<3>([&](auto idx) { values[idx] = s[idx][idx]; });
+			SortColumns<V, 0, 1>(values, vectors);
+			SortColumns<V, 0, 2>(values, vectors);
+			SortColumns<V, 1, 2>(values, vectors);
+		}
+
+		//R = U * V^T and S = V * diag(sigma) * V^T.
+		template<typename V>
+		static inline void PolarFromSVD(const V (&u)[3][3], const V (&sigma)[3], const V (&v)[3][3], V (&r)[3][3], V (&s)[3][3])
+		{
+			Unroll<3>([&](auto row)
+			{
+				Unroll<3>([&](auto col)
+				{
+					r[row][col] = u[row][0] * v[col][0] + u[row][1] * v[col][1] + u[row][2] * v[col][2];
+					s[row][col] = v[row][0] * sigma[0] * v[col][0] + v[row][1] * sigma[1] * v[col][1] + v[row][2] * sigma[2] * v[col][2];
+				});
+			});
+		}
+
+		template<typename T, StorageOrder O>
+		static inline void Load(const Matrix3<T, O>& input, T (&output)[3][3])
+		{
+			output[0][0] = input.a; output[0][1] = input.b; output[0][2] = input.c;
+			output[1][0] = input.d; output[1][1] = input.e; output[1][2] = input.f;
+			output[2][0] = input.g; output[2][1] = input.h; output[2][2] = input.i;
+		}
+		template<typename T, StorageOrder O>
+		static inline Matrix3<T, O> Store(const T (&input)[3][3])
+		{
+			return Matrix3<T, O>(input[0][0], input[0][1], input[0][2], input[1][0], input[1][1], input[1][2], input[2][0], input[2][1], input[2][2]);
+		}
+		//Returns the matrix in the lane of a block.
+		template<typename T, StorageOrder O, size_t Lanes>
+		static inline Matrix3<T, O> Store(const LaneArray<T, Lanes> (&input)[3][3], size_t lane)
+		{
+			return Matrix3<T, O>(input[0][0][lane], input[0][1][lane], input[0][2][lane], input[1][0][lane], input[1][1][lane], input[1][2][lane],
+				input[2][0][lane], input[2][1][lane], input[2][2][lane]);
+		}
+
+	public:
+		//Computes the SVD of the input matrix.
+		template<typename T, StorageOrder O>
+		static SVD3<T, O> SVD(const Matrix3<T, O>& input)
+		{
+			T a[3][3], u[3][3], sigma[3], v[3][3];
+			Load(input, a);
+			SVDKernel(a, u, sigma, v);
+			return { Store<T, O>(u), Vector3<T>(sigma[0], sigma[1], sigma[2]), Store<T, O>(v) };
+		}
+		//Computes the SVD of min(inputs.size(), outputs.size()) matrices, Lanes at a time (8 or 16 match common vector widths).
+		template<size_t Lanes = 8, typename T, StorageOrder O>
+		static void SVD(std::span<const Matrix3<T, O>> inputs, std::span<SVD3<T, O>> outputs)
+		{
+			using V = LaneArray<T, Lanes>;
+			ForEachMatrixBlock<Lanes, T, 3>(std::min(inputs.size(), outputs.size()), [&](size_t idx, T (&a)[3][3]) { Load(inputs[idx], a); },
+				[&](const V (&a)[3][3], size_t base, size_t blockCount)
+			{
+				V u[3][3], sigma[3], v[3][3];
+				SVDKernel(a, u, sigma, v);
+				for (size_t lane = 0; lane < blockCount; lane++)
+					outputs[base + lane] = { Store<T, O>(u, lane), Vector3<T>(sigma[0][lane], sigma[1][lane], sigma[2][lane]), Store<T, O>(v, lane) };
+			});
+		}
+
+		//Computes the polar decomposition of the input matrix. R is always a rotation, so S is not positive definite when det(input) < 0.
+		template<typename T, StorageOrder O>
+		static Polar3<T, O> Polar(const Matrix3<T, O>& input)
+		{
+			T a[3][3], u[3][3], sigma[3], v[3][3], r[3][3], s[3][3];
+			Load(input, a);
+			SVDKernel(a, u, sigma, v);
+			PolarFromSVD(u, sigma, v, r, s);
+			return { Store<T, O>(r), Store<T, O>(s) };
+		}
+		//Computes the rotations, and the stretches if requested, of min(inputs.size(), rotations.size()) matrices, Lanes at a time.
+		template<size_t Lanes = 8, typename T, StorageOrder O>
+		static void Polar(std::span<const Matrix3<T, O>> inputs, std::span<Matrix3<T, O>> rotations, std::span<Matrix3<T, O>> stretches = {})
+		{
+			using V = LaneArray<T, Lanes>;
+			ForEachMatrixBlock<Lanes, T, 3>(std::min(inputs.size(), rotations.size()), [&](size_t idx, T (&a)[3][3]) { Load(inputs[idx], a); },
+				[&](const V (&a)[3][3], size_t base, size_t blockCount)
+			{
+				V u[3][3], sigma[3], v[3][3], r[3][3], s[3][3];
+				SVDKernel(a, u, sigma, v);
+				PolarFromSVD(u, sigma, v, r, s);
+				for (size_t lane = 0; lane < blockCount; lane++)
+				{
+					rotations[base + lane] = Store<T, O>(r, lane);
+					if (base + lane < stretches.size())
+						stretches[base + lane] = Store<T, O>(s, lane);
+				}
+			});
+		}
+
+		//Computes the eigen-decomposition of the symmetric input matrix.
+		template<typename T, StorageOrder O>
+		static SymmetricEigen3<T, O> SymmetricEigen(const Matrix3<T, O>& input)
+		{
+			T a[3][3], values[3], vectors[3][3];
+			Load(input, a);
+			SymmetricEigenKernel(a, values, vectors);
+			return { Vector3<T>(values[0], values[1], values[2]), Store<T, O>(vectors) };
+		}
+		//Computes the eigen-decomposition of min(inputs.size(), outputs.size()) symmetric matrices, Lanes at a time.
+		template<size_t Lanes = 8, typename T, StorageOrder O>
+		static void SymmetricEigen(std::span<const Matrix3<T, O>> inputs, std::span<SymmetricEigen3<T, O>> outputs)
+		{
+			using V = LaneArray<T, Lanes>;
+			ForEachMatrixBlock<Lanes, T, 3>(std::min(inputs.size(), outputs.size()), [&](size_t idx, T (&a)[3][3]) { Load(inputs[idx], a); },
+				[&](const V (&a)[3][3], size_t base, size_t blockCount)
+			{
+				V values[3], vectors[3][3];
+				SymmetricEigenKernel(a, values, vectors);
+				for (size_t lane = 0; lane < blockCount; lane++)
+					outputs[base + lane] = { Vector3<T>(values[0][lane], values[1][lane], values[2][lane]), Store<T, O>(vectors, lane) };
+			});
+		}
+	};
+}
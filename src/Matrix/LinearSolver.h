@@ -0,0 +1,468 @@
+#pragma once
+#include "../mars_common.h"
+#include "Matrix.h"
+#include "Matrix2.h"
+#include "Matrix3.h"
+#include "Matrix4.h"
+#include "MatrixBlock.h"
+
+namespace mars
+{
+	//Runs kernel(a, b, x) -> mask over blocks of Lanes systems A x = b, with a, b and x arrays of LaneArray<T, Lanes>, so the kernel is
+	//one instruction stream over the block. Solutions of systems the kernel rejects are set to 0. Returns false if any system was rejected.
+	template<typename T, size_t N, size_t Lanes, typename MatrixType, typename VectorType, typename Kernel>
+	inline bool SolveLinearSystems(std::span<const MatrixType> matrices, std::span<const VectorType> rhs, std::span<VectorType> solutions, Kernel&& kernel)
+	{
+		using V = LaneArray<T, Lanes>;
+		bool allValid = true;
+		ForEachMatrixBlock<Lanes, T, N>(std::min({ matrices.size(), rhs.size(), solutions.size() }), [&](size_t idx, T (&a)[N][N])
+		{
+			const Matrix<T, N, N> matrix = matrices[idx];
+			Unroll<N * N>([&](auto e) { a[e / N][e % N] = matrix.data[e]; });
+		},
+		[&](V (&a)[N][N], size_t base, size_t blockCount)
+		{
+			V b[N], x[N];
+			for (size_t lane = 0; lane < Lanes; lane++)
+			{
+				Vector<T, N> vector;
+				if (lane < blockCount)
+					vector = rhs[base + lane];
+				Unroll<N>([&](auto e) { b[e][lane] = vector.data[e]; });
+			}
+			const LaneMask<T, Lanes> valid = kernel(a, b, x);
+			for (size_t lane = 0; lane < blockCount; lane++)
+			{
+				Vector<T, N> solution;
+				Unroll<N>([&](auto e) { solution.data[e] = valid[lane] ? x[e][lane] : T(0); });
+				solutions[base + lane] = solution;
+				allValid = allValid && valid[lane];
+			}
+		});
+		return allValid;
+	}
+
+	//Returns the 1-norm (maximum absolute column sum) of the matrix.
+	template<typename T, size_t N>
+	inline T MatrixNorm1(const Matrix<T, N, N>& input)
+	{
+		T result = 0;
+		Unroll<N>([&](auto col)
+		{
+			T sum = 0;
+			Unroll<N>([&](auto row) { sum += std::abs(input.data[row * N + col]); });
+			result = std::max(result, sum);
+		});
+		return result;
+	}
+
+	//Estimates the 1-norm of the inverse from solves with A and A^T (Hager's method, as in LAPACK's xLACON).
+	template<typename T, size_t N, typename SolveFunc, typename SolveTransposeFunc>
+	inline T EstimateInverseNorm1(SolveFunc&& solve, SolveTransposeFunc&& solveTranspose)
+	{
+		Vector<T, N> x(static_cast<T>(1) / static_cast<T>(N));
+		T estimate = 0;
+		for (uint32_t iteration = 0; iteration < 5; iteration++)
+		{
+			const Vector<T, N> y = solve(x);
+			Vector<T, N> signs;
+			estimate = 0;
+			Unroll<N>([&](auto idx)
+			{
+				estimate += std::abs(y.data[idx]);
+				signs.data[idx] = y.data[idx] < 0 ? T(-1) : T(1);
+			});
+
+			const Vector<T, N> z = solveTranspose(signs);
+			size_t best = 0;
+			T zx = 0;
+			Unroll<N>([&](auto idx)
+			{
+				zx += z.data[idx] * x.data[idx];
+				if (std::abs(z.data[idx]) > std::abs(z.data[best]))
+					best = idx;
+			});
+			if (iteration > 0 && std::abs(z.data[best]) <= zx)
+				break;
+			x = Vector<T, N>();
+			x.data[best] = 1;
+		}
+		return estimate;
+	}
+
+	//LU factorisation with partial pivoting, P A = L U, for solving small dense systems without forming the inverse.
+	//L has a unit diagonal and is stored below the diagonal of the factors, U on and above it.
+	template<std::floating_point T, size_t N>
+	class LU
+	{
+	private:
+		T m_Factors[N][N];
+		uint32_t m_Permutation[N];
+		T m_Sign;
+		T m_Norm1;
+		bool m_Singular;
+
+		//Factorises a in place. The pivot row is chosen and swapped in with selects, so every lane of a block takes the same path.
+		//The swaps also apply to the extra columns in rhs and to the permutation, whose row indices are held in V so the same selects move them.
+		//Returns false where a pivot is 0.
+		template<typename V, size_t K>
+		static inline auto FactoriseKernel(V (&a)[N][N], V (&permutation)[N], V& sign, V (&rhs)[N][K])
+		{
+			using S = typename LaneTraits<V>::Scalar;
+			typename LaneTraits<V>::Mask singular = false;
+			Unroll<N>([&](auto k)
+			{
+				V pivot = static_cast<S>(k);
+				V best = Abs(a[k][k]);
+				Unroll<N>([&](auto r)
+				{
+					if constexpr (r > k)
+					{
+						const auto larger = Abs(a[r][k]) > best;
+						best = Select(larger, Abs(a[r][k]), best);
+						pivot = Select(larger, V(static_cast<S>(r)), pivot);
+					}
+				});
+
+				Unroll<N>([&](auto r)
+				{
+					if constexpr (r > k)
+					{
+						const auto swap = pivot == V(static_cast<S>(r));
+						Unroll<N>([&](auto c)
+						{
+							const V ak = a[k][c], ar = a[r][c];
+							a[k][c] = Select(swap, ar, ak);
+							a[r][c] = Select(swap, ak, ar);
+						});
+						Unroll<K>([&](auto c)
+						{
+							const V bk = rhs[k][c], br = rhs[r][c];
+							rhs[k][c] = Select(swap, br, bk);
+							rhs[r][c] = Select(swap, bk, br);
+						});
+						const V pk = permutation[k], pr = permutation[r];
+						permutation[k] = Select(swap, pr, pk);
+						permutation[r] = Select(swap, pk, pr);
+						sign = Select(swap, -sign, sign);
+					}
+				});
+
+				const auto zero = best == V(0);
+				singular = singular | zero;
+				const V invPivot = Select(zero, V(0), 1 / a[k][k]);
+				Unroll<N>([&](auto r)
+				{
+					if constexpr (r > k)
+					{
+						const V l = a[r][k] * invPivot;
+						a[r][k] = l;
+						Unroll<N>([&](auto c)
+						{
+							if constexpr (c > k)
+								a[r][c] -= l * a[k][c];
+						});
+					}
+				});
+			});
+			return !singular;
+		}
+
+		//Solves L U x = b for an already permuted b.
+		template<typename V>
+		static inline void SubstituteKernel(const V (&lu)[N][N], const V (&b)[N], V (&x)[N])
+		{
+			V y[N];
+			Unroll<N>([&](auto r)
+			{
+				V sum = b[r];
+				Unroll<N>([&](auto c) { if constexpr (c < r) sum -= lu[r][c] * y[c]; });
+				y[r] = sum;
+			});
+			Unroll<N>([&](auto idx)
+			{
+				constexpr size_t r = N - 1 - idx;
+				V sum = y[r];
+				Unroll<N>([&](auto c) { if constexpr (c > r) sum -= lu[r][c] * x[c]; });
+				x[r] = Select(lu[r][r] != V(0), sum / lu[r][r], V(0));
+			});
+		}
+
+	public:
+		//Constructs an empty LU, marked singular.
+		LU()
+			: m_Factors{}, m_Permutation{}, m_Sign(1), m_Norm1(0), m_Singular(true) {}
+		//Constructs an LU by factorising the input.
+		explicit LU(const Matrix<T, N, N>& input)
+		{
+			Factorise(input);
+		}
+
+		//Destructs the LU.
+		~LU() {}
+
+		//Factorises the input. Returns false if the input is singular.
+		bool Factorise(const Matrix<T, N, N>& input)
+		{
+			Unroll<N * N>([&](auto e) { m_Factors[e / N][e % N] = input.data[e]; });
+			m_Norm1 = MatrixNorm1(input);
+			m_Sign = 1;
+			T permutation[N], unused[N][1] = {};
+			Unroll<N>([&](auto idx) { permutation[idx] = static_cast<T>(idx); });
+			m_Singular = !FactoriseKernel(m_Factors, permutation, m_Sign, unused);
+			Unroll<N>([&](auto idx) { m_Permutation[idx] = static_cast<uint32_t>(permutation[idx]); });
+			return !m_Singular;
+		}
+
+		//Solves A x = b. Returns 0 if the matrix is singular.
+		Vector<T, N> Solve(const Vector<T, N>& b) const
+		{
+			Vector<T, N> result;
+			if (m_Singular)
+				return result;
+			T permuted[N];
+			Unroll<N>([&](auto idx) { permuted[idx] = b.data[m_Permutation[idx]]; });
+			SubstituteKernel(m_Factors, permuted, result.data);
+			return result;
+		}
+		//Solves A X = B for the K right-hand sides in the columns of B. Returns 0 if the matrix is singular.
+		template<size_t K>
+		Matrix<T, N, K> Solve(const Matrix<T, N, K>& b) const
+		{
+			Matrix<T, N, K> result;
+			Unroll<K>([&](auto col)
+			{
+				const Vector<T, N> x = Solve(b.Column(col));
+				Unroll<N>([&](auto row) { result.data[row * K + col] = x.data[row]; });
+			});
+			return result;
+		}
+		//Solves A^T x = b. Returns 0 if the matrix is singular.
+		Vector<T, N> SolveTranspose(const Vector<T, N>& b) const
+		{
+			Vector<T, N> result;
+			if (m_Singular)
+				return result;
+			const T (&lu)[N][N] = m_Factors;
+			//U^T w = b, then L^T v = w, then x = P^T v.
+			T w[N], v[N];
+			Unroll<N>([&](auto r)
+			{
+				T sum = b.data[r];
+				Unroll<N>([&](auto c) { if constexpr (c < r) sum -= lu[c][r] * w[c]; });
+				w[r] = sum / lu[r][r];
+			});
+			Unroll<N>([&](auto idx)
+			{
+				constexpr size_t r = N - 1 - idx;
+				T sum = w[r];
+				Unroll<N>([&](auto c) { if constexpr (c > r) sum -= lu[c][r] * v[c]; });
+				v[r] = sum;
+			});
+			Unroll<N>([&](auto idx) { result.data[m_Permutation[idx]] = v[idx]; });
+			return result;
+		}
+
+		//Returns the determinant of the factorised matrix.
+		T Det() const
+		{
+			T result = m_Sign;
+			Unroll<N>([&](auto idx) { result *= m_Factors[idx][idx]; });
+			return result;
+		}
+		//Estimates the 1-norm condition number ||A||_1 * ||A^-1||_1, or returns infinity if the matrix is singular.
+		T ConditionNumber() const
+		{
+			if (m_Singular)
+				return std::numeric_limits<T>::infinity();
+			return m_Norm1 * EstimateInverseNorm1<T, N>([&](const Vector<T, N>& b) { return Solve(b); }, [&](const Vector<T, N>& b) { return SolveTranspose(b); });
+		}
+
+		inline bool IsSingular() const { return m_Singular; }
+		//Returns L below the diagonal and U on and above it.
+		Matrix<T, N, N> GetFactors() const
+		{
+			Matrix<T, N, N> result;
+			Unroll<N * N>([&](auto e) { result.data[e] = m_Factors[e / N][e % N]; });
+			return result;
+		}
+
+		//Solves min(matrices.size(), rhs.size(), solutions.size()) independent systems A x = b, Lanes at a time.
+		//Accepts Matrix2/3/4 or Matrix<T, N, N> and Vector2/3/4 or Vector<T, N>. Singular systems get a solution of 0 and make it return false.
+		template<size_t Lanes = 8, typename MatrixType, typename VectorType>
+		static bool Solve(std::span<const MatrixType> matrices, std::span<const VectorType> rhs, std::span<VectorType> solutions)
+		{
+			using V = LaneArray<T, Lanes>;
+			return SolveLinearSystems<T, N, Lanes>(matrices, rhs, solutions, [](V (&a)[N][N], const V (&b)[N], V (&x)[N])
+			{
+				V permutation[N], sign = 1, permuted[N][1];
+				Unroll<N>([&](auto idx)
+				{
+					permutation[idx] = static_cast<T>(idx);
+					permuted[idx][0] = b[idx];
+				});
+				const LaneMask<T, Lanes> valid = FactoriseKernel(a, permutation, sign, permuted);
+				V y[N];
+				Unroll<N>([&](auto idx) { y[idx] = permuted[idx][0]; });
+				SubstituteKernel(a, y, x);
+				return valid;
+			});
+		}
+	};
+
+	//Cholesky factorisation A = L L^T of a symmetric positive definite matrix. Only the lower triangle of the input is read.
+	template<std::floating_point T, size_t N>
+	class Cholesky
+	{
+	private:
+		T m_Factor[N][N];
+		T m_Norm1;
+		bool m_Valid;
+
+		//Factorises a into its lower triangle without branching. Returns false where a is not positive definite.
+		template<typename V>
+		static inline auto FactoriseKernel(V (&a)[N][N])
+		{
+			typename LaneTraits<V>::Mask valid = true;
+			Unroll<N>([&](auto k)
+			{
+				V diagonal = a[k][k];
+				Unroll<N>([&](auto c) { if constexpr (c < k) diagonal -= a[k][c] * a[k][c]; });
+				const auto positive = diagonal > V(0);
+				valid = valid & positive;
+				const V root = Sqrt(Max(diagonal, V(0)));
+				const V invRoot = Select(positive, 1 / root, V(0));
+				a[k][k] = root;
+				Unroll<N>([&](auto r)
+				{
+					if constexpr (r > k)
+					{
+						V sum = a[r][k];
+						Unroll<N>([&](auto c) { if constexpr (c < k) sum -= a[r][c] * a[k][c]; });
+						a[r][k] = sum * invRoot;
+					}
+				});
+				Unroll<N>([&](auto c) { if constexpr (c > k) a[k][c] = V(0); });
+			});
+			return valid;
+		}
+
+		//Solves L L^T x = b.
+		template<typename V>
+		static inline void SubstituteKernel(const V (&l)[N][N], const V (&b)[N], V (&x)[N])
+		{
+			V y[N];
+			Unroll<N>([&](auto r)
+			{
+				V sum = b[r];
+				Unroll<N>([&](auto c) { if constexpr (c < r) sum -= l[r][c] * y[c]; });
+				y[r] = Select(l[r][r] != V(0), sum / l[r][r], V(0));
+			});
+			Unroll<N>([&](auto idx)
+			{
+				constexpr size_t r = N - 1 - idx;
+				V sum = y[r];
+				Unroll<N>([&](auto c) { if constexpr (c > r) sum -= l[c][r] * x[c]; });
+				x[r] = Select(l[r][r] != V(0), sum / l[r][r], V(0));
+			});
+		}
+
+	public:
+		//Constructs an empty Cholesky, marked invalid.
+		Cholesky()
+			: m_Factor{}, m_Norm1(0), m_Valid(false) {}
+		//Constructs a Cholesky by factorising the input.
+		explicit Cholesky(const Matrix<T, N, N>& input)
+		{
+			Factorise(input);
+		}
+
+		//Destructs the Cholesky.
+		~Cholesky() {}
+
+		//Factorises the input. Returns false if the input is not positive definite.
+		bool Factorise(const Matrix<T, N, N>& input)
+		{
+			//Mirror the lower triangle, so the norm is that of the symmetric matrix.
+			Matrix<T, N, N> symmetric;
+			Unroll<N * N>([&](auto e)
+			{
+				constexpr size_t row = e / N, col = e % N;
+				symmetric.data[e] = col > row ? input.data[col * N + row] : input.data[e];
+				m_Factor[row][col] = symmetric.data[e];
+			});
+			m_Norm1 = MatrixNorm1(symmetric);
+			m_Valid = FactoriseKernel(m_Factor);
+			return m_Valid;
+		}
+
+		//Solves A x = b. Returns 0 if the matrix is not positive definite.
+		Vector<T, N> Solve(const Vector<T, N>& b) const
+		{
+			Vector<T, N> result;
+			if (m_Valid)
+				SubstituteKernel(m_Factor, b.data, result.data);
+			return result;
+		}
+		//Solves A X = B for the K right-hand sides in the columns of B. Returns 0 if the matrix is not positive definite.
+		template<size_t K>
+		Matrix<T, N, K> Solve(const Matrix<T, N, K>& b) const
+		{
+			Matrix<T, N, K> result;
+			Unroll<K>([&](auto col)
+			{
+				const Vector<T, N> x = Solve(b.Column(col));
+				Unroll<N>([&](auto row) { result.data[row * K + col] = x.data[row]; });
+			});
+			return result;
+		}
+
+		//Returns the determinant of the factorised matrix.
+		T Det() const
+		{
+			T result = 1;
+			Unroll<N>([&](auto idx) { result *= m_Factor[idx][idx] * m_Factor[idx][idx]; });
+			return result;
+		}
+		//Estimates the 1-norm condition number ||A||_1 * ||A^-1||_1, or returns infinity if the matrix is not positive definite.
+		T ConditionNumber() const
+		{
+			if (!m_Valid)
+				return std::numeric_limits<T>::infinity();
+			auto solve = [&](const Vector<T, N>& b) { return Solve(b); };
+			return m_Norm1 * EstimateInverseNorm1<T, N>(solve, solve);
+		}
+
+		inline bool IsValid() const { return m_Valid; }
+		//Returns L, with zeros above the diagonal.
+		Matrix<T, N, N> GetFactor() const
+		{
+			Matrix<T, N, N> result;
+			Unroll<N * N>([&](auto e) { result.data[e] = m_Factor[e / N][e % N]; });
+			return result;
+		}
+
+		//Solves min(matrices.size(), rhs.size(), solutions.size()) independent symmetric positive definite systems A x = b, Lanes at a time.
+		//Systems that are not positive definite get a solution of 0 and make it return false.
+		template<size_t Lanes = 8, typename MatrixType, typename VectorType>
+		static bool Solve(std::span<const MatrixType> matrices, std::span<const VectorType> rhs, std::span<VectorType> solutions)
+		{
+			using V = LaneArray<T, Lanes>;
+			return SolveLinearSystems<T, N, Lanes>(matrices, rhs, solutions, [](V (&a)[N][N], const V (&b)[N], V (&x)[N])
+			{
+				const LaneMask<T, Lanes> valid = FactoriseKernel(a);
+				SubstituteKernel(a, b, x);
+				return valid;
+			});
+		}
+	};
+
+	template<typename T, StorageOrder O> LU(const Matrix2<T, O>&) -> LU<T, 2>;
+	template<typename T, StorageOrder O> LU(const Matrix3<T, O>&) -> LU<T, 3>;
+	template<typename T, StorageOrder O> LU(const Matrix4<T, O>&) -> LU<T, 4>;
+	template<typename T, size_t N> LU(const Matrix<T, N, N>&) -> LU<T, N>;
+	template<typename T, StorageOrder O> Cholesky(const Matrix2<T, O>&) -> Cholesky<T, 2>;
+	template<typename T, StorageOrder O> Cholesky(const Matrix3<T, O>&) -> Cholesky<T, 3>;
+	template<typename T, StorageOrder O> Cholesky(const Matrix4<T, O>&) -> Cholesky<T, 4>;
+	template<typename T, size_t N> Cholesky(const Matrix<T, N, N>&) -> Cholesky<T, N>;
+}
@@ -0,0 +1,361 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Other/Instrumentation.h"
+#include "../Vector/Vector.h"
+
+namespace mars
+{
+	//Fixed-size matrix of R rows and C columns, stored row-major. Multiply, transpose, determinant and inverse are unrolled at compile-time,
+	//with closed-form specialisations for 2x2, 3x3 and 4x4. All results are computed in T; nothing is narrowed to float.
+	template<typename T, size_t R, size_t C>
+	class Matrix
+	{
+		static_assert(R > 0 && C > 0, "Matrix must have at least one row and one column.");
+
+	public:
+		T data[R * C];
+
+		//Constructs a Matrix of 0.
+		Matrix()
+			: data{} {}
+		//Constructs a Matrix taking R * C components in row-major order.
+		template<typename... Args> requires (sizeof...(Args) == R * C && R * C > 1)
+		Matrix(Args... args)
+			: data{ static_cast<T>(args)... } {}
+		//Constructs a Matrix where the diagonal is the input.
+		explicit Matrix(T diagonal)
+			: data{}
+		{
+			Unroll<(R < C ? R : C)>([&](auto idx) { data[idx * C + idx] = diagonal; });
+		}
+
+		//Destructs the Matrix.
+		~Matrix() {}
+
+		//Returns the component at the row and column.
+		T& operator()(size_t row, size_t col) { return data[row * C + col]; }
+		//Returns the component at the row and column.
+		const T& operator()(size_t row, size_t col) const { return data[row * C + col]; }
+
+		//Returns the row at the index as a Vector.
+		Vector<T, C> Row(size_t row) const
+		{
+			Vector<T, C> result;
+			Unroll<C>([&](auto col) { result.data[col] = data[row * C + col]; });
+			return result;
+		}
+		//Returns the column at the index as a Vector.
+		Vector<T, R> Column(size_t col) const
+		{
+			Vector<T, R> result;
+			Unroll<R>([&](auto row) { result.data[row] = data[row * C + col]; });
+			return result;
+		}
+
+		//Constructs a Matrix where the diagonal is 1.
+		static Matrix Identity() requires (R == C)
+		{
+			return Matrix(static_cast<T>(1));
+		}
+
+		//Returns the current matrix object with the given row and column removed.
+		Matrix<T, R - 1, C - 1> Minor(size_t row, size_t col) const requires (R > 1 && C > 1)
+		{
+			Matrix<T, R - 1, C - 1> result;
+			Unroll<(R - 1) * (C - 1)>([&](auto idx)
+			{
+				const size_t r = idx / (C - 1);
+				const size_t c = idx % (C - 1);
+				result.data[idx] = data[(r < row ? r : r + 1) * C + (c < col ? c : c + 1)];
+			});
+			return result;
+		}
+
+		//Calcuates determinant.
+		T Det() const requires (R == C)
+		{
+			const T* m = data;
+			if constexpr (R == 1)
+			{
+				return m[0];
+			}
+			else if constexpr (R == 2)
+			{
+				return m[0] * m[3] - m[1] * m[2];
+			}
+			else if constexpr (R == 3)
+			{
+				return m[0] * (m[4] * m[8] - m[5] * m[7])
+					- m[1] * (m[3] * m[8] - m[5] * m[6])
+					+ m[2] * (m[3] * m[7] - m[4] * m[6]);
+			}
+			else if constexpr (R == 4)
+			{
+				T s0 = m[0] * m[5] - m[4] * m[1];
+				T s1 = m[0] * m[6] - m[4] * m[2];
+				T s2 = m[0] * m[7] - m[4] * m[3];
+				T s3 = m[1] * m[6] - m[5] * m[2];
+				T s4 = m[1] * m[7] - m[5] * m[3];
+				T s5 = m[2] * m[7] - m[6] * m[3];
+
+				T c5 = m[10] * m[15] - m[14] * m[11];
+				T c4 = m[9] * m[15] - m[13] * m[11];
+				T c3 = m[9] * m[14] - m[13] * m[10];
+				T c2 = m[8] * m[15] - m[12] * m[11];
+				T c1 = m[8] * m[14] - m[12] * m[10];
+				T c0 = m[8] * m[13] - m[12] * m[9];
+
+				return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+			}
+			else
+			{
+				//Laplace expansion along the first row.
+				T result = 0;
+				Unroll<C>([&](auto col)
+				{
+					T cofactor = Minor(0, col).Det();
+					result += (col % 2 == 0) ? m[col] * cofactor : -(m[col] * cofactor);
+				});
+				return result;
+			}
+		}
+
+		//Swaps the Column/Row Major Ording of the input matrix object, return to a new Matrix object.
+		static Matrix<T, C, R> Transpose(const Matrix& input)
+		{
+			Matrix<T, C, R> result;
+			Unroll<R * C>([&](auto idx) { result.data[(idx % C) * R + (idx / C)] = input.data[idx]; });
+			return result;
+		}
+		//Swaps the Column/Row Major Ording of the current matrix object, return to a new Matrix object.
+		Matrix<T, C, R> Transpose() const
+		{
+			return Matrix::Transpose(*this);
+		}
+
+		//Inverts the current matrix object.
+		Matrix Inverse() requires (R == C)
+		{
+			*this = Matrix::Inverse(*this);
+			return *this;
+		}
+		//Inverts the input matrix object, return to a new Matrix object. If the determinant is 0, the input is returned.
+		static Matrix Inverse(const Matrix& input) requires (R == C)
+		{
+			MARS_INSTRUMENT(MatrixInverse);
+			const T* m = input.data;
+			Matrix result;
+			T* r = result.data;
+			T det = 0;
+
+			if constexpr (R == 1)
+			{
+				det = m[0];
+				r[0] = 1;
+			}
+			else if constexpr (R == 2)
+			{
+				det = input.Det();
+				r[0] = m[3]; r[1] = -m[1];
+				r[2] = -m[2]; r[3] = m[0];
+			}
+			else if constexpr (R == 3)
+			{
+				r[0] = m[4] * m[8] - m[5] * m[7];
+				r[1] = m[2] * m[7] - m[1] * m[8];
+				r[2] = m[1] * m[5] - m[2] * m[4];
+				r[3] = m[5] * m[6] - m[3] * m[8];
+				r[4] = m[0] * m[8] - m[2] * m[6];
+				r[5] = m[2] * m[3] - m[0] * m[5];
+				r[6] = m[3] * m[7] - m[4] * m[6];
+				r[7] = m[1] * m[6] - m[0] * m[7];
+				r[8] = m[0] * m[4] - m[1] * m[3];
+				det = m[0] * r[0] + m[1] * r[3] + m[2] * r[6];
+			}
+			else if constexpr (R == 4)
+			{
+				T s0 = m[0] * m[5] - m[4] * m[1];
+				T s1 = m[0] * m[6] - m[4] * m[2];
+				T s2 = m[0] * m[7] - m[4] * m[3];
+				T s3 = m[1] * m[6] - m[5] * m[2];
+				T s4 = m[1] * m[7] - m[5] * m[3];
+				T s5 = m[2] * m[7] - m[6] * m[3];
+
+				T c5 = m[10] * m[15] - m[14] * m[11];
+				T c4 = m[9] * m[15] - m[13] * m[11];
+				T c3 = m[9] * m[14] - m[13] * m[10];
+				T c2 = m[8] * m[15] - m[12] * m[11];
+				T c1 = m[8] * m[14] - m[12] * m[10];
+				T c0 = m[8] * m[13] - m[12] * m[9];
+
+				det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+
+				r[0] = m[5] * c5 - m[6] * c4 + m[7] * c3;
+				r[1] = -m[1] * c5 + m[2] * c4 - m[3] * c3;
+				r[2] = m[13] * s5 - m[14] * s4 + m[15] * s3;
+				r[3] = -m[9] * s5 + m[10] * s4 - m[11] * s3;
+
+				r[4] = -m[4] * c5 + m[6] * c2 - m[7] * c1;
+				r[5] = m[0] * c5 - m[2] * c2 + m[3] * c1;
+				r[6] = -m[12] * s5 + m[14] * s2 - m[15] * s1;
+				r[7] = m[8] * s5 - m[10] * s2 + m[11] * s1;
+
+				r[8] = m[4] * c4 - m[5] * c2 + m[7] * c0;
+				r[9] = -m[0] * c4 + m[1] * c2 - m[3] * c0;
+				r[10] = m[12] * s4 - m[13] * s2 + m[15] * s0;
+				r[11] = -m[8] * s4 + m[9] * s2 - m[11] * s0;
+
+				r[12] = -m[4] * c3 + m[5] * c1 - m[6] * c0;
+				r[13] = m[0] * c3 - m[1] * c1 + m[2] * c0;
+				r[14] = -m[12] * s3 + m[13] * s1 - m[14] * s0;
+				r[15] = m[8] * s3 - m[9] * s1 + m[10] * s0;
+			}
+			else
+			{
+				//Adjugate from the cofactors.
+				det = input.Det();
+				Unroll<R * C>([&](auto idx)
+				{
+					const size_t row = idx / C;
+					const size_t col = idx % C;
+					T cofactor = input.Minor(row, col).Det();
+					r[col * R + row] = ((row + col) % 2 == 0) ? cofactor : -cofactor;
+				});
+			}
+
+			if (det == 0)
+			{
+				MARS_INSTRUMENT_EVENT(SingularInverse);
+				return input;
+			}
+
+			if constexpr (std::is_floating_point_v<T>)
+			{
+				T invDet = static_cast<T>(1) / det;
+				Unroll<R * C>([&](auto idx) { r[idx] *= invDet; });
+			}
+			else
+			{
+				Unroll<R * C>([&](auto idx) { r[idx] /= det; });
+			}
+			return result;
+		}
+
+		//Multiplies a Vector input by the current matrix transform.
+		Vector<T, R> operator*(const Vector<T, C>& input) const
+		{
+			Vector<T, R> result;
+			Unroll<R>([&](auto row)
+			{
+				T sum = 0;
+				Unroll<C>([&](auto col) { sum += data[row * C + col] * input.data[col]; });
+				result.data[row] = sum;
+			});
+			return result;
+		}
+		//Multiplies, or creates the composition of, the current Matrix by a Matrix input.
+		template<size_t K>
+		Matrix<T, R, K> operator*(const Matrix<T, C, K>& input) const
+		{
+			Matrix<T, R, K> result;
+			Unroll<R * K>([&](auto idx)
+			{
+				const size_t row = idx / K;
+				const size_t col = idx % K;
+				T sum = 0;
+				Unroll<C>([&](auto inner) { sum += data[row * C + inner] * input.data[inner * K + col]; });
+				result.data[idx] = sum;
+			});
+			return result;
+		}
+		//Multiplies, or creates the composition of, the current Matrix by a Matrix input.
+		Matrix& operator*=(const Matrix<T, C, C>& input)
+		{
+			*this = *this * input;
+			return *this;
+		}
+
+		//Adds two Matrices.
+		Matrix operator+ (const Matrix& other) const
+		{
+			Matrix result;
+			Unroll<R * C>([&](auto idx) { result.data[idx] = data[idx] + other.data[idx]; });
+			return result;
+		}
+		//Subtracts two Matrices.
+		Matrix operator- (const Matrix& other) const
+		{
+			Matrix result;
+			Unroll<R * C>([&](auto idx) { result.data[idx] = data[idx] - other.data[idx]; });
+			return result;
+		}
+		//Scales the Matrix by the scaler a. The scaler go on the rhs of the object.
+		Matrix operator* (T a) const
+		{
+			Matrix result;
+			Unroll<R * C>([&](auto idx) { result.data[idx] = data[idx] * a; });
+			return result;
+		}
+
+		//Compare the Matrix with another Matrix. If it's equal, it'll return true.
+		bool operator== (const Matrix& other) const
+		{
+			bool result = true;
+			Unroll<R * C>([&](auto idx) { result = result && (data[idx] == other.data[idx]); });
+			return result;
+		}
+		//Compare the Matrix with another Matrix. If it's not equal, it'll return true.
+		bool operator!= (const Matrix& other) const
+		{
+			return !(*this == other);
+		}
+
+		//Output stream operator.
+		friend std::ostream& operator<< (std::ostream& stream, const Matrix& output)
+		{
+			SetOstream(stream);
+			for (size_t row = 0; row < R; row++)
+			{
+				for (size_t col = 0; col < C; col++)
+					stream << output.data[row * C + col] << (col + 1 < C ? ", " : "");
+				if (row + 1 < R)
+					stream << std::endl;
+			}
+			ResetOstream(stream);
+			return stream;
+		}
+
+		inline const T* const GetData() const { return data; }
+		constexpr static inline size_t GetSize() { return sizeof(Matrix); }
+	};
+
+	typedef Matrix<float, 2, 3> float2x3;
+	typedef Matrix<double, 2, 3> double2x3;
+	typedef Matrix<int32_t, 2, 3> int2x3;
+	typedef Matrix<uint32_t, 2, 3> uint2x3;
+
+	typedef Matrix<float, 3, 2> float3x2;
+	typedef Matrix<double, 3, 2> double3x2;
+	typedef Matrix<int32_t, 3, 2> int3x2;
+	typedef Matrix<uint32_t, 3, 2> uint3x2;
+
+	typedef Matrix<float, 2, 4> float2x4;
+	typedef Matrix<double, 2, 4> double2x4;
+	typedef Matrix<int32_t, 2, 4> int2x4;
+	typedef Matrix<uint32_t, 2, 4> uint2x4;
+
+	typedef Matrix<float, 4, 2> float4x2;
+	typedef Matrix<double, 4, 2> double4x2;
+	typedef Matrix<int32_t, 4, 2> int4x2;
+	typedef Matrix<uint32_t, 4, 2> uint4x2;
+
+	typedef Matrix<float, 3, 4> float3x4;
+	typedef Matrix<double, 3, 4> double3x4;
+	typedef Matrix<int32_t, 3, 4> int3x4;
+	typedef Matrix<uint32_t, 3, 4> uint3x4;
+
+	typedef Matrix<float, 4, 3> float4x3;
+	typedef Matrix<double, 4, 3> double4x3;
+	typedef Matrix<int32_t, 4, 3> int4x3;
+	typedef Matrix<uint32_t, 4, 3> uint4x3;
+}
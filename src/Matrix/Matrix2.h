@@ -1,35 +1,68 @@
 #pragma once
 #include "../mars_common.h"
+#include "../Other/Parallel.h"
+#include "Matrix.h"
 
 namespace mars
 {
 	template<typename T> class Vector2;
 
+	//Storage for the Matrix2 components. The components are always named in row-major order (a, b is the first row),
+	//the declaration order sets the layout in memory.
+	template<typename T, StorageOrder O> struct Matrix2Storage;
+
 	template<typename T>
-	class Matrix2
+	struct Matrix2Storage<T, StorageOrder::RowMajor>
 	{
-	public:
 		T a, b, c, d;
 
+		Matrix2Storage(T a, T b, T c, T d)
+			: a(a), b(b), c(c), d(d) {}
+	};
+
+	template<typename T>
+	struct Matrix2Storage<T, StorageOrder::ColumnMajor>
+	{
+		T a, c, b, d;
+
+		Matrix2Storage(T a, T b, T c, T d)
+			: a(a), c(c), b(b), d(d) {}
+	};
+
+	template<typename T, StorageOrder O>
+	class Matrix2 : public Matrix2Storage<T, O>
+	{
+	public:
+		using Storage = Matrix2Storage<T, O>;
+		using Storage::a, Storage::b, Storage::c, Storage::d;
+		using OppositeOrder = Matrix2<T, O == StorageOrder::RowMajor ? StorageOrder::ColumnMajor : StorageOrder::RowMajor>;
+
 		//Constructs a Matrix2 of 0.
 		Matrix2()
-			:a(0), b(0), c(0), d(0) {}
+			: Storage(0, 0, 0, 0) {}
 		//Constructs a Matrix2 taking a, b, c, d.
 		Matrix2(T a, T b, T c, T d)
-			: a(a), b(b), c(c), d(d) {}
+			: Storage(a, b, c, d) {}
 		//Constructs a Matrix2 from two Vector2s.
 		Matrix2(const Vector2<T>& a, const Vector2<T>& b)
-			: a(a.x), b(a.y), c(b.x), d(b.y) {}
+			: Storage(a.x, a.y, b.x, b.y) {}
+		//Constructs a Matrix2 from the generic Matrix<T, 2, 2>.
+		Matrix2(const Matrix<T, 2, 2>& other)
+			: Storage(other.data[0], other.data[1], other.data[2], other.data[3]) {}
+		//Constructs a Matrix2 from a Matrix2 of the opposite storage order.
+		Matrix2(const OppositeOrder& other)
+			: Storage(other.a, other.b, other.c, other.d) {}
 
 		//Destructs the Matrix2.
 		~Matrix2() {}
 
+		//Generic Matrix<T, 2, 2> operator implicit cast.
+		inline operator Matrix<T, 2, 2>() const { return Matrix<T, 2, 2>(a, b, c, d); }
+
 		//Calcuates determinant, and returns the sum of the vector components.
-		float Det() const
+		T Det() const
 		{
-			float temp_i = static_cast<float>(a * d);
-			float temp_j = static_cast<float>(b * c);
-			return temp_i - temp_j;
+			return Matrix<T, 2, 2>(*this).Det();
 		}
 		//Calcuates determinant, and returns as a vector.
 		Vector2<T> VecDet() const
@@ -48,7 +81,7 @@ namespace mars
 		//Swaps the Column/Row Major Ording of the input matrix object, return to a new Matrix2 object.
 		static Matrix2 Transpose(const Matrix2& input)
 		{
-			return Matrix2(input.a, input.c, input.b, input.d);
+			return Matrix<T, 2, 2>::Transpose(input);
 		}
 
 		//Inverts the current matrix object.
@@ -60,28 +93,18 @@ namespace mars
 		//Inverts the input matrix object, return to a new Matrix2 object.
 		static Matrix2 Inverse(const Matrix2& input)
 		{
-			T det = static_cast<T>(input.Det());
-			if (det == 0.0f)
-				return input;
-
-			return Matrix2((input.d) / det, (-1 * input.b) / det, (-1 * input.c) / det, (input.a) / det);
+			return Matrix<T, 2, 2>::Inverse(input);
 		}
 
 		//Multiplies a Vector2 input by the current matrix transform.
 		Vector2<T> operator*(const Vector2<T>& input) const
 		{
-			Vector2<T> transform_i(a, c);
-			Vector2<T> transform_j(b, d);
-			return Vector2<T>(transform_i * input.x + transform_j * input.y);
+			return Matrix<T, 2, 2>(*this) * Vector<T, 2>(input);
 		}
 		//Multiplies, or creates the composition of, the current Matrix2 by a Matrix2 input.
 		Matrix2 operator*(const Matrix2& input) const
 		{
-			Vector2<T> input_i(input.a, input.c);
-			Vector2<T> input_j(input.b, input.d);
-			Vector2<T> output_i = *this * input_i;
-			Vector2<T> output_j = *this * input_j;
-			return Matrix2(output_i, output_j).Transpose();
+			return Matrix<T, 2, 2>(*this) * Matrix<T, 2, 2>(input);
 		}
 		//Multiplies, or creates the composition of, the current Matrix2 by a Matrix2 input.
 		Matrix2& operator*=(const Matrix2& input)
@@ -100,6 +123,22 @@ namespace mars
 			return stream;
 		}
 
+		//Converts the input matrices of the opposite storage order into outputs. Processes min(inputs.size(), outputs.size()) matrices.
+		static void ConvertStorageOrder(std::span<const OppositeOrder> inputs, std::span<Matrix2> outputs, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			const size_t count = std::min(inputs.size(), outputs.size());
+			Parallel::For(policy, count, Parallel::GetChunkSize(count, 4096), [&](size_t begin, size_t end)
+			{
+				Matrix2::ConvertStorageOrder(inputs[begin].GetData(), &outputs[begin].a, end - begin);
+			});
+		}
+		//Converts count raw 2x2 matrices from one storage order to the other, i.e. transposes each matrix in memory. src and dst must not overlap.
+		static void ConvertStorageOrder(const T* src, T* dst, size_t count)
+		{
+			for (size_t idx = 0; idx < count; idx++, src += 4, dst += 4)
+				Unroll<4>([&](auto elem) { dst[(elem % 2) * 2 + elem / 2] = src[elem]; });
+		}
+
 		inline const T* const GetData() const { return &a; }
 		constexpr static inline size_t GetSize() { return sizeof(Matrix2); }
 	};
@@ -1,36 +1,69 @@
 #pragma once
 #include "../mars_common.h"
+#include "../Other/Parallel.h"
+#include "Matrix.h"
 
 namespace mars
 {
 	template<typename T> class Vector3;
 
+	//Storage for the Matrix3 components. The components are always named in row-major order (a, b, c is the first row),
+	//the declaration order sets the layout in memory.
+	template<typename T, StorageOrder O> struct Matrix3Storage;
+
 	template<typename T>
-	class Matrix3
+	struct Matrix3Storage<T, StorageOrder::RowMajor>
 	{
-	public:
 		T a, b, c, d, e, f, g, h, i;
 
+		Matrix3Storage(T a, T b, T c, T d, T e, T f, T g, T h, T i)
+			: a(a), b(b), c(c), d(d), e(e), f(f), g(g), h(h), i(i) {}
+	};
+
+	template<typename T>
+	struct Matrix3Storage<T, StorageOrder::ColumnMajor>
+	{
+		T a, d, g, b, e, h, c, f, i;
+
+		Matrix3Storage(T a, T b, T c, T d, T e, T f, T g, T h, T i)
+			: a(a), d(d), g(g), b(b), e(e), h(h), c(c), f(f), i(i) {}
+	};
+
+	template<typename T, StorageOrder O>
+	class Matrix3 : public Matrix3Storage<T, O>
+	{
+	public:
+		using Storage = Matrix3Storage<T, O>;
+		using Storage::a, Storage::b, Storage::c, Storage::d, Storage::e, Storage::f, Storage::g, Storage::h, Storage::i;
+		using OppositeOrder = Matrix3<T, O == StorageOrder::RowMajor ? StorageOrder::ColumnMajor : StorageOrder::RowMajor>;
+
 		//Constructs a Matrix3 of 0.
 		Matrix3()
-			:a(0), b(0), c(0), d(0), e(0), f(0), g(0), h(0), i(0) {}
+			: Storage(0, 0, 0, 0, 0, 0, 0, 0, 0) {}
 		//Constructs a Vector3 taking a, b, c, d, e, f, g, h, i.
 		Matrix3(T a, T b, T c, T d, T e, T f, T g, T h, T i)
-			: a(a), b(b), c(c), d(d), e(e), f(f), g(g), h(h), i(i) {}
+			: Storage(a, b, c, d, e, f, g, h, i) {}
 		//Constructs a Matrix3 from three Vector3s.
 		Matrix3(const Vector3<T>& a, const Vector3<T>& b, const Vector3<T>& c)
-			: a(a.x), b(a.y), c(a.z), d(b.x), e(b.y), f(b.z), g(c.x), h(c.y), i(c.z) {}
+			: Storage(a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z) {}
+		//Constructs a Matrix3 from the generic Matrix<T, 3, 3>.
+		Matrix3(const Matrix<T, 3, 3>& other)
+			: Storage(other.data[0], other.data[1], other.data[2], other.data[3], other.data[4], other.data[5],
+			other.data[6], other.data[7], other.data[8]) {}
+		//Constructs a Matrix3 from a Matrix3 of the opposite storage order.
+		Matrix3(const OppositeOrder& other)
+			: Storage(other.a, other.b, other.c, other.d, other.e, other.f, other.g, other.h, other.i) {}
 
 		//Destructs the Matrix3.
 		~Matrix3() {}
 
+		//Generic Matrix<T, 3, 3> operator implicit cast.
+		inline operator Matrix<T, 3, 3>() const { return Matrix<T, 3, 3>(a, b, c, d, e, f, g, h, i); }
+
 		//Calcuates determinant, and returns the sum of the vector components.
-		float Det() const
+		T Det() const
 		{
-			T temp_i = a * (e * i - f * h);
-			T temp_j = b * (f * g - d * i);
-			T temp_k = c * (d * h - e * g);
-			return static_cast<float>(temp_i + temp_j + temp_k);
+			return Matrix<T, 3, 3>(*this).Det();
 		}
 		//Calcuates determinant, and returns as a vector.
 		Vector3<T> VecDet() const
@@ -50,7 +83,7 @@ namespace mars
 		//Swaps the Column/Row Major Ording of the input matrix object, return to a new Matrix3 object.
 		static Matrix3 Transpose(const Matrix3& input)
 		{
-			return Matrix3(input.a, input.d, input.g, input.b, input.e, input.h, input.c, input.f, input.i);
+			return Matrix<T, 3, 3>::Transpose(input);
 		}
 
 		//Inverts the current matrix object.
@@ -62,43 +95,18 @@ namespace mars
 		//Inverts the input matrix object, return to a new Matrix3 object.
 		static Matrix3 Inverse(const Matrix3& input)
 		{
-			float det = input.Det();
-			if (det == 0.0f)
-				return input;
-
-			Matrix3<T> result = Matrix3<T>
-				(
-					static_cast<T>(+Matrix2<T>(input.e, input.f, input.h, input.i).Det() / det),
-					static_cast<T>(-Matrix2<T>(input.b, input.c, input.h, input.i).Det() / det),
-					static_cast<T>(+Matrix2<T>(input.b, input.c, input.e, input.f).Det() / det),
-					static_cast<T>(-Matrix2<T>(input.d, input.f, input.g, input.i).Det() / det),
-					static_cast<T>(+Matrix2<T>(input.a, input.c, input.g, input.i).Det() / det),
-					static_cast<T>(-Matrix2<T>(input.a, input.c, input.d, input.f).Det() / det),
-					static_cast<T>(+Matrix2<T>(input.d, input.e, input.g, input.h).Det() / det),
-					static_cast<T>(-Matrix2<T>(input.a, input.b, input.g, input.h).Det() / det),
-					static_cast<T>(+Matrix2<T>(input.a, input.b, input.d, input.e).Det() / det)
-					);
-			return result;
+			return Matrix<T, 3, 3>::Inverse(input);
 		}
 
 		//Multiplies a Vector3 input by the current matrix transform.
 		Vector3<T> operator*(const Vector3<T>& input) const
 		{
-			Vector3<T> transform_i(a, d, g);
-			Vector3<T> transform_j(b, e, h);
-			Vector3<T> transform_k(c, f, i);
-			return Vector3<T>(transform_i * input.x + transform_j * input.y + transform_k * input.z);
+			return Matrix<T, 3, 3>(*this) * Vector<T, 3>(input);
 		}
 		//Multiplies, or creates the composition of, the current Matrix3 by a Matrix3 input.
 		Matrix3 operator*(const Matrix3& input) const
 		{
-			Vector3<T> input_i(input.a, input.d, input.g);
-			Vector3<T> input_j(input.b, input.e, input.h);
-			Vector3<T> input_k(input.c, input.f, input.i);
-			Vector3<T> output_i = *this * input_i;
-			Vector3<T> output_j = *this * input_j;
-			Vector3<T> output_k = *this * input_k;
-			return Matrix3(output_i, output_j, output_k).Transpose();
+			return Matrix<T, 3, 3>(*this) * Matrix<T, 3, 3>(input);
 		}
 		//Multiplies, or creates the composition of, the current Matrix3 by a Matrix3 input.
 		Matrix3& operator*=(const Matrix3& input)
@@ -118,6 +126,22 @@ namespace mars
 			return stream;
 		}
 
+		//Converts the input matrices of the opposite storage order into outputs. Processes min(inputs.size(), outputs.size()) matrices.
+		static void ConvertStorageOrder(std::span<const OppositeOrder> inputs, std::span<Matrix3> outputs, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			const size_t count = std::min(inputs.size(), outputs.size());
+			Parallel::For(policy, count, Parallel::GetChunkSize(count, 4096), [&](size_t begin, size_t end)
+			{
+				Matrix3::ConvertStorageOrder(inputs[begin].GetData(), &outputs[begin].a, end - begin);
+			});
+		}
+		//Converts count raw 3x3 matrices from one storage order to the other, i.e. transposes each matrix in memory. src and dst must not overlap.
+		static void ConvertStorageOrder(const T* src, T* dst, size_t count)
+		{
+			for (size_t idx = 0; idx < count; idx++, src += 9, dst += 9)
+				Unroll<9>([&](auto elem) { dst[(elem % 3) * 3 + elem / 3] = src[elem]; });
+		}
+
 		inline const T* const GetData() const { return &a; }
 		constexpr static inline size_t GetSize() { return sizeof(Matrix3); }
 	};
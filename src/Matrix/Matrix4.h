@@ -1,46 +1,150 @@
 #pragma once
 #include "../mars_common.h"
+#include "../Other/Instrumentation.h"
+#include "../Other/Parallel.h"
+#include "Matrix.h"
 
 namespace mars
 {
 	template<typename T> class Vector3;
 	template<typename T> class Vector4;
 
+	//Storage for the Matrix4 components. The components are always named in row-major order (a, b, c, d is the first row),
+	//the declaration order sets the layout in memory.
+	template<typename T, StorageOrder O> struct Matrix4Storage;
+
 	template<typename T>
-	class Matrix4
+	struct Matrix4Storage<T, StorageOrder::RowMajor>
 	{
-	public:
 		T a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p;
 
+		Matrix4Storage(T a, T b, T c, T d, T e, T f, T g, T h,
+			T i, T j, T k, T l, T m, T n, T o, T p)
+			: a(a), b(b), c(c), d(d), e(e), f(f), g(g), h(h),
+			i(i), j(j), k(k), l(l), m(m), n(n), o(o), p(p) {}
+	};
+
+	template<typename T>
+	struct Matrix4Storage<T, StorageOrder::ColumnMajor>
+	{
+		T a, e, i, m, b, f, j, n, c, g, k, o, d, h, l, p;
+
+		Matrix4Storage(T a, T b, T c, T d, T e, T f, T g, T h,
+			T i, T j, T k, T l, T m, T n, T o, T p)
+			: a(a), e(e), i(i), m(m), b(b), f(f), j(j), n(n),
+			c(c), g(g), k(k), o(o), d(d), h(h), l(l), p(p) {}
+	};
+
+	template<typename T, StorageOrder O>
+	class Matrix4 : public Matrix4Storage<T, O>
+	{
+	private:
+		//Inverse of the perspective projection [A, 0, X, 0; 0, B, Y, 0; 0, 0, C, E; 0, 0, D, 0].
+		static Matrix4 InversePerspective(T A, T B, T C, T D, T E, T X, T Y)
+		{
+			return Matrix4(
+				static_cast<T>(1) / A, 0, 0, -X / (A * D),
+				0, static_cast<T>(1) / B, 0, -Y / (B * D),
+				0, 0, 0, static_cast<T>(1) / D,
+				0, 0, static_cast<T>(1) / E, -C / (E * D));
+		}
+		//Inverse of the orthographic projection [A, 0, 0, X; 0, B, 0, Y; 0, 0, C, Z; 0, 0, 0, 1].
+		static Matrix4 InverseOrthographic(T A, T B, T C, T X, T Y, T Z)
+		{
+			return Matrix4(
+				static_cast<T>(1) / A, 0, 0, -X / A,
+				0, static_cast<T>(1) / B, 0, -Y / B,
+				0, 0, static_cast<T>(1) / C, -Z / C,
+				0, 0, 0, 1);
+		}
+
+		template<bool Point>
+		static void Transform(const Matrix4& matrix, std::span<const Vector3<T>> inputs, std::span<Vector3<T>> outputs, ExecutionPolicy policy)
+		{
+			constexpr size_t BlockSize = 64;
+			const T w = Point ? static_cast<T>(1) : static_cast<T>(0);
+			const T tx = matrix.d * w, ty = matrix.h * w, tz = matrix.l * w;
+			const size_t count = std::min(inputs.size(), outputs.size());
+			Parallel::For(policy, count, Parallel::GetChunkSize(count, 4096), [&](size_t begin, size_t end)
+			{
+				if (policy == ExecutionPolicy::Sequential)
+				{
+					for (size_t idx = begin; idx < end; idx++)
+					{
+						const Vector3<T>& v = inputs[idx];
+						outputs[idx] = Vector3<T>(matrix.a * v.x + matrix.b * v.y + matrix.c * v.z + tx,
+							matrix.e * v.x + matrix.f * v.y + matrix.g * v.z + ty,
+							matrix.i * v.x + matrix.j * v.y + matrix.k * v.z + tz);
+					}
+					return;
+				}
+
+				//Transpose each block to SoA so the arithmetic runs across whole registers.
+				for (size_t base = begin; base < end; base += BlockSize)
+				{
+					const size_t blockCount = std::min(BlockSize, end - base);
+					T x[BlockSize], y[BlockSize], z[BlockSize];
+					for (size_t idx = 0; idx < blockCount; idx++)
+					{
+						x[idx] = inputs[base + idx].x;
+						y[idx] = inputs[base + idx].y;
+						z[idx] = inputs[base + idx].z;
+					}
+					T rx[BlockSize], ry[BlockSize], rz[BlockSize];
+					for (size_t idx = 0; idx < blockCount; idx++)
+					{
+						rx[idx] = matrix.a * x[idx] + matrix.b * y[idx] + matrix.c * z[idx] + tx;
+						ry[idx] = matrix.e * x[idx] + matrix.f * y[idx] + matrix.g * z[idx] + ty;
+						rz[idx] = matrix.i * x[idx] + matrix.j * y[idx] + matrix.k * z[idx] + tz;
+					}
+					for (size_t idx = 0; idx < blockCount; idx++)
+						outputs[base + idx] = Vector3<T>(rx[idx], ry[idx], rz[idx]);
+				}
+			});
+		}
+
+	public:
+		using Storage = Matrix4Storage<T, O>;
+		using Storage::a, Storage::b, Storage::c, Storage::d, Storage::e, Storage::f, Storage::g, Storage::h,
+			Storage::i, Storage::j, Storage::k, Storage::l, Storage::m, Storage::n, Storage::o, Storage::p;
+		using OppositeOrder = Matrix4<T, O == StorageOrder::RowMajor ? StorageOrder::ColumnMajor : StorageOrder::RowMajor>;
+
 		//Constructs a Matrix4 of 0.
 		Matrix4()
-			:a(0), b(0), c(0), d(0), e(0), f(0), g(0), h(0),
-			i(0), j(0), k(0), l(0), m(0), n(0), o(0), p(0) {}
+			: Storage(0, 0, 0, 0, 0, 0, 0, 0,
+			0, 0, 0, 0, 0, 0, 0, 0) {}
 		//Constructs a Matrix4 taking a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p.
 		Matrix4(T a, T b, T c, T d, T e, T f, T g, T h,
 			T i, T j, T k, T l, T m, T n, T o, T p)
-			: a(a), b(b), c(c), d(d), e(e), f(f), g(g), h(h),
-			i(i), j(j), k(k), l(l), m(m), n(n), o(o), p(p) {}
+			: Storage(a, b, c, d, e, f, g, h,
+			i, j, k, l, m, n, o, p) {}
 		//Constructs a Matrix4 from four Vector4s.
 		Matrix4(const Vector4<T>& a, const Vector4<T>& b, const Vector4<T>& c, const Vector4<T>& d)
-			: a(a.x), b(a.y), c(a.z), d(a.w), e(b.x), f(b.y), g(b.z), h(b.w),
-			i(c.x), j(c.y), k(c.z), l(c.w), m(d.x), n(d.y), o(d.z), p(d.w) {}
+			: Storage(a.x, a.y, a.z, a.w, b.x, b.y, b.z, b.w,
+			c.x, c.y, c.z, c.w, d.x, d.y, d.z, d.w) {}
+		//Constructs a Matrix4 from the generic Matrix<T, 4, 4>.
+		Matrix4(const Matrix<T, 4, 4>& other)
+			: Storage(other.data[0], other.data[1], other.data[2], other.data[3], other.data[4], other.data[5], other.data[6], other.data[7],
+			other.data[8], other.data[9], other.data[10], other.data[11], other.data[12], other.data[13], other.data[14], other.data[15]) {}
+		//Constructs a Matrix4 from a Matrix4 of the opposite storage order.
+		Matrix4(const OppositeOrder& other)
+			: Storage(other.a, other.b, other.c, other.d, other.e, other.f, other.g, other.h,
+			other.i, other.j, other.k, other.l, other.m, other.n, other.o, other.p) {}
 		//Constructs a Matrix4 where the diagonal is the input.
 		Matrix4(T diagonal)
-			: a(diagonal), b(0), c(0), d(0), e(0), f(diagonal), g(0), h(0),
-			i(0), j(0), k(diagonal), l(0), m(0), n(0), o(0), p(diagonal) {}
+			: Storage(diagonal, 0, 0, 0, 0, diagonal, 0, 0,
+			0, 0, diagonal, 0, 0, 0, 0, diagonal) {}
 
 		//Destructs the Matrix4.
 		~Matrix4() {}
 
+		//Generic Matrix<T, 4, 4> operator implicit cast.
+		inline operator Matrix<T, 4, 4>() const { return Matrix<T, 4, 4>(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p); }
+
 		//Calcuates determinant, and returns the sum of the vector components.
-		float Det() const
+		T Det() const
 		{
-			float temp_i = static_cast<float>(a) * Matrix3<T>(f, g, h, j, k, l, n, o, p).Det();
-			float temp_j = static_cast<float>(b) * Matrix3<T>(e, g, h, i, k, l, m, o, p).Det();
-			float temp_k = static_cast<float>(c) * Matrix3<T>(e, f, h, i, j, l, m, n, p).Det();
-			float temp_l = static_cast<float>(d) * Matrix3<T>(e, f, g, i, j, k, m, n, o).Det();
-			return temp_i - temp_j + temp_k - temp_l;
+			return Matrix<T, 4, 4>(*this).Det();
 		}
 		//Calcuates determinant, and returns as a vector.
 		Vector4<T> VecDet() const
@@ -61,8 +165,7 @@ namespace mars
 		//Swaps the Column/Row Major Ording of the input matrix object, return to a new Matrix4 object.
 		static Matrix4 Transpose(const Matrix4& input)
 		{
-			return Matrix4(input.a, input.e, input.i, input.m, input.b, input.f, input.j, input.n,
-				input.c, input.g, input.k, input.o, input.d, input.h, input.l, input.p);
+			return Matrix<T, 4, 4>::Transpose(input);
 		}
 
 		//Inverts the current matrix object.
@@ -74,34 +177,50 @@ namespace mars
 		//Inverts the input matrix object, return to a new Matrix4 object.
 		static Matrix4 Inverse(const Matrix4& input)
 		{
-			float det = input.Det();
-			if (det == 0.0f)
-				return input;
-
-			Matrix4<T> result = Matrix4<T>
-				(
-					static_cast<T>(+Matrix3<T>(input.f, input.g, input.h, input.j, input.k, input.l, input.n, input.o, input.p).Det() / det),
-					static_cast<T>(-Matrix3<T>(input.b, input.c, input.d, input.j, input.k, input.l, input.n, input.o, input.p).Det() / det),
-					static_cast<T>(+Matrix3<T>(input.b, input.c, input.d, input.f, input.g, input.h, input.n, input.o, input.p).Det() / det),
-					static_cast<T>(-Matrix3<T>(input.b, input.c, input.d, input.f, input.g, input.h, input.j, input.k, input.l).Det() / det),
-
-					static_cast<T>(-Matrix3<T>(input.e, input.g, input.h, input.i, input.k, input.l, input.m, input.o, input.p).Det() / det),
-					static_cast<T>(+Matrix3<T>(input.a, input.c, input.d, input.i, input.k, input.l, input.m, input.o, input.p).Det() / det),
-					static_cast<T>(-Matrix3<T>(input.a, input.c, input.d, input.e, input.g, input.h, input.m, input.o, input.p).Det() / det),
-					static_cast<T>(+Matrix3<T>(input.a, input.c, input.d, input.e, input.g, input.h, input.i, input.k, input.l).Det() / det),
-
-					static_cast<T>(+Matrix3<T>(input.e, input.f, input.h, input.i, input.j, input.l, input.m, input.n, input.p).Det() / det),
-					static_cast<T>(-Matrix3<T>(input.a, input.b, input.d, input.i, input.j, input.l, input.m, input.n, input.p).Det() / det),
-					static_cast<T>(+Matrix3<T>(input.a, input.b, input.d, input.e, input.f, input.h, input.m, input.n, input.p).Det() / det),
-					static_cast<T>(-Matrix3<T>(input.a, input.b, input.d, input.e, input.f, input.h, input.i, input.j, input.l).Det() / det),
-
-					static_cast<T>(-Matrix3<T>(input.e, input.f, input.g, input.i, input.j, input.k, input.m, input.n, input.o).Det() / det),
-					static_cast<T>(+Matrix3<T>(input.a, input.b, input.c, input.i, input.j, input.k, input.m, input.n, input.o).Det() / det),
-					static_cast<T>(-Matrix3<T>(input.a, input.b, input.c, input.e, input.f, input.g, input.m, input.n, input.o).Det() / det),
-					static_cast<T>(+Matrix3<T>(input.a, input.b, input.c, input.e, input.f, input.g, input.i, input.j, input.k).Det() / det)
-					);
+			return Matrix<T, 4, 4>::Inverse(input);
+		}
+
+		//Extracts the upper 3x3 of the current matrix object, return to a new Matrix3 object.
+		Matrix3<T, O> ToMatrix3() const
+		{
+			return Matrix3<T, O>(a, b, c, e, f, g, i, j, k);
+		}
+
+		//Calculates the normal matrix (inverse-transpose of the upper 3x3) of the current matrix object, return to a new Matrix3 object.
+		//If directionOnly is true, the divide by the determinant is skipped and only its sign is applied; the transformed normals must then be normalised.
+		Matrix3<T, O> NormalMatrix(bool directionOnly = false) const
+		{
+			return Matrix4::NormalMatrix(*this, directionOnly);
+		}
+		//Calculates the normal matrix (inverse-transpose of the upper 3x3) of the input matrix object, return to a new Matrix3 object.
+		//The result is the cofactor matrix of the upper 3x3 divided by its determinant. If the determinant is 0, the cofactor matrix is returned.
+		static Matrix3<T, O> NormalMatrix(const Matrix4& input, bool directionOnly = false)
+		{
+			Matrix3<T, O> result(
+				input.f * input.k - input.g * input.j, input.g * input.i - input.e * input.k, input.e * input.j - input.f * input.i,
+				input.c * input.j - input.b * input.k, input.a * input.k - input.c * input.i, input.b * input.i - input.a * input.j,
+				input.b * input.g - input.c * input.f, input.c * input.e - input.a * input.g, input.a * input.f - input.b * input.e);
+
+			T det = input.a * result.a + input.b * result.b + input.c * result.c;
+			if (det == 0)
+				return result;
+
+			T scale = directionOnly ? (det < 0 ? static_cast<T>(-1) : static_cast<T>(1)) : static_cast<T>(1) / det;
+			result.a *= scale; result.b *= scale; result.c *= scale;
+			result.d *= scale; result.e *= scale; result.f *= scale;
+			result.g *= scale; result.h *= scale; result.i *= scale;
 			return result;
 		}
+		//Calculates the normal matrices of the input matrix objects into outputs. Processes min(inputs.size(), outputs.size()) matrices.
+		static void NormalMatrix(std::span<const Matrix4> inputs, std::span<Matrix3<T, O>> outputs, bool directionOnly = false, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			const size_t count = std::min(inputs.size(), outputs.size());
+			Parallel::For(policy, count, Parallel::GetChunkSize(count, 1024), [&](size_t begin, size_t end)
+			{
+				for (size_t idx = begin; idx < end; idx++)
+					outputs[idx] = Matrix4::NormalMatrix(inputs[idx], directionOnly);
+			});
+		}
 
 		//Constructs a Matrix4 where the diagonal is 1.
 		static Matrix4 Identity()
@@ -111,8 +230,9 @@ namespace mars
 
 		//Constructs a orthographic matrix (Matrix4).
 		//For Normalised Device Co-ordinates of X: -1 to 1, Y: -1 to 1 and Z: 0 to 1 in a Left-Handed system.  Options for Reverse Z and Right-Handed system.
+		//If inverse is not null, it is set to the inverse projection, built in closed form from the same terms.
 		//https://github.com/microsoft/DirectXMath/blob/main/Inc/DirectXMathMatrix.inl //Handed-ness and Reverse Z.
-		static Matrix4 Orthographic(float left, float right, float bottom, float top, float zNear, float zFar, bool reverseZ = false, bool rightHanded = false)
+		static Matrix4 Orthographic(float left, float right, float bottom, float top, float zNear, float zFar, bool reverseZ = false, bool rightHanded = false, Matrix4* inverse = nullptr)
 		{
 			if (reverseZ)
 			{
@@ -135,6 +255,8 @@ namespace mars
 				Z = static_cast<T>(-zNear) * C;
 			}
 
+			if (inverse)
+				*inverse = Matrix4::InverseOrthographic(A, B, C, X, Y, Z);
 			return Matrix4(
 				A, 0, 0, X,
 				0, B, 0, Y,
@@ -144,10 +266,11 @@ namespace mars
 
 		//Constructs a perspective matrix (Matrix4). Input fov is in radians.
 		//For Normalised Device Co-ordinates of X: -1 to 1, Y: -1 to 1 and Z: 0 to 1 in a Left-Handed system. Options for Reverse Z and Right-Handed system.
+		//If inverse is not null, it is set to the inverse projection, built in closed form from the same terms.
 		//https://www.gamedev.net/tutorials/programming/graphics/perspective-projections-in-lh-and-rh-systems-r3598/ //Handed-ness.
 		//https://github.com/sebbbi/rust_test/commit/d64119ce22a6a4972e97b8566e3bbd221123fcbb //Reverse Z.
 		//https://learn.microsoft.com/en-us/windows/win32/api/directxmath/nf-directxmath-xmmatrixperspectivefovrh
-		static Matrix4 Perspective(double fov, float aspectRatio, float zNear, float zFar, bool reverseZ = false, bool rightHanded = false)
+		static Matrix4 Perspective(double fov, float aspectRatio, float zNear, float zFar, bool reverseZ = false, bool rightHanded = false, Matrix4* inverse = nullptr)
 		{
 			if (reverseZ)
 			{
@@ -156,10 +279,12 @@ namespace mars
 
 			T A = static_cast<T>(1) / static_cast<T>(aspectRatio * static_cast<float>(tan(fov / 2.0)));
 			T B = static_cast<T>(1) / static_cast<T>(static_cast<float>(tan(fov / 2)));
-			T C = static_cast<T>((zFar) / (zFar - zNear));
 			T D = rightHanded ? static_cast<T>(-1) : static_cast<T>(1);
+			T C = D * static_cast<T>((zFar) / (zFar - zNear));
 			T E = static_cast<T>(zNear) * -D * C;
 
+			if (inverse)
+				*inverse = Matrix4::InversePerspective(A, B, C, D, E, 0, 0);
 			return Matrix4(
 				A, 0, 0, 0,
 				0, B, 0, 0,
@@ -169,10 +294,11 @@ namespace mars
 
 		//Constructs an offset perspective matrix (Matrix4). Inputs angles are in radians.
 		//For Normalised Device Co-ordinates of X: -1 to 1, Y: -1 to 1 and Z: 0 to 1 in a Left-Handed system. Options for Reverse Z and Right-Handed system.
+		//If inverse is not null, it is set to the inverse projection, built in closed form from the same terms.
 		//https://www.gamedev.net/tutorials/programming/graphics/perspective-projections-in-lh-and-rh-systems-r3598/ //Handed-ness.
 		//https://github.com/sebbbi/rust_test/commit/d64119ce22a6a4972e97b8566e3bbd221123fcbb //Reverse Z.
 		//https://github.com/KhronosGroup/OpenXR-Tutorials/blob/main/Common/xr_linear_algebra.h#L488-L544
-		static Matrix4 PerspectiveOffset(double angleLeft, double angleRight, double angleDown, double angleUp, float zNear, float zFar, bool reverseZ = false, bool rightHanded = false)
+		static Matrix4 PerspectiveOffset(double angleLeft, double angleRight, double angleDown, double angleUp, float zNear, float zFar, bool reverseZ = false, bool rightHanded = false, Matrix4* inverse = nullptr)
 		{
 			const double tanLeft = tan(angleLeft);
 			const double tanRight = tan(angleRight);
@@ -191,10 +317,12 @@ namespace mars
 			T B = static_cast<T>(2) / static_cast<T>(tanHeight);
 			T X = static_cast<T>((tanRight + tanLeft) / tanWidth);
 			T Y = static_cast<T>((tanUp + tanDown) / tanHeight);
-			T C = static_cast<T>((zFar) / (zFar - zNear));
 			T D = rightHanded ? static_cast<T>(-1) : static_cast<T>(1);
+			T C = D * static_cast<T>((zFar) / (zFar - zNear));
 			T E = static_cast<T>(zNear) * -D * C;
 
+			if (inverse)
+				*inverse = Matrix4::InversePerspective(A, B, C, D, E, X, Y);
 			return Matrix4(
 				A, 0, X, 0,
 				0, B, Y, 0,
@@ -202,6 +330,63 @@ namespace mars
 				0, 0, D, 0);
 		}
 
+		//Constructs a perspective matrix (Matrix4) with the far plane at infinity. Input fov is in radians.
+		//For Normalised Device Co-ordinates of X: -1 to 1, Y: -1 to 1 and Z: 0 to 1 in a Left-Handed system. Options for Reverse Z and Right-Handed system.
+		//With reverseZ, the near plane maps to 1 and infinity to 0, which spreads float depth precision evenly with distance.
+		//If inverse is not null, it is set to the inverse projection.
+		static Matrix4 InfinitePerspective(double fov, float aspectRatio, float zNear, bool reverseZ = false, bool rightHanded = false, Matrix4* inverse = nullptr)
+		{
+			T A = static_cast<T>(1) / static_cast<T>(aspectRatio * static_cast<float>(tan(fov / 2.0)));
+			T B = static_cast<T>(1) / static_cast<T>(static_cast<float>(tan(fov / 2)));
+			T D = rightHanded ? static_cast<T>(-1) : static_cast<T>(1);
+			//The limits of Perspective as zFar goes to infinity: depth = (C * z + E) / (D * z).
+			T C = reverseZ ? static_cast<T>(0) : D;
+			T E = reverseZ ? static_cast<T>(zNear) : static_cast<T>(-zNear);
+
+			if (inverse)
+				*inverse = Matrix4::InversePerspective(A, B, C, D, E, 0, 0);
+			return Matrix4(
+				A, 0, 0, 0,
+				0, B, 0, 0,
+				0, 0, C, E,
+				0, 0, D, 0);
+		}
+
+		//Returns the inverse of a projection built by Orthographic, Perspective, PerspectiveOffset or InfinitePerspective, in closed form.
+		//Perspective projections are recognised by p == 0.
+		static Matrix4 InverseProjection(const Matrix4& projection)
+		{
+			if (projection.p == 0)
+				return Matrix4::InversePerspective(projection.a, projection.f, projection.k, projection.o, projection.l, projection.c, projection.g);
+			return Matrix4::InverseOrthographic(projection.a, projection.f, projection.k, projection.d, projection.h, projection.l);
+		}
+
+		//Constructs a view matrix (Matrix4) for a camera at eye looking at target, with up giving the vertical.
+		//In a Left-Handed system the camera looks along +Z; in a Right-Handed system it looks along -Z.
+		static Matrix4 LookAt(const Vector3<T>& eye, const Vector3<T>& target, const Vector3<T>& up, bool rightHanded = false)
+		{
+			//Z axis: towards the target for Left-Handed, away from it for Right-Handed.
+			T zx = target.x - eye.x, zy = target.y - eye.y, zz = target.z - eye.z;
+			if (rightHanded)
+			{
+				zx = -zx; zy = -zy; zz = -zz;
+			}
+			const T zScale = static_cast<T>(1 / sqrt(static_cast<double>(zx * zx + zy * zy + zz * zz)));
+			zx *= zScale; zy *= zScale; zz *= zScale;
+
+			//X axis: up x Z, Y axis: Z x X.
+			T xx = up.y * zz - up.z * zy, xy = up.z * zx - up.x * zz, xz = up.x * zy - up.y * zx;
+			const T xScale = static_cast<T>(1 / sqrt(static_cast<double>(xx * xx + xy * xy + xz * xz)));
+			xx *= xScale; xy *= xScale; xz *= xScale;
+			const T yx = zy * xz - zz * xy, yy = zz * xx - zx * xz, yz = zx * xy - zy * xx;
+
+			return Matrix4(
+				xx, xy, xz, -(xx * eye.x + xy * eye.y + xz * eye.z),
+				yx, yy, yz, -(yx * eye.x + yy * eye.y + yz * eye.z),
+				zx, zy, zz, -(zx * eye.x + zy * eye.y + zz * eye.z),
+				0, 0, 0, 1);
+		}
+
 		//Constructs a translation matrix.
 		static Matrix4 Translation(const Vector3<T>& translation)
 		{
@@ -214,7 +399,8 @@ namespace mars
 		//Constructs a rotation matrix. Input angle is in radians.
 		static Matrix4 Rotation(double angle, const Vector3<T>& axis)
 		{
-			Matrix4<T> result(1);
+			MARS_INSTRUMENT(Matrix4Rotation);
+			Matrix4 result(1);
 			T c_angle = static_cast<T>(cos(angle));
 			T s_angle = static_cast<T>(sin(angle));
 			T omcos = static_cast<T>(1 - c_angle);
@@ -255,27 +441,26 @@ namespace mars
 			return result;
 		}
 
+		//Transforms the points, with w = 1, by the matrix into outputs. The results are not divided by w. Processes min(inputs.size(), outputs.size()) points.
+		static void TransformPoints(const Matrix4& matrix, std::span<const Vector3<T>> inputs, std::span<Vector3<T>> outputs, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			Matrix4::Transform<true>(matrix, inputs, outputs, policy);
+		}
+		//Transforms the directions, with w = 0, by the matrix into outputs. Processes min(inputs.size(), outputs.size()) directions.
+		static void TransformDirections(const Matrix4& matrix, std::span<const Vector3<T>> inputs, std::span<Vector3<T>> outputs, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			Matrix4::Transform<false>(matrix, inputs, outputs, policy);
+		}
+
 		//Multiplies a Vector4 input by the current matrix transform.
 		Vector4<T> operator*(const Vector4<T>& input) const
 		{
-			Vector4<T> transform_i(a, e, i, m);
-			Vector4<T> transform_j(b, f, j, n);
-			Vector4<T> transform_k(c, g, k, o);
-			Vector4<T> transform_l(d, h, l, p);
-			return Vector4<T>(transform_i * input.x + transform_j * input.y + transform_k * input.z + transform_l * input.w);
+			return Matrix<T, 4, 4>(*this) * Vector<T, 4>(input);
 		}
 		//Multiplies, or creates the composition of, the current Matrix4 by a Matrix4 input.
 		Matrix4 operator*(const Matrix4& input) const
 		{
-			Vector4<T> input_i(input.a, input.e, input.i, input.m);
-			Vector4<T> input_j(input.b, input.f, input.j, input.n);
-			Vector4<T> input_k(input.c, input.g, input.k, input.o);
-			Vector4<T> input_l(input.d, input.h, input.l, input.p);
-			Vector4<T> output_i = *this * input_i;
-			Vector4<T> output_j = *this * input_j;
-			Vector4<T> output_k = *this * input_k;
-			Vector4<T> output_l = *this * input_l;
-			return Matrix4(output_i, output_j, output_k, output_l).Transpose();
+			return Matrix<T, 4, 4>(*this) * Matrix<T, 4, 4>(input);
 		}
 		//Multiplies, or creates the composition of, the current Matrix4 by a Matrix4 input.
 		Matrix4& operator*=(const Matrix4& input)
@@ -296,6 +481,22 @@ namespace mars
 			return stream;
 		}
 
+		//Converts the input matrices of the opposite storage order into outputs. Processes min(inputs.size(), outputs.size()) matrices.
+		static void ConvertStorageOrder(std::span<const OppositeOrder> inputs, std::span<Matrix4> outputs, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			const size_t count = std::min(inputs.size(), outputs.size());
+			Parallel::For(policy, count, Parallel::GetChunkSize(count, 4096), [&](size_t begin, size_t end)
+			{
+				Matrix4::ConvertStorageOrder(inputs[begin].GetData(), &outputs[begin].a, end - begin);
+			});
+		}
+		//Converts count raw 4x4 matrices from one storage order to the other, i.e. transposes each matrix in memory. src and dst must not overlap.
+		static void ConvertStorageOrder(const T* src, T* dst, size_t count)
+		{
+			for (size_t idx = 0; idx < count; idx++, src += 16, dst += 16)
+				Unroll<16>([&](auto elem) { dst[(elem % 4) * 4 + elem / 4] = src[elem]; });
+		}
+
 		inline const T* const GetData() const { return &a; }
 		constexpr static inline size_t GetSize() { return sizeof(Matrix4); }
 	};
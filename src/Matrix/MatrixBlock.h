@@ -0,0 +1,105 @@
+#pragma once
+#include "../mars_common.h"
+#include <concepts>
+#include <cstdint>
+#include <type_traits>
+
+namespace mars
+{
+	//Per-lane result of comparing two LaneArrays of T. The lanes are integers as wide as T, so masks and values share a vector layout.
+	template<typename T, size_t Lanes>
+	struct LaneMask
+	{
+		std::conditional_t<sizeof(T) == 8, int64_t, int32_t> lanes[Lanes];
+
+		//Constructs a LaneMask with uninitialised lanes.
+		LaneMask() = default;
+		//Constructs a LaneMask with the value in every lane.
+		LaneMask(bool value) { for (size_t i = 0; i < Lanes; i++) lanes[i] = value; }
+
+		inline bool operator[](size_t lane) const { return lanes[lane]; }
+
+		friend LaneMask operator!(const LaneMask& a) { LaneMask r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = !a.lanes[i]; return r; }
+		friend LaneMask operator&(const LaneMask& a, const LaneMask& b) { LaneMask r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = a.lanes[i] & b.lanes[i]; return r; }
+		friend LaneMask operator|(const LaneMask& a, const LaneMask& b) { LaneMask r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = a.lanes[i] | b.lanes[i]; return r; }
+	};
+
+	//Lanes values of T with element-wise arithmetic, comparisons and selects. The batched matrix kernels are templates over their value
+	//type: instantiated with T they handle one matrix, with LaneArray<T, Lanes> they run one instruction stream over Lanes matrices,
+	//every operation being a fixed-length loop over the lanes that the compiler vectorises.
+	template<typename T, size_t Lanes>
+	struct LaneArray
+	{
+		T lanes[Lanes];
+
+		//Constructs a LaneArray with uninitialised lanes.
+		LaneArray() = default;
+		//Constructs a LaneArray with the value in every lane.
+		LaneArray(T value) { for (size_t i = 0; i < Lanes; i++) lanes[i] = value; }
+
+		inline T& operator[](size_t lane) { return lanes[lane]; }
+		inline const T& operator[](size_t lane) const { return lanes[lane]; }
+
+		friend LaneArray operator+(const LaneArray& a, const LaneArray& b) { LaneArray r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = a.lanes[i] + b.lanes[i]; return r; }
+		friend LaneArray operator-(const LaneArray& a, const LaneArray& b) { LaneArray r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = a.lanes[i] - b.lanes[i]; return r; }
+		friend LaneArray operator*(const LaneArray& a, const LaneArray& b) { LaneArray r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = a.lanes[i] * b.lanes[i]; return r; }
+		friend LaneArray operator/(const LaneArray& a, const LaneArray& b) { LaneArray r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = a.lanes[i] / b.lanes[i]; return r; }
+		friend LaneArray operator-(const LaneArray& a) { LaneArray r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = -a.lanes[i]; return r; }
+		LaneArray& operator+=(const LaneArray& other) { return *this = *this + other; }
+		LaneArray& operator-=(const LaneArray& other) { return *this = *this - other; }
+		LaneArray& operator*=(const LaneArray& other) { return *this = *this * other; }
+
+		friend LaneMask<T, Lanes> operator<(const LaneArray& a, const LaneArray& b) { LaneMask<T, Lanes> r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = a.lanes[i] < b.lanes[i]; return r; }
+		friend LaneMask<T, Lanes> operator>(const LaneArray& a, const LaneArray& b) { LaneMask<T, Lanes> r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = a.lanes[i] > b.lanes[i]; return r; }
+		friend LaneMask<T, Lanes> operator==(const LaneArray& a, const LaneArray& b) { LaneMask<T, Lanes> r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = a.lanes[i] == b.lanes[i]; return r; }
+		friend LaneMask<T, Lanes> operator!=(const LaneArray& a, const LaneArray& b) { LaneMask<T, Lanes> r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = a.lanes[i] != b.lanes[i]; return r; }
+
+		//Returns a in the lanes where the mask is set and b elsewhere.
+		friend LaneArray Select(const LaneMask<T, Lanes>& mask, const LaneArray& a, const LaneArray& b) { LaneArray r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = mask.lanes[i] ? a.lanes[i] : b.lanes[i]; return r; }
+		friend LaneArray Sqrt(const LaneArray& a) { LaneArray r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = std::sqrt(a.lanes[i]); return r; }
+		friend LaneArray Abs(const LaneArray& a) { LaneArray r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = std::abs(a.lanes[i]); return r; }
+		friend LaneArray Max(const LaneArray& a, const LaneArray& b) { LaneArray r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = a.lanes[i] > b.lanes[i] ? a.lanes[i] : b.lanes[i]; return r; }
+	};
+
+	//The scalar forms of the LaneArray functions, so a kernel template also compiles for a single T.
+	template<std::floating_point T> inline T Select(bool mask, T a, T b) { return mask ? a : b; }
+	template<std::floating_point T> inline T Sqrt(T a) { return std::sqrt(a); }
+	template<std::floating_point T> inline T Abs(T a) { return std::abs(a); }
+	template<std::floating_point T> inline T Max(T a, T b) { return a > b ? a : b; }
+
+	//Scalar and comparison mask types of a kernel value type, T or LaneArray<T, Lanes>.
+	template<typename V>
+	struct LaneTraits
+	{
+		using Scalar = V;
+		using Mask = bool;
+	};
+	template<typename T, size_t Lanes>
+	struct LaneTraits<LaneArray<T, Lanes>>
+	{
+		using Scalar = T;
+		using Mask = LaneMask<T, Lanes>;
+	};
+
+	//Calls func(a, base, blockCount) for every block of Lanes matrices, where a[row][col][lane] is the N x N matrix base + lane as
+	//written by load(index, matrix). The lanes past the end of the last block hold the identity, which every kernel accepts.
+	template<size_t Lanes, typename T, size_t N, typename LoadFunc, typename BlockFunc>
+	inline void ForEachMatrixBlock(size_t count, LoadFunc&& load, BlockFunc&& func)
+	{
+		for (size_t base = 0; base < count; base += Lanes)
+		{
+			const size_t blockCount = std::min(Lanes, count - base);
+			LaneArray<T, Lanes> a[N][N];
+			for (size_t lane = 0; lane < Lanes; lane++)
+			{
+				T m[N][N];
+				if (lane < blockCount)
+					load(base + lane, m);
+				else
+					Unroll<N * N>([&](auto e) { m[e / N][e % N] = e / N == e % N ? T(1) : T(0); });
+				Unroll<N * N>([&](auto e) { a[e / N][e % N][lane] = m[e / N][e % N]; });
+			}
+			func(a, base, blockCount);
+		}
+	}
+}
@@ -0,0 +1,277 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Other/Parallel.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector2.h"
+#include "../Vector/Vector3.h"
+#include "../Vector/Vector4.h"
+#include <vector>
+
+namespace mars
+{
+	enum class NormalWeighting : uint8_t
+	{
+		Area,
+		Angle
+	};
+
+	//For each vertex, the corners (3 * face + corner) that reference it, in ascending order (compressed sparse rows).
+	//The corners of vertex v are corners[offsets[v]] to corners[offsets[v + 1] - 1].
+	struct MeshAdjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> corners;
+	};
+
+	//Normal and tangent frame generation for indexed triangle lists.
+	//Per-vertex results are built in two passes: a parallel pass over faces writes one contribution per corner, then a parallel pass
+	//over vertices sums the contributions of each vertex through the MeshAdjacency in a fixed order. Nothing is scattered
+	//across threads, so the results are identical for any thread count. Indices must be smaller than the vertex count.
+	class MeshUtilities
+	{
+	private:
+		static constexpr size_t FaceChunkSize = 1024;
+		static constexpr size_t VertexChunkSize = 2048;
+
+		//Per-corner scratch, one array per component.
+		struct CornerData
+		{
+			std::vector<float> x, y, z;
+
+			explicit CornerData(size_t count)
+				: x(count), y(count), z(count) {}
+		};
+
+		//Sums the corner data of every vertex in the adjacency order and passes the total to func(vertex, x, y, z).
+		template<typename F>
+		static void GatherCorners(const MeshAdjacency& adjacency, const CornerData& data, F&& func)
+		{
+			const size_t vertexCount = adjacency.offsets.empty() ? 0 : adjacency.offsets.size() - 1;
+			Parallel::For(vertexCount, VertexChunkSize, [&](size_t begin, size_t end)
+			{
+				for (size_t v = begin; v < end; v++)
+				{
+					float x = 0.0f, y = 0.0f, z = 0.0f;
+					for (uint32_t idx = adjacency.offsets[v]; idx < adjacency.offsets[v + 1]; idx++)
+					{
+						const uint32_t corner = adjacency.corners[idx];
+						x += data.x[corner];
+						y += data.y[corner];
+						z += data.z[corner];
+					}
+					func(v, x, y, z);
+				}
+			});
+		}
+
+		//Returns a unit vector orthogonal to the unit normal.
+		//https://graphics.pixar.com/library/OrthonormalB/paper.pdf
+		static float3 Orthogonal(float nx, float ny, float nz)
+		{
+			const float sign = std::copysign(1.0f, nz);
+			const float a = -1.0f / (sign + nz);
+			return float3(1.0f + sign * nx * nx * a, sign * nx * ny * a, -sign * nx);
+		}
+
+	public:
+		//Builds the vertex-to-corner adjacency of the triangle list with a counting sort.
+		static MeshAdjacency BuildAdjacency(size_t vertexCount, std::span<const uint32_t> indices)
+		{
+			MeshAdjacency adjacency;
+			const size_t cornerCount = indices.size() - indices.size() % 3;
+			adjacency.offsets.assign(vertexCount + 1, 0);
+			for (size_t corner = 0; corner < cornerCount; corner++)
+				adjacency.offsets[indices[corner] + 1]++;
+			for (size_t v = 0; v < vertexCount; v++)
+				adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+			std::vector<uint32_t> cursor(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+			adjacency.corners.resize(cornerCount);
+			for (size_t corner = 0; corner < cornerCount; corner++)
+				adjacency.corners[cursor[indices[corner]]++] = static_cast<uint32_t>(corner);
+			return adjacency;
+		}
+
+		//Computes the unit normal of every triangle, counter-clockwise winding facing the viewer. Writes min(indices.size() / 3, normals.size()) normals.
+		//Degenerate triangles get a normal of 0.
+		static void FaceNormals(std::span<const float3> positions, std::span<const uint32_t> indices, std::span<float3> normals)
+		{
+			const size_t faceCount = std::min(indices.size() / 3, normals.size());
+			Parallel::For(faceCount, FaceChunkSize, [&](size_t begin, size_t end)
+			{
+				for (size_t f = begin; f < end; f++)
+				{
+					const float3& p0 = positions[indices[3 * f + 0]];
+					const float3& p1 = positions[indices[3 * f + 1]];
+					const float3& p2 = positions[indices[3 * f + 2]];
+					const float e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+					const float e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+					const float nx = e1y * e2z - e1z * e2y;
+					const float ny = e1z * e2x - e1x * e2z;
+					const float nz = e1x * e2y - e1y * e2x;
+					const float lengthSq = nx * nx + ny * ny + nz * nz;
+					const float invLength = lengthSq > 0.0f ? 1.0f / std::sqrt(lengthSq) : 0.0f;
+					normals[f] = float3(nx * invLength, ny * invLength, nz * invLength);
+				}
+			});
+		}
+
+		//Computes smooth unit vertex normals, weighting each face normal by the face area or by the corner angle.
+		//Writes min(positions.size(), normals.size()) normals; vertices without a non-degenerate face get a normal of 0.
+		static void VertexNormals(std::span<const float3> positions, std::span<const uint32_t> indices, const MeshAdjacency& adjacency, std::span<float3> normals, NormalWeighting weighting = NormalWeighting::Area)
+		{
+			const size_t faceCount = indices.size() / 3;
+			CornerData corners(3 * faceCount);
+			Parallel::For(faceCount, FaceChunkSize, [&](size_t begin, size_t end)
+			{
+				for (size_t f = begin; f < end; f++)
+				{
+					const float3& p0 = positions[indices[3 * f + 0]];
+					const float3& p1 = positions[indices[3 * f + 1]];
+					const float3& p2 = positions[indices[3 * f + 2]];
+					const float e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+					const float e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+					const float e3x = p2.x - p1.x, e3y = p2.y - p1.y, e3z = p2.z - p1.z;
+					//The length of the cross product is twice the area, so it already carries the area weight.
+					const float nx = e1y * e2z - e1z * e2y;
+					const float ny = e1z * e2x - e1x * e2z;
+					const float nz = e1x * e2y - e1y * e2x;
+
+					float weight[3] = { 1.0f, 1.0f, 1.0f };
+					if (weighting == NormalWeighting::Angle)
+					{
+						//Every corner angle has the same |e_a x e_b| = |n|, so atan2(|n|, e_a . e_b) gives it without acos.
+						const float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+						const float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+						weight[0] = std::atan2(length, e1x * e2x + e1y * e2y + e1z * e2z) * invLength;
+						weight[1] = std::atan2(length, -(e1x * e3x + e1y * e3y + e1z * e3z)) * invLength;
+						weight[2] = std::atan2(length, e2x * e3x + e2y * e3y + e2z * e3z) * invLength;
+					}
+					for (size_t c = 0; c < 3; c++)
+					{
+						corners.x[3 * f + c] = nx * weight[c];
+						corners.y[3 * f + c] = ny * weight[c];
+						corners.z[3 * f + c] = nz * weight[c];
+					}
+				}
+			});
+
+			const size_t vertexCount = std::min(positions.size(), normals.size());
+			GatherCorners(adjacency, corners, [&](size_t v, float x, float y, float z)
+			{
+				if (v >= vertexCount)
+					return;
+				const float lengthSq = x * x + y * y + z * z;
+				const float invLength = lengthSq > 0.0f ? 1.0f / std::sqrt(lengthSq) : 0.0f;
+				normals[v] = float3(x * invLength, y * invLength, z * invLength);
+			});
+		}
+		//Computes smooth unit vertex normals, building the adjacency first.
+		static void VertexNormals(std::span<const float3> positions, std::span<const uint32_t> indices, std::span<float3> normals, NormalWeighting weighting = NormalWeighting::Area)
+		{
+			VertexNormals(positions, indices, BuildAdjacency(positions.size(), indices), normals, weighting);
+		}
+
+		//Computes MikkTSpace-style tangent frames from the unit vertex normals and texture coordinates.
+		//Each corner contributes the face tangent and bitangent projected onto the tangent plane of its vertex, weighted by the corner angle;
+		//the summed tangent is then orthonormalised against the normal. tangents.w holds the handedness, so bitangent = cross(normal, tangent.xyz) * w,
+		//which is also written to bitangents if given. Vertices must already be split wherever the UV mapping is mirrored or discontinuous.
+		static void Tangents(std::span<const float3> positions, std::span<const float3> normals, std::span<const float2> uvs, std::span<const uint32_t> indices, const MeshAdjacency& adjacency, std::span<float4> tangents, std::span<float3> bitangents = {})
+		{
+			const size_t faceCount = indices.size() / 3;
+			CornerData tangentCorners(3 * faceCount);
+			CornerData bitangentCorners(3 * faceCount);
+			Parallel::For(faceCount, FaceChunkSize, [&](size_t begin, size_t end)
+			{
+				for (size_t f = begin; f < end; f++)
+				{
+					const uint32_t vertex[3] = { indices[3 * f + 0], indices[3 * f + 1], indices[3 * f + 2] };
+					const float3& p0 = positions[vertex[0]];
+					const float3& p1 = positions[vertex[1]];
+					const float3& p2 = positions[vertex[2]];
+					const float e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+					const float e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+					const float e3x = p2.x - p1.x, e3y = p2.y - p1.y, e3z = p2.z - p1.z;
+					const float du1 = uvs[vertex[1]].x - uvs[vertex[0]].x, dv1 = uvs[vertex[1]].y - uvs[vertex[0]].y;
+					const float du2 = uvs[vertex[2]].x - uvs[vertex[0]].x, dv2 = uvs[vertex[2]].y - uvs[vertex[0]].y;
+
+					//Degenerate UV triangles contribute nothing.
+					const float uvArea = du1 * dv2 - du2 * dv1;
+					const float r = uvArea != 0.0f ? 1.0f / uvArea : 0.0f;
+					const float tx = (e1x * dv2 - e2x * dv1) * r, ty = (e1y * dv2 - e2y * dv1) * r, tz = (e1z * dv2 - e2z * dv1) * r;
+					const float bx = (e2x * du1 - e1x * du2) * r, by = (e2y * du1 - e1y * du2) * r, bz = (e2z * du1 - e1z * du2) * r;
+
+					const float cx = e1y * e2z - e1z * e2y;
+					const float cy = e1z * e2x - e1x * e2z;
+					const float cz = e1x * e2y - e1y * e2x;
+					const float crossLength = std::sqrt(cx * cx + cy * cy + cz * cz);
+					const float angle[3] =
+					{
+						std::atan2(crossLength, e1x * e2x + e1y * e2y + e1z * e2z),
+						std::atan2(crossLength, -(e1x * e3x + e1y * e3y + e1z * e3z)),
+						std::atan2(crossLength, e2x * e3x + e2y * e3y + e2z * e3z)
+					};
+
+					for (size_t c = 0; c < 3; c++)
+					{
+						const float3& n = normals[vertex[c]];
+						const float tn = tx * n.x + ty * n.y + tz * n.z;
+						const float bn = bx * n.x + by * n.y + bz * n.z;
+						const float ptx = tx - n.x * tn, pty = ty - n.y * tn, ptz = tz - n.z * tn;
+						const float pbx = bx - n.x * bn, pby = by - n.y * bn, pbz = bz - n.z * bn;
+						const float tLengthSq = ptx * ptx + pty * pty + ptz * ptz;
+						const float bLengthSq = pbx * pbx + pby * pby + pbz * pbz;
+						const float tScale = tLengthSq > 0.0f ? angle[c] / std::sqrt(tLengthSq) : 0.0f;
+						const float bScale = bLengthSq > 0.0f ? angle[c] / std::sqrt(bLengthSq) : 0.0f;
+						const size_t corner = 3 * f + c;
+						tangentCorners.x[corner] = ptx * tScale;
+						tangentCorners.y[corner] = pty * tScale;
+						tangentCorners.z[corner] = ptz * tScale;
+						bitangentCorners.x[corner] = pbx * bScale;
+						bitangentCorners.y[corner] = pby * bScale;
+						bitangentCorners.z[corner] = pbz * bScale;
+					}
+				}
+			});
+
+			const size_t vertexCount = std::min({ positions.size(), normals.size(), tangents.size() });
+			//The bitangent sums are only needed for the handedness, so gather them first into the w component.
+			GatherCorners(adjacency, bitangentCorners, [&](size_t v, float x, float y, float z)
+			{
+				if (v < vertexCount)
+					tangents[v] = float4(x, y, z, 0.0f);
+			});
+			GatherCorners(adjacency, tangentCorners, [&](size_t v, float x, float y, float z)
+			{
+				if (v >= vertexCount)
+					return;
+				const float3& n = normals[v];
+				const float bx = tangents[v].x, by = tangents[v].y, bz = tangents[v].z;
+
+				const float tn = x * n.x + y * n.y + z * n.z;
+				float3 t(x - n.x * tn, y - n.y * tn, z - n.z * tn);
+				const float lengthSq = t.x * t.x + t.y * t.y + t.z * t.z;
+				if (lengthSq > 0.0f)
+				{
+					const float invLength = 1.0f / std::sqrt(lengthSq);
+					t = float3(t.x * invLength, t.y * invLength, t.z * invLength);
+				}
+				else
+				{
+					t = Orthogonal(n.x, n.y, n.z);
+				}
+
+				const float3 nt(n.y * t.z - n.z * t.y, n.z * t.x - n.x * t.z, n.x * t.y - n.y * t.x);
+				const float w = nt.x * bx + nt.y * by + nt.z * bz < 0.0f ? -1.0f : 1.0f;
+				tangents[v] = float4(t.x, t.y, t.z, w);
+				if (v < bitangents.size())
+					bitangents[v] = float3(nt.x * w, nt.y * w, nt.z * w);
+			});
+		}
+		//Computes MikkTSpace-style tangent frames, building the adjacency first.
+		static void Tangents(std::span<const float3> positions, std::span<const float3> normals, std::span<const float2> uvs, std::span<const uint32_t> indices, std::span<float4> tangents, std::span<float3> bitangents = {})
+		{
+			Tangents(positions, normals, uvs, indices, BuildAdjacency(positions.size(), indices), tangents, bitangents);
+		}
+	};
+}
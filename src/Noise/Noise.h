@@ -0,0 +1,530 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Other/Parallel.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector2.h"
+#include "../Vector/Vector3.h"
+#include "../Vector/Vector4.h"
+#include "../Vector/VectorSoA.h"
+
+namespace mars
+{
+	enum class NoiseType : uint8_t
+	{
+		Perlin,
+		Simplex,
+		Worley
+	};
+
+	//Settings of a fractal sum. Octave i samples the noise at frequency * lacunarity^i with amplitude gain^i and seed + i,
+	//and the sum is divided by the total amplitude. Turbulence sums the absolute value of every octave instead.
+	struct NoiseParameters
+	{
+		NoiseType type = NoiseType::Simplex;
+		uint32_t seed = 0;
+		uint32_t octaves = 1;
+		float frequency = 1.0f;
+		float lacunarity = 2.0f;
+		float gain = 0.5f;
+		bool turbulence = false;
+	};
+
+	//Perlin, Simplex and Worley noise in 2, 3 and 4 dimensions, returning the value together with the analytic gradient.
+	//Every kernel works on a block of up to BlockSize points in SoA form, with the lattice loops outside and the point loop inside,
+	//so the inner loops are branch-free and vectorise across points. Lattice gradients and feature points come from an integer hash
+	//of the cell and the seed, so there are no permutation tables and any seed gives an independent pattern.
+	//Perlin and Simplex return values in roughly [-1, 1], Worley returns the distance to the nearest feature point (F1).
+	class Noise
+	{
+	public:
+		static constexpr size_t BlockSize = 64;
+
+	private:
+		static constexpr uint32_t HashPrimes[4] = { 0x8DA6B343u, 0xD8163841u, 0xCB1AB31Fu, 0x165667B1u };
+
+		//Hashes the lattice cell and the seed.
+		template<size_t D>
+		static inline uint32_t HashCell(const int32_t (&cell)[D], uint32_t seed)
+		{
+			uint32_t h = seed * 0x9E3779B9u;
+			Unroll<D>([&](auto k) { h ^= static_cast<uint32_t>(cell[k]) * HashPrimes[k]; });
+			h ^= h >> 16;
+			h *= 0x85EBCA6Bu;
+			h ^= h >> 13;
+			h *= 0xC2B2AE35u;
+			h ^= h >> 16;
+			return h;
+		}
+		//Returns the byte k of the hash mapped to [-1, 1].
+		static inline float HashSigned(uint32_t h, size_t k)
+		{
+			return static_cast<float>((h >> (8 * k)) & 0xFFu) * (2.0f / 255.0f) - 1.0f;
+		}
+		//Returns the byte k of the hash mapped to [0, 1).
+		static inline float HashUnit(uint32_t h, size_t k)
+		{
+			return static_cast<float>((h >> (8 * k)) & 0xFFu) * (1.0f / 256.0f);
+		}
+
+		template<size_t D>
+		static constexpr float PerlinScale()
+		{
+			return D == 2 ? 1.35f : D == 3 ? 1.4f : 1.25f;
+		}
+		template<size_t D>
+		static constexpr float SimplexScale()
+		{
+			return D == 2 ? 75.0f : D == 3 ? 64.0f : 60.0f;
+		}
+
+		//Evaluates Perlin noise and its gradient for count <= BlockSize points.
+		template<size_t D>
+		static void PerlinBlock(const float* const (&points)[D], size_t count, uint32_t seed, float* values, float* const (&gradients)[D])
+		{
+			int32_t base[D][BlockSize];
+			float frac[D][BlockSize], fade[D][BlockSize], fadeDerivative[D][BlockSize];
+			for (size_t k = 0; k < D; k++)
+			{
+				for (size_t i = 0; i < count; i++)
+				{
+					const float floored = std::floor(points[k][i]);
+					const float f = points[k][i] - floored;
+					base[k][i] = static_cast<int32_t>(floored);
+					frac[k][i] = f;
+					fade[k][i] = f * f * f * (f * (f * 6.0f - 15.0f) + 10.0f);
+					fadeDerivative[k][i] = 30.0f * f * f * (f * (f - 2.0f) + 1.0f);
+				}
+			}
+			for (size_t i = 0; i < count; i++)
+			{
+				values[i] = 0.0f;
+				Unroll<D>([&](auto k) { gradients[k][i] = 0.0f; });
+			}
+
+			for (uint32_t corner = 0; corner < (1u << D); corner++)
+			{
+				for (size_t i = 0; i < count; i++)
+				{
+					int32_t cell[D];
+					float offset[D], gradient[D], weight[D], weightDerivative[D];
+					float dot = 0.0f;
+					Unroll<D>([&](auto k)
+					{
+						const bool upper = (corner >> k) & 1u;
+						cell[k] = base[k][i] + (upper ? 1 : 0);
+						offset[k] = frac[k][i] - (upper ? 1.0f : 0.0f);
+						weight[k] = upper ? fade[k][i] : 1.0f - fade[k][i];
+						weightDerivative[k] = upper ? fadeDerivative[k][i] : -fadeDerivative[k][i];
+					});
+					const uint32_t h = HashCell<D>(cell, seed);
+					Unroll<D>([&](auto k)
+					{
+						gradient[k] = HashSigned(h, k);
+						dot += gradient[k] * offset[k];
+					});
+
+					float w = 1.0f;
+					Unroll<D>([&](auto k) { w *= weight[k]; });
+					values[i] += w * dot;
+					Unroll<D>([&](auto k)
+					{
+						float dw = weightDerivative[k];
+						Unroll<D>([&](auto j) { if constexpr (j != k) dw *= weight[j]; });
+						gradients[k][i] += w * gradient[k] + dot * dw;
+					});
+				}
+			}
+
+			for (size_t i = 0; i < count; i++)
+			{
+				values[i] *= PerlinScale<D>();
+				Unroll<D>([&](auto k) { gradients[k][i] *= PerlinScale<D>(); });
+			}
+		}
+
+		//Evaluates Simplex noise and its gradient for count <= BlockSize points.
+		template<size_t D>
+		static void SimplexBlock(const float* const (&points)[D], size_t count, uint32_t seed, float* values, float* const (&gradients)[D])
+		{
+			const float skew = (std::sqrt(static_cast<float>(D + 1)) - 1.0f) / static_cast<float>(D);
+			const float unskew = (1.0f - 1.0f / std::sqrt(static_cast<float>(D + 1))) / static_cast<float>(D);
+
+			int32_t base[D][BlockSize], rank[D][BlockSize];
+			float origin[D][BlockSize];
+			for (size_t i = 0; i < count; i++)
+			{
+				float s = 0.0f;
+				Unroll<D>([&](auto k) { s += points[k][i]; });
+				s *= skew;
+				float t = 0.0f;
+				Unroll<D>([&](auto k)
+				{
+					base[k][i] = static_cast<int32_t>(std::floor(points[k][i] + s));
+					t += static_cast<float>(base[k][i]);
+				});
+				t *= unskew;
+				Unroll<D>([&](auto k)
+				{
+					origin[k][i] = points[k][i] - (static_cast<float>(base[k][i]) - t);
+					rank[k][i] = 0;
+				});
+				//The rank of each component decides the order in which the simplex corners step along the axes.
+				Unroll<D>([&](auto a)
+				{
+					Unroll<D>([&](auto b)
+					{
+						if constexpr (a < b)
+						{
+							const int32_t greater = origin[a][i] > origin[b][i] ? 1 : 0;
+							rank[a][i] += greater;
+							rank[b][i] += 1 - greater;
+						}
+					});
+				});
+				values[i] = 0.0f;
+				Unroll<D>([&](auto k) { gradients[k][i] = 0.0f; });
+			}
+
+			for (int32_t corner = 0; corner <= static_cast<int32_t>(D); corner++)
+			{
+				const int32_t threshold = static_cast<int32_t>(D) - corner;
+				const float cornerUnskew = static_cast<float>(corner) * unskew;
+				for (size_t i = 0; i < count; i++)
+				{
+					int32_t cell[D];
+					float offset[D], gradient[D];
+					float distanceSq = 0.0f, dot = 0.0f;
+					Unroll<D>([&](auto k)
+					{
+						const int32_t step = rank[k][i] >= threshold ? 1 : 0;
+						cell[k] = base[k][i] + step;
+						offset[k] = origin[k][i] - static_cast<float>(step) + cornerUnskew;
+						distanceSq += offset[k] * offset[k];
+					});
+					const uint32_t h = HashCell<D>(cell, seed);
+					Unroll<D>([&](auto k)
+					{
+						gradient[k] = HashSigned(h, k);
+						dot += gradient[k] * offset[k];
+					});
+
+					const float t = std::max(0.5f - distanceSq, 0.0f);
+					const float t2 = t * t;
+					const float t4 = t2 * t2;
+					const float falloffDerivative = 8.0f * t2 * t * dot;
+					values[i] += t4 * dot;
+					Unroll<D>([&](auto k) { gradients[k][i] += t4 * gradient[k] - falloffDerivative * offset[k]; });
+				}
+			}
+
+			for (size_t i = 0; i < count; i++)
+			{
+				values[i] *= SimplexScale<D>();
+				Unroll<D>([&](auto k) { gradients[k][i] *= SimplexScale<D>(); });
+			}
+		}
+
+		//Evaluates Worley (cellular F1) noise and its gradient for count <= BlockSize points.
+		template<size_t D>
+		static void WorleyBlock(const float* const (&points)[D], size_t count, uint32_t seed, float* values, float* const (&gradients)[D])
+		{
+			int32_t base[D][BlockSize];
+			float bestDistanceSq[BlockSize];
+			for (size_t i = 0; i < count; i++)
+			{
+				Unroll<D>([&](auto k)
+				{
+					base[k][i] = static_cast<int32_t>(std::floor(points[k][i]));
+					gradients[k][i] = 0.0f;
+				});
+				bestDistanceSq[i] = std::numeric_limits<float>::max();
+			}
+
+			uint32_t neighbourCount = 1;
+			for (size_t k = 0; k < D; k++)
+				neighbourCount *= 3;
+			for (uint32_t neighbour = 0; neighbour < neighbourCount; neighbour++)
+			{
+				int32_t step[D];
+				uint32_t remaining = neighbour;
+				for (size_t k = 0; k < D; k++, remaining /= 3)
+					step[k] = static_cast<int32_t>(remaining % 3) - 1;
+
+				for (size_t i = 0; i < count; i++)
+				{
+					int32_t cell[D];
+					float delta[D];
+					float distanceSq = 0.0f;
+					Unroll<D>([&](auto k) { cell[k] = base[k][i] + step[k]; });
+					const uint32_t h = HashCell<D>(cell, seed);
+					Unroll<D>([&](auto k)
+					{
+						delta[k] = points[k][i] - (static_cast<float>(cell[k]) + HashUnit(h, k));
+						distanceSq += delta[k] * delta[k];
+					});
+					const bool closer = distanceSq < bestDistanceSq[i];
+					bestDistanceSq[i] = closer ? distanceSq : bestDistanceSq[i];
+					//Keep the offset to the nearest feature point in the gradient arrays until the distance is known.
+					Unroll<D>([&](auto k) { gradients[k][i] = closer ? delta[k] : gradients[k][i]; });
+				}
+			}
+
+			for (size_t i = 0; i < count; i++)
+			{
+				const float distance = std::sqrt(bestDistanceSq[i]);
+				const float invDistance = distance > 0.0f ? 1.0f / distance : 0.0f;
+				values[i] = distance;
+				Unroll<D>([&](auto k) { gradients[k][i] *= invDistance; });
+			}
+		}
+
+		//Evaluates the noise type for count <= BlockSize points.
+		template<size_t D>
+		static void EvaluateBlock(NoiseType type, const float* const (&points)[D], size_t count, uint32_t seed, float* values, float* const (&gradients)[D])
+		{
+			switch (type)
+			{
+			case NoiseType::Perlin:
+				PerlinBlock<D>(points, count, seed, values, gradients);
+				break;
+			case NoiseType::Simplex:
+				SimplexBlock<D>(points, count, seed, values, gradients);
+				break;
+			case NoiseType::Worley:
+				WorleyBlock<D>(points, count, seed, values, gradients);
+				break;
+			}
+		}
+
+		//Evaluates the fractal sum for count <= BlockSize points.
+		template<size_t D>
+		static void FractalBlock(const NoiseParameters& parameters, const float* const (&points)[D], size_t count, float* values, float* const (&gradients)[D])
+		{
+			float scaled[D][BlockSize], octaveGradient[D][BlockSize], octaveValue[BlockSize];
+			const float* scaledPointers[D];
+			float* octaveGradientPointers[D];
+			Unroll<D>([&](auto k)
+			{
+				scaledPointers[k] = scaled[k];
+				octaveGradientPointers[k] = octaveGradient[k];
+			});
+			for (size_t i = 0; i < count; i++)
+			{
+				values[i] = 0.0f;
+				Unroll<D>([&](auto k) { gradients[k][i] = 0.0f; });
+			}
+
+			const uint32_t octaves = std::max(parameters.octaves, 1u);
+			float frequency = parameters.frequency;
+			float amplitude = 1.0f;
+			float totalAmplitude = 0.0f;
+			for (uint32_t octave = 0; octave < octaves; octave++)
+			{
+				for (size_t k = 0; k < D; k++)
+				{
+					for (size_t i = 0; i < count; i++)
+						scaled[k][i] = points[k][i] * frequency;
+				}
+				EvaluateBlock<D>(parameters.type, scaledPointers, count, parameters.seed + octave, octaveValue, octaveGradientPointers);
+
+				const float gradientScale = amplitude * frequency;
+				for (size_t i = 0; i < count; i++)
+				{
+					const float sign = parameters.turbulence && octaveValue[i] < 0.0f ? -1.0f : 1.0f;
+					values[i] += amplitude * sign * octaveValue[i];
+					Unroll<D>([&](auto k) { gradients[k][i] += gradientScale * sign * octaveGradient[k][i]; });
+				}
+				totalAmplitude += amplitude;
+				frequency *= parameters.lacunarity;
+				amplitude *= parameters.gain;
+			}
+
+			const float invTotalAmplitude = totalAmplitude > 0.0f ? 1.0f / totalAmplitude : 0.0f;
+			for (size_t i = 0; i < count; i++)
+			{
+				values[i] *= invTotalAmplitude;
+				Unroll<D>([&](auto k) { gradients[k][i] *= invTotalAmplitude; });
+			}
+		}
+
+		//Evaluates a single point through the block kernels.
+		template<size_t D, typename BlockFunc>
+		static float EvaluatePoint(const Vector<float, D>& p, Vector<float, D>* gradient, BlockFunc&& block)
+		{
+			float value;
+			Vector<float, D> g;
+			const float* points[D];
+			float* gradients[D];
+			Unroll<D>([&](auto k)
+			{
+				points[k] = &p.data[k];
+				gradients[k] = &g.data[k];
+			});
+			block(points, gradients, &value);
+			if (gradient)
+				*gradient = g;
+			return value;
+		}
+
+		template<size_t D>
+		static bool FillGridImpl(const NoiseParameters& parameters, const float (&origin)[D], const float (&spacing)[D], const uint32_t (&size)[D], std::span<float> values, VectorSoA<float, D>* gradients, uint32_t tileSize)
+		{
+			size_t total = 1;
+			for (size_t k = 0; k < D; k++)
+				total *= size[k];
+			if (values.size() < total || (gradients && gradients->GetCount() < total))
+				return false;
+			if (total == 0)
+				return true;
+
+			tileSize = std::max(tileSize, 1u);
+			const size_t tilesX = (size[0] + tileSize - 1) / tileSize;
+			const size_t tilesY = (size[1] + tileSize - 1) / tileSize;
+			const size_t slices = total / (size_t(size[0]) * size[1]);
+			float* gradientData[D];
+			Unroll<D>([&](auto k) { gradientData[k] = gradients ? gradients->GetComponent(k).data() : nullptr; });
+
+			//One work item is a tileSize x tileSize tile of one slice; rows of a tile are evaluated in blocks.
+			Parallel::For(tilesX * tilesY * slices, 1, [&](size_t begin, size_t end)
+			{
+				float coords[D][BlockSize], blockGradient[D][BlockSize];
+				const float* coordPointers[D];
+				float* blockGradientPointers[D];
+				Unroll<D>([&](auto k)
+				{
+					coordPointers[k] = coords[k];
+					blockGradientPointers[k] = blockGradient[k];
+				});
+
+				for (size_t item = begin; item < end; item++)
+				{
+					const size_t tileX = item % tilesX;
+					const size_t tileY = (item / tilesX) % tilesY;
+					const size_t slice = item / (tilesX * tilesY);
+					const uint32_t x0 = static_cast<uint32_t>(tileX * tileSize);
+					const uint32_t y0 = static_cast<uint32_t>(tileY * tileSize);
+					const uint32_t x1 = std::min(x0 + tileSize, size[0]);
+					const uint32_t y1 = std::min(y0 + tileSize, size[1]);
+
+					float sliceCoords[D];
+					size_t remaining = slice;
+					for (size_t k = 2; k < D; k++, remaining /= size[k - 1])
+						sliceCoords[k] = origin[k] + static_cast<float>(remaining % size[k]) * spacing[k];
+
+					for (uint32_t y = y0; y < y1; y++)
+					{
+						const size_t rowOffset = (slice * size[1] + y) * size[0];
+						for (uint32_t x = x0; x < x1; x += static_cast<uint32_t>(BlockSize))
+						{
+							const size_t count = std::min<size_t>(BlockSize, x1 - x);
+							for (size_t i = 0; i < count; i++)
+							{
+								coords[0][i] = origin[0] + static_cast<float>(x + i) * spacing[0];
+								coords[1][i] = origin[1] + static_cast<float>(y) * spacing[1];
+								for (size_t k = 2; k < D; k++)
+									coords[k][i] = sliceCoords[k];
+							}
+							FractalBlock<D>(parameters, coordPointers, count, values.data() + rowOffset + x, blockGradientPointers);
+							if (gradients)
+							{
+								for (size_t k = 0; k < D; k++)
+									std::copy(blockGradient[k], blockGradient[k] + count, gradientData[k] + rowOffset + x);
+							}
+						}
+					}
+				}
+			});
+			return true;
+		}
+
+	public:
+		//Returns Perlin noise at the point, and its gradient if requested.
+		template<size_t D>
+		static float Perlin(const Vector<float, D>& p, Vector<float, D>* gradient = nullptr, uint32_t seed = 0)
+		{
+			return EvaluatePoint<D>(p, gradient, [&](const float* const (&points)[D], float* const (&gradients)[D], float* value) { PerlinBlock<D>(points, 1, seed, value, gradients); });
+		}
+		//Returns Simplex noise at the point, and its gradient if requested.
+		template<size_t D>
+		static float Simplex(const Vector<float, D>& p, Vector<float, D>* gradient = nullptr, uint32_t seed = 0)
+		{
+			return EvaluatePoint<D>(p, gradient, [&](const float* const (&points)[D], float* const (&gradients)[D], float* value) { SimplexBlock<D>(points, 1, seed, value, gradients); });
+		}
+		//Returns Worley (F1) noise at the point, and its gradient if requested.
+		template<size_t D>
+		static float Worley(const Vector<float, D>& p, Vector<float, D>* gradient = nullptr, uint32_t seed = 0)
+		{
+			return EvaluatePoint<D>(p, gradient, [&](const float* const (&points)[D], float* const (&gradients)[D], float* value) { WorleyBlock<D>(points, 1, seed, value, gradients); });
+		}
+
+		//Returns the fractal sum (fBm, or turbulence) at the point, and its gradient if requested.
+		template<size_t D>
+		static float Fractal(const NoiseParameters& parameters, const Vector<float, D>& p, Vector<float, D>* gradient = nullptr)
+		{
+			return EvaluatePoint<D>(p, gradient, [&](const float* const (&points)[D], float* const (&gradients)[D], float* value) { FractalBlock<D>(parameters, points, 1, value, gradients); });
+		}
+		//Returns the fractal sum at the float2, and its gradient if requested.
+		static float Fractal(const NoiseParameters& parameters, const float2& p, float2* gradient = nullptr)
+		{
+			Vector<float, 2> g;
+			const float value = Fractal<2>(parameters, p, &g);
+			if (gradient)
+				*gradient = g;
+			return value;
+		}
+		//Returns the fractal sum at the float3, and its gradient if requested.
+		static float Fractal(const NoiseParameters& parameters, const float3& p, float3* gradient = nullptr)
+		{
+			Vector<float, 3> g;
+			const float value = Fractal<3>(parameters, p, &g);
+			if (gradient)
+				*gradient = g;
+			return value;
+		}
+		//Returns the fractal sum at the float4, and its gradient if requested.
+		static float Fractal(const NoiseParameters& parameters, const float4& p, float4* gradient = nullptr)
+		{
+			Vector<float, 4> g;
+			const float value = Fractal<4>(parameters, p, &g);
+			if (gradient)
+				*gradient = g;
+			return value;
+		}
+
+		//Evaluates the fractal sum at min(points.GetCount(), values.size()) points, writing gradients too if requested.
+		template<size_t D>
+		static void Fractal(const NoiseParameters& parameters, const VectorSoA<float, D>& points, std::span<float> values, VectorSoA<float, D>* gradients = nullptr)
+		{
+			size_t count = std::min(points.GetCount(), values.size());
+			if (gradients)
+				count = std::min(count, gradients->GetCount());
+
+			float blockGradient[D][BlockSize];
+			const float* pointPointers[D];
+			float* gradientPointers[D];
+			for (size_t base = 0; base < count; base += BlockSize)
+			{
+				const size_t blockCount = std::min(BlockSize, count - base);
+				Unroll<D>([&](auto k)
+				{
+					pointPointers[k] = points.GetComponent(k).data() + base;
+					gradientPointers[k] = gradients ? gradients->GetComponent(k).data() + base : blockGradient[k];
+				});
+				FractalBlock<D>(parameters, pointPointers, blockCount, values.data() + base, gradientPointers);
+			}
+		}
+
+		//Fills a width x height grid of samples at origin + (x, y) * spacing, stored row by row, across threads over tiles.
+		//Returns false if values (or gradients) holds fewer than width * height elements.
+		static bool FillGrid(const NoiseParameters& parameters, const float2& origin, const float2& spacing, uint32_t width, uint32_t height, std::span<float> values, float2SoA* gradients = nullptr, uint32_t tileSize = 64)
+		{
+			return FillGridImpl<2>(parameters, { origin.x, origin.y }, { spacing.x, spacing.y }, { width, height }, values, gradients, tileSize);
+		}
+		//Fills a width x height x depth grid of samples at origin + (x, y, z) * spacing, stored slice by slice, across threads over tiles.
+		//Returns false if values (or gradients) holds fewer than width * height * depth elements.
+		static bool FillGrid(const NoiseParameters& parameters, const float3& origin, const float3& spacing, uint32_t width, uint32_t height, uint32_t depth, std::span<float> values, float3SoA* gradients = nullptr, uint32_t tileSize = 64)
+		{
+			return FillGridImpl<3>(parameters, { origin.x, origin.y, origin.z }, { spacing.x, spacing.y, spacing.z }, { width, height, depth }, values, gradients, tileSize);
+		}
+	};
+}
@@ -0,0 +1,233 @@
+#pragma once
+#include "../mars_common.h"
+#include <array>
+#include <chrono>
+
+//Define MARS_ENABLE_INSTRUMENTATION as 1 before including mars to count calls to the instrumented operations and degenerate cases per thread.
+//Define MARS_ENABLE_INSTRUMENTATION_CYCLES as 1 as well to accumulate the cycles (rdtsc, or steady_clock nanoseconds off x86) spent in them.
+//When disabled, the MARS_INSTRUMENT macros expand to nothing.
+#ifndef MARS_ENABLE_INSTRUMENTATION
+#define MARS_ENABLE_INSTRUMENTATION 0
+#endif
+#ifndef MARS_ENABLE_INSTRUMENTATION_CYCLES
+#define MARS_ENABLE_INSTRUMENTATION_CYCLES 0
+#endif
+
+#if MARS_ENABLE_INSTRUMENTATION
+#include <atomic>
+#include <mutex>
+#include <vector>
+#if MARS_ENABLE_INSTRUMENTATION_CYCLES
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+#define MARS_INSTRUMENT(operation) const ::mars::Instrumentation::Scope marsInstrumentationScope(::mars::InstrumentedOperation::operation)
+#define MARS_INSTRUMENT_EVENT(event) ::mars::Instrumentation::Record(::mars::InstrumentedEvent::event)
+#else
+#define MARS_INSTRUMENT(operation) ((void)0)
+#define MARS_INSTRUMENT_EVENT(event) ((void)0)
+#endif
+
+namespace mars
+{
+	//Operations whose calls are counted.
+	enum class InstrumentedOperation : uint8_t
+	{
+		MatrixInverse,
+		VectorNormalise,
+		QuaternionNormalise,
+		QuaternionSlerp,
+		QuaternionFromAxisAngle,
+		Matrix4Rotation,
+		Count
+	};
+
+	//Degenerate cases met by the instrumented operations.
+	enum class InstrumentedEvent : uint8_t
+	{
+		//Inverse of a matrix with a determinant of 0; the input is returned.
+		SingularInverse,
+		//Normalise of a vector or quaternion of length 0; the input is returned.
+		ZeroLengthNormalise,
+		//Slerp between equal or opposite quaternions, where sin(theta) is 0.
+		DegenerateSlerp,
+		Count
+	};
+
+	//Counters summed over all threads, indexed by InstrumentedOperation and InstrumentedEvent.
+	struct InstrumentationCounters
+	{
+		std::array<uint64_t, static_cast<size_t>(InstrumentedOperation::Count)> calls = {};
+		std::array<uint64_t, static_cast<size_t>(InstrumentedOperation::Count)> cycles = {};
+		std::array<uint64_t, static_cast<size_t>(InstrumentedEvent::Count)> events = {};
+
+		inline uint64_t GetCalls(InstrumentedOperation operation) const { return calls[static_cast<size_t>(operation)]; }
+		inline uint64_t GetCycles(InstrumentedOperation operation) const { return cycles[static_cast<size_t>(operation)]; }
+		inline uint64_t GetEvents(InstrumentedEvent event) const { return events[static_cast<size_t>(event)]; }
+	};
+
+	//Per-thread operation counters. Every thread writes only its own counters, so counting needs no locks or atomic read-modify-writes;
+	//Snapshot sums the counters of the live threads and of the threads that have exited.
+	class Instrumentation
+	{
+	public:
+		static constexpr bool Enabled = MARS_ENABLE_INSTRUMENTATION;
+		static constexpr bool CyclesEnabled = MARS_ENABLE_INSTRUMENTATION && MARS_ENABLE_INSTRUMENTATION_CYCLES;
+
+	private:
+#if MARS_ENABLE_INSTRUMENTATION
+		struct ThreadCounters
+		{
+			std::array<std::atomic<uint64_t>, static_cast<size_t>(InstrumentedOperation::Count)> calls = {};
+			std::array<std::atomic<uint64_t>, static_cast<size_t>(InstrumentedOperation::Count)> cycles = {};
+			std::array<std::atomic<uint64_t>, static_cast<size_t>(InstrumentedEvent::Count)> events = {};
+
+			ThreadCounters()
+			{
+				std::lock_guard<std::mutex> lock(GetRegistryMutex());
+				GetRegistry().push_back(this);
+			}
+			~ThreadCounters()
+			{
+				std::lock_guard<std::mutex> lock(GetRegistryMutex());
+				AddTo(GetRetired());
+				std::vector<ThreadCounters*>& registry = GetRegistry();
+				registry.erase(std::find(registry.begin(), registry.end(), this));
+			}
+
+			void AddTo(InstrumentationCounters& output) const
+			{
+				for (size_t idx = 0; idx < calls.size(); idx++)
+				{
+					output.calls[idx] += calls[idx].load(std::memory_order_relaxed);
+					output.cycles[idx] += cycles[idx].load(std::memory_order_relaxed);
+				}
+				for (size_t idx = 0; idx < events.size(); idx++)
+					output.events[idx] += events[idx].load(std::memory_order_relaxed);
+			}
+		};
+
+		static inline void Increment(std::atomic<uint64_t>& counter, uint64_t amount)
+		{
+			counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+		}
+
+		//The registry is allocated once and never freed: thread_local counters of pool threads joined at exit, after the function-local
+		//statics would have been destroyed, still lock it and remove themselves.
+		static std::mutex& GetRegistryMutex()
+		{
+			static std::mutex& mutex = *new std::mutex;
+			return mutex;
+		}
+		static std::vector<ThreadCounters*>& GetRegistry()
+		{
+			static std::vector<ThreadCounters*>& registry = *new std::vector<ThreadCounters*>;
+			return registry;
+		}
+		static InstrumentationCounters& GetRetired()
+		{
+			static InstrumentationCounters& retired = *new InstrumentationCounters;
+			return retired;
+		}
+		static ThreadCounters& GetThreadCounters()
+		{
+			thread_local ThreadCounters counters;
+			return counters;
+		}
+#endif
+
+	public:
+		//Returns the cycle counter: rdtsc on x86, steady_clock nanoseconds elsewhere.
+		static inline uint64_t ReadCycles()
+		{
+#if MARS_ENABLE_INSTRUMENTATION && MARS_ENABLE_INSTRUMENTATION_CYCLES && (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+			return __rdtsc();
+#else
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+		}
+
+		//Counts a call to the operation, adding cycles to its cycle count.
+		static inline void Count([[maybe_unused]] InstrumentedOperation operation, [[maybe_unused]] uint64_t cycles = 0)
+		{
+#if MARS_ENABLE_INSTRUMENTATION
+			ThreadCounters& counters = GetThreadCounters();
+			Increment(counters.calls[static_cast<size_t>(operation)], 1);
+			if (cycles)
+				Increment(counters.cycles[static_cast<size_t>(operation)], cycles);
+#endif
+		}
+		//Counts the degenerate case.
+		static inline void Record([[maybe_unused]] InstrumentedEvent event)
+		{
+#if MARS_ENABLE_INSTRUMENTATION
+			Increment(GetThreadCounters().events[static_cast<size_t>(event)], 1);
+#endif
+		}
+
+		//Returns the counters summed over all threads since the last Reset. All zero when instrumentation is disabled.
+		static InstrumentationCounters Snapshot()
+		{
+			InstrumentationCounters result;
+#if MARS_ENABLE_INSTRUMENTATION
+			std::lock_guard<std::mutex> lock(GetRegistryMutex());
+			result = GetRetired();
+			for (const ThreadCounters* counters : GetRegistry())
+				counters->AddTo(result);
+#endif
+			return result;
+		}
+		//Sets all counters to 0. Counts made by other threads while Reset runs may survive it.
+		static void Reset()
+		{
+#if MARS_ENABLE_INSTRUMENTATION
+			std::lock_guard<std::mutex> lock(GetRegistryMutex());
+			GetRetired() = InstrumentationCounters();
+			for (ThreadCounters* counters : GetRegistry())
+			{
+				for (std::atomic<uint64_t>& counter : counters->calls)
+					counter.store(0, std::memory_order_relaxed);
+				for (std::atomic<uint64_t>& counter : counters->cycles)
+					counter.store(0, std::memory_order_relaxed);
+				for (std::atomic<uint64_t>& counter : counters->events)
+					counter.store(0, std::memory_order_relaxed);
+			}
+#endif
+		}
+
+		//Returns the name of the operation.
+		static const char* GetName(InstrumentedOperation operation)
+		{
+			constexpr const char* Names[] = { "MatrixInverse", "VectorNormalise", "QuaternionNormalise", "QuaternionSlerp", "QuaternionFromAxisAngle", "Matrix4Rotation" };
+			static_assert(std::size(Names) == static_cast<size_t>(InstrumentedOperation::Count));
+			return operation < InstrumentedOperation::Count ? Names[static_cast<size_t>(operation)] : "";
+		}
+		//Returns the name of the event.
+		static const char* GetName(InstrumentedEvent event)
+		{
+			constexpr const char* Names[] = { "SingularInverse", "ZeroLengthNormalise", "DegenerateSlerp" };
+			static_assert(std::size(Names) == static_cast<size_t>(InstrumentedEvent::Count));
+			return event < InstrumentedEvent::Count ? Names[static_cast<size_t>(event)] : "";
+		}
+
+		//Counts the operation for the lifetime of the Scope, with its cycles if MARS_ENABLE_INSTRUMENTATION_CYCLES is set. Used by MARS_INSTRUMENT.
+		class Scope
+		{
+		private:
+			InstrumentedOperation m_Operation;
+			uint64_t m_Start;
+
+		public:
+			explicit Scope(InstrumentedOperation operation)
+				: m_Operation(operation), m_Start(CyclesEnabled ? ReadCycles() : 0) {}
+			~Scope()
+			{
+				Count(m_Operation, CyclesEnabled ? ReadCycles() - m_Start : 0);
+			}
+		};
+	};
+}
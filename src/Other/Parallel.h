@@ -0,0 +1,307 @@
+#pragma once
+#include "../mars_common.h"
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mars
+{
+	//How a batched operation runs. Sequential runs the scalar code path on the calling thread; Simd runs the blocked, branch-free code path
+	//that the compiler vectorises, on the calling thread; ParallelSimd splits the Simd code path across the Parallel executor.
+	enum class ExecutionPolicy : uint8_t
+	{
+		Sequential,
+		Simd,
+		ParallelSimd
+	};
+
+	//Work-stealing parallel-for over a persistent pool of worker threads, with the calling thread taking part.
+	//Every participant starts with a contiguous, equal share of the chunks, so each thread first touches the same part of the data on
+	//every call; a participant that runs out steals half of the remaining chunks of another. A For called while the executor is busy
+	//(from inside a func, or from another thread) runs on the calling thread.
+	class Parallel
+	{
+	private:
+		//The remaining chunks [front, back) of a participant, packed into one atomic so the owner and the thieves update it with a single CAS.
+		struct alignas(64) ChunkRange
+		{
+			std::atomic<uint64_t> range;
+		};
+
+		static inline uint64_t Pack(uint32_t front, uint32_t back) { return (static_cast<uint64_t>(back) << 32) | front; }
+		static inline uint32_t Front(uint64_t range) { return static_cast<uint32_t>(range); }
+		static inline uint32_t Back(uint64_t range) { return static_cast<uint32_t>(range >> 32); }
+
+		class Executor
+		{
+		private:
+			std::vector<std::thread> m_Threads;
+			std::unique_ptr<ChunkRange[]> m_Ranges;
+			std::atomic<bool> m_Busy = false;
+			std::mutex m_WakeMutex;
+			std::condition_variable m_Wake;
+			uint64_t m_Generation = 0;
+			bool m_Stop = false;
+			std::atomic<uint32_t> m_Pending = 0;
+
+			//The current job, written before m_Generation is advanced.
+			void (*m_Invoke)(void*, size_t, size_t) = nullptr;
+			void* m_Context = nullptr;
+			size_t m_Count = 0;
+			size_t m_ChunkSize = 0;
+			uint32_t m_Participants = 0;
+			bool m_Steal = false;
+
+			//Takes the front chunk of the participant's own range.
+			bool PopFront(uint32_t participant, uint32_t& chunk)
+			{
+				std::atomic<uint64_t>& range = m_Ranges[participant].range;
+				uint64_t current = range.load(std::memory_order_acquire);
+				while (Front(current) < Back(current))
+				{
+					if (range.compare_exchange_weak(current, Pack(Front(current) + 1, Back(current)), std::memory_order_acq_rel))
+					{
+						chunk = Front(current);
+						return true;
+					}
+				}
+				return false;
+			}
+			//Moves the back half of the remaining chunks of another participant into the participant's own, empty range.
+			bool Steal(uint32_t participant)
+			{
+				for (uint32_t offset = 1; offset < m_Participants; offset++)
+				{
+					std::atomic<uint64_t>& victim = m_Ranges[(participant + offset) % m_Participants].range;
+					uint64_t current = victim.load(std::memory_order_acquire);
+					while (Front(current) < Back(current))
+					{
+						const uint32_t split = Back(current) - (Back(current) - Front(current) + 1) / 2;
+						if (victim.compare_exchange_weak(current, Pack(Front(current), split), std::memory_order_acq_rel))
+						{
+							m_Ranges[participant].range.store(Pack(split, Back(current)), std::memory_order_release);
+							return true;
+						}
+					}
+				}
+				return false;
+			}
+			void Run(uint32_t participant)
+			{
+				while (true)
+				{
+					uint32_t chunk;
+					while (PopFront(participant, chunk))
+					{
+						const size_t begin = static_cast<size_t>(chunk) * m_ChunkSize;
+						m_Invoke(m_Context, begin, std::min(begin + m_ChunkSize, m_Count));
+					}
+					if (!m_Steal || !Steal(participant))
+						return;
+				}
+			}
+
+			void WorkerLoop(uint32_t participant)
+			{
+				uint64_t generation = 0;
+				while (true)
+				{
+					{
+						std::unique_lock<std::mutex> lock(m_WakeMutex);
+						m_Wake.wait(lock, [&]() { return m_Stop || m_Generation != generation; });
+						if (m_Stop)
+							return;
+						generation = m_Generation;
+					}
+					if (participant < m_Participants)
+						Run(participant);
+					if (m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+						m_Pending.notify_one();
+				}
+			}
+
+		public:
+			explicit Executor(uint32_t threadCount)
+				: m_Ranges(std::make_unique<ChunkRange[]>(threadCount))
+			{
+				m_Threads.reserve(threadCount - 1);
+				for (uint32_t participant = 1; participant < threadCount; participant++)
+					m_Threads.emplace_back([this, participant]() { WorkerLoop(participant); });
+			}
+			~Executor()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_WakeMutex);
+					m_Stop = true;
+				}
+				m_Wake.notify_all();
+				for (std::thread& thread : m_Threads)
+					thread.join();
+			}
+
+			inline uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Threads.size()) + 1; }
+
+			//Runs invoke(context, begin, end) over the chunks with up to participants threads. Returns false, without running anything, if the executor is busy.
+			bool TryRun(size_t count, size_t chunkSize, uint32_t participants, bool steal, void (*invoke)(void*, size_t, size_t), void* context)
+			{
+				if (m_Busy.exchange(true, std::memory_order_acquire))
+					return false;
+
+				const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+				for (uint32_t participant = 0; participant < participants; participant++)
+				{
+					const uint32_t front = static_cast<uint32_t>(chunkCount * participant / participants);
+					const uint32_t back = static_cast<uint32_t>(chunkCount * (participant + 1) / participants);
+					m_Ranges[participant].range.store(Pack(front, back), std::memory_order_relaxed);
+				}
+				m_Pending.store(static_cast<uint32_t>(m_Threads.size()), std::memory_order_relaxed);
+				{
+					std::lock_guard<std::mutex> lock(m_WakeMutex);
+					m_Invoke = invoke;
+					m_Context = context;
+					m_Count = count;
+					m_ChunkSize = chunkSize;
+					m_Participants = participants;
+					m_Steal = steal;
+					m_Generation++;
+				}
+				m_Wake.notify_all();
+
+				Run(0);
+				for (uint32_t pending = m_Pending.load(std::memory_order_acquire); pending != 0; pending = m_Pending.load(std::memory_order_acquire))
+					m_Pending.wait(pending, std::memory_order_acquire);
+				m_Busy.store(false, std::memory_order_release);
+				return true;
+			}
+		};
+
+		static inline std::atomic<uint32_t> s_ThreadLimit = 0;
+
+		static Executor& GetExecutor()
+		{
+			static Executor executor(GetHardwareThreadCount());
+			return executor;
+		}
+
+		template<typename F>
+		static void InvokeRange(void* context, size_t begin, size_t end)
+		{
+			(*static_cast<F*>(context))(begin, end);
+		}
+
+		template<typename F>
+		static void Run(size_t count, size_t chunkSize, bool steal, F&& func)
+		{
+			if (count == 0)
+				return;
+
+			chunkSize = std::max<size_t>(chunkSize, 1);
+			const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+			const uint32_t participants = static_cast<uint32_t>(std::min<size_t>(GetThreadCount(), chunkCount));
+			//Chunk indices are packed into 32 bits.
+			if (participants <= 1 || chunkCount > UINT32_MAX)
+			{
+				func(size_t(0), count);
+				return;
+			}
+
+			using Func = std::remove_reference_t<F>;
+			if (!GetExecutor().TryRun(count, chunkSize, participants, steal, &InvokeRange<Func>, const_cast<void*>(static_cast<const void*>(&func))))
+				func(size_t(0), count);
+		}
+
+	public:
+		//Returns the number of hardware threads, at least 1.
+		static uint32_t GetHardwareThreadCount()
+		{
+			return std::max(1u, std::thread::hardware_concurrency());
+		}
+		//Returns the number of threads a For runs on: the hardware threads, or fewer if limited by SetThreadCount.
+		static uint32_t GetThreadCount()
+		{
+			const uint32_t limit = s_ThreadLimit.load(std::memory_order_relaxed);
+			return limit ? std::min(limit, GetHardwareThreadCount()) : GetHardwareThreadCount();
+		}
+		//Limits the threads used by later calls, e.g. to measure scaling; 0 restores all hardware threads.
+		static void SetThreadCount(uint32_t threadCount)
+		{
+			s_ThreadLimit.store(threadCount, std::memory_order_relaxed);
+		}
+
+		//Returns a chunk size of at least minChunkSize that gives about 8 chunks per thread, enough for stealing to even out the load.
+		static size_t GetChunkSize(size_t count, size_t minChunkSize = 1)
+		{
+			const size_t targetChunks = static_cast<size_t>(GetThreadCount()) * 8;
+			return std::max<size_t>(std::max<size_t>(minChunkSize, 1), (count + targetChunks - 1) / targetChunks);
+		}
+
+		//Calls func(begin, end) for consecutive chunks of [0, count) of at most chunkSize indices, spread across threads.
+		//Chunks are balanced by work stealing, so func must only write to data owned by its own indices.
+		template<typename F>
+		static void For(size_t count, size_t chunkSize, F&& func)
+		{
+			Run(count, chunkSize, true, func);
+		}
+		//Calls func(begin, end) as For does with ExecutionPolicy::ParallelSimd, and as func(0, count) on the calling thread otherwise.
+		template<typename F>
+		static void For(ExecutionPolicy policy, size_t count, size_t chunkSize, F&& func)
+		{
+			if (policy == ExecutionPolicy::ParallelSimd)
+				Run(count, chunkSize, true, func);
+			else if (count)
+				func(size_t(0), count);
+		}
+		//Calls func(begin, end) once per thread, for equal contiguous parts of [0, count) of at least minChunkSize indices, without stealing.
+		//The same thread handles the same part on every call of the same count, which keeps first-touch memory local to it.
+		template<typename F>
+		static void ForStatic(size_t count, size_t minChunkSize, F&& func)
+		{
+			const size_t threadCount = GetThreadCount();
+			Run(count, std::max<size_t>(minChunkSize, (count + threadCount - 1) / threadCount), false, func);
+		}
+		//Calls query(idx, results) for every index of [0, count) across threads, where query appends the values of idx to results and
+		//returns how many it appended, and gathers them in compressed rows: the values of idx are values[offsets[idx]] to values[offsets[idx + 1] - 1].
+		//Returns false, leaving offsets and values empty, if the total number of values does not fit in Offset.
+		template<typename Offset, typename V, typename F>
+		static bool Gather(size_t count, size_t chunkSize, std::vector<Offset>& offsets, std::vector<V>& values, F&& query)
+		{
+			chunkSize = std::max<size_t>(chunkSize, 1);
+			const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+			std::vector<std::vector<V>> chunkValues(chunkCount);
+			std::vector<size_t> counts(count);
+			For(count, chunkSize, [&](size_t begin, size_t end)
+			{
+				std::vector<V>& local = chunkValues[begin / chunkSize];
+				for (size_t idx = begin; idx < end; idx++)
+					counts[idx] = query(idx, local);
+			});
+
+			size_t total = 0;
+			for (const std::vector<V>& chunk : chunkValues)
+				total += chunk.size();
+			if (total > static_cast<size_t>(std::numeric_limits<Offset>::max()))
+			{
+				offsets.clear();
+				values.clear();
+				return false;
+			}
+
+			offsets.resize(count + 1);
+			offsets[0] = 0;
+			for (size_t idx = 0; idx < count; idx++)
+				offsets[idx + 1] = static_cast<Offset>(offsets[idx] + counts[idx]);
+			values.resize(total);
+			//A chunk's values start at the offset of its first index; a range run in one call is all in its first chunk.
+			For(chunkCount, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t chunk = begin; chunk < end; chunk++)
+					std::copy(chunkValues[chunk].begin(), chunkValues[chunk].end(), values.begin() + offsets[chunk * chunkSize]);
+			});
+			return true;
+		}
+	};
+}
@@ -0,0 +1,265 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Matrix/Matrix3.h"
+#include "../Other/Parallel.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector3.h"
+#include <limits>
+#include <vector>
+
+namespace mars
+{
+	//Rigid-body state stored as a structure of arrays: one array per component of the position, orientation, linear and angular
+	//velocity and accumulated force and torque, with the inverse mass and the body-space inverse inertia tensor per body. The
+	//integration kernels run over the arrays without branches, so each component is processed a register at a time.
+	template<typename T>
+	class RigidBodies
+	{
+	private:
+		//Below this half angle, sin(h) / h and cos(h) use their Taylor series.
+		static constexpr T SmallAngle = static_cast<T>(1e-3);
+
+		std::vector<T> m_PositionX, m_PositionY, m_PositionZ;
+		std::vector<T> m_OrientationS, m_OrientationI, m_OrientationJ, m_OrientationK;
+		std::vector<T> m_LinearVelocityX, m_LinearVelocityY, m_LinearVelocityZ;
+		std::vector<T> m_AngularVelocityX, m_AngularVelocityY, m_AngularVelocityZ;
+		std::vector<T> m_ForceX, m_ForceY, m_ForceZ;
+		std::vector<T> m_TorqueX, m_TorqueY, m_TorqueZ;
+		std::vector<T> m_InverseMass;
+		std::vector<Matrix3<T>> m_InverseInertia;
+		//Largest |1 - |q|^2| an orientation may drift to before it is renormalised.
+		T m_DriftTolerance;
+
+		//Rotates (x, y, z) by the unit quaternion (s, i, j, k), or by its conjugate if inverse is set, with v + 2s(u x v) + 2u x (u x v).
+		static inline void Rotate(T s, T i, T j, T k, T& x, T& y, T& z, bool inverse)
+		{
+			const T w = inverse ? -s : s;
+			const T tx = 2 * (j * z - k * y), ty = 2 * (k * x - i * z), tz = 2 * (i * y - j * x);
+			const T rx = x + w * tx + (j * tz - k * ty);
+			const T ry = y + w * ty + (k * tx - i * tz);
+			const T rz = z + w * tz + (i * ty - j * tx);
+			x = rx;
+			y = ry;
+			z = rz;
+		}
+
+	public:
+		//Rotates the orientation (s, i, j, k) by the world-space angular velocity over dt with the exponential map,
+		//q' = exp(w * dt / 2) * q, which stays a rotation however large the step. The result is only renormalised, with one
+		//Newton step of 1 / sqrt(|q|^2) instead of a sqrt and a division, once |1 - |q|^2| exceeds driftTolerance.
+		static inline void IntegrateOrientation(T& s, T& i, T& j, T& k, T wx, T wy, T wz, T dt, T driftTolerance)
+		{
+			const T halfDt = dt / 2;
+			const T halfAngleSq = (wx * wx + wy * wy + wz * wz) * halfDt * halfDt;
+			const T halfAngle = std::sqrt(halfAngleSq);
+			const bool small = halfAngle < SmallAngle;
+			//sin(h) / h and cos(h), from the series near 0 so there is no division by 0.
+			const T sinc = small ? 1 - halfAngleSq / 6 + halfAngleSq * halfAngleSq / 120 : std::sin(halfAngle) / (small ? 1 : halfAngle);
+			const T cosine = small ? 1 - halfAngleSq / 2 + halfAngleSq * halfAngleSq / 24 : std::cos(halfAngle);
+			const T scale = sinc * halfDt;
+			const T dx = wx * scale, dy = wy * scale, dz = wz * scale;
+
+			T rs = cosine * s - dx * i - dy * j - dz * k;
+			T ri = cosine * i + dx * s + dy * k - dz * j;
+			T rj = cosine * j - dx * k + dy * s + dz * i;
+			T rk = cosine * k + dx * j - dy * i + dz * s;
+
+			const T lengthSq = rs * rs + ri * ri + rj * rj + rk * rk;
+			const T correction = std::abs(1 - lengthSq) > driftTolerance ? (3 - lengthSq) / 2 : 1;
+			s = rs * correction;
+			i = ri * correction;
+			j = rj * correction;
+			k = rk * correction;
+		}
+		//Integrates the orientations by the world-space angular velocities over dt, see IntegrateOrientation. The orientations must be of unit length.
+		//Processes min(orientations.size(), angularVelocities.size()) orientations.
+		static void IntegrateOrientations(std::span<Quaternion> orientations, std::span<const Vector3<T>> angularVelocities, T dt, T driftTolerance,
+			ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			const size_t count = std::min(orientations.size(), angularVelocities.size());
+			Parallel::For(policy, count, Parallel::GetChunkSize(count, 4096), [&](size_t begin, size_t end)
+			{
+				for (size_t idx = begin; idx < end; idx++)
+				{
+					Quaternion& q = orientations[idx];
+					T s = static_cast<T>(q.s), i = static_cast<T>(q.i), j = static_cast<T>(q.j), k = static_cast<T>(q.k);
+					const Vector3<T>& w = angularVelocities[idx];
+					IntegrateOrientation(s, i, j, k, w.x, w.y, w.z, dt, driftTolerance);
+					q = Quaternion(s, i, j, k);
+				}
+			});
+		}
+
+		//Constructs an empty RigidBodies. The default drift tolerance is a few hundred steps of rounding error in T.
+		RigidBodies()
+			: m_DriftTolerance(std::numeric_limits<T>::epsilon() * 128) {}
+
+		//Destructs the RigidBodies.
+		~RigidBodies() {}
+
+		//Adds a body at rest and returns its index. An inverse mass of 0 makes the body static; the inverse inertia is in body space.
+		uint32_t Add(const Vector3<T>& position, const Quaternion& orientation, T inverseMass, const Matrix3<T>& inverseInertia)
+		{
+			const uint32_t index = static_cast<uint32_t>(m_InverseMass.size());
+			for (std::vector<T>* component : { &m_PositionX, &m_PositionY, &m_PositionZ, &m_OrientationS, &m_OrientationI, &m_OrientationJ, &m_OrientationK,
+				&m_LinearVelocityX, &m_LinearVelocityY, &m_LinearVelocityZ, &m_AngularVelocityX, &m_AngularVelocityY, &m_AngularVelocityZ,
+				&m_ForceX, &m_ForceY, &m_ForceZ, &m_TorqueX, &m_TorqueY, &m_TorqueZ })
+				component->push_back(0);
+			m_InverseMass.push_back(inverseMass);
+			m_InverseInertia.push_back(inverseInertia);
+			SetPosition(index, position);
+			SetOrientation(index, orientation);
+			return index;
+		}
+		//Removes every body.
+		void Clear()
+		{
+			for (std::vector<T>* component : { &m_PositionX, &m_PositionY, &m_PositionZ, &m_OrientationS, &m_OrientationI, &m_OrientationJ, &m_OrientationK,
+				&m_LinearVelocityX, &m_LinearVelocityY, &m_LinearVelocityZ, &m_AngularVelocityX, &m_AngularVelocityY, &m_AngularVelocityZ,
+				&m_ForceX, &m_ForceY, &m_ForceZ, &m_TorqueX, &m_TorqueY, &m_TorqueZ, &m_InverseMass })
+				component->clear();
+			m_InverseInertia.clear();
+		}
+
+		inline size_t GetCount() const { return m_InverseMass.size(); }
+		inline T GetDriftTolerance() const { return m_DriftTolerance; }
+		inline void SetDriftTolerance(T tolerance) { m_DriftTolerance = tolerance; }
+
+		inline Vector3<T> GetPosition(uint32_t index) const { return Vector3<T>(m_PositionX[index], m_PositionY[index], m_PositionZ[index]); }
+		inline void SetPosition(uint32_t index, const Vector3<T>& position)
+		{
+			m_PositionX[index] = position.x;
+			m_PositionY[index] = position.y;
+			m_PositionZ[index] = position.z;
+		}
+		inline Quaternion GetOrientation(uint32_t index) const { return Quaternion(m_OrientationS[index], m_OrientationI[index], m_OrientationJ[index], m_OrientationK[index]); }
+		//Sets the orientation, normalised.
+		inline void SetOrientation(uint32_t index, const Quaternion& orientation)
+		{
+			const Quaternion q = Quaternion::Normalise(orientation);
+			m_OrientationS[index] = static_cast<T>(q.s);
+			m_OrientationI[index] = static_cast<T>(q.i);
+			m_OrientationJ[index] = static_cast<T>(q.j);
+			m_OrientationK[index] = static_cast<T>(q.k);
+		}
+		inline Vector3<T> GetLinearVelocity(uint32_t index) const { return Vector3<T>(m_LinearVelocityX[index], m_LinearVelocityY[index], m_LinearVelocityZ[index]); }
+		inline void SetLinearVelocity(uint32_t index, const Vector3<T>& velocity)
+		{
+			m_LinearVelocityX[index] = velocity.x;
+			m_LinearVelocityY[index] = velocity.y;
+			m_LinearVelocityZ[index] = velocity.z;
+		}
+		//Returns the angular velocity in world space.
+		inline Vector3<T> GetAngularVelocity(uint32_t index) const { return Vector3<T>(m_AngularVelocityX[index], m_AngularVelocityY[index], m_AngularVelocityZ[index]); }
+		//Sets the angular velocity in world space.
+		inline void SetAngularVelocity(uint32_t index, const Vector3<T>& velocity)
+		{
+			m_AngularVelocityX[index] = velocity.x;
+			m_AngularVelocityY[index] = velocity.y;
+			m_AngularVelocityZ[index] = velocity.z;
+		}
+		inline T GetInverseMass(uint32_t index) const { return m_InverseMass[index]; }
+		inline void SetInverseMass(uint32_t index, T inverseMass) { m_InverseMass[index] = inverseMass; }
+		//Returns the inverse inertia tensor in body space.
+		inline const Matrix3<T>& GetInverseInertia(uint32_t index) const { return m_InverseInertia[index]; }
+		inline void SetInverseInertia(uint32_t index, const Matrix3<T>& inverseInertia) { m_InverseInertia[index] = inverseInertia; }
+		//Returns the inverse inertia tensor in world space, R * I^-1 * R^T with R the rotation of the orientation.
+		Matrix3<T> GetWorldInverseInertia(uint32_t index) const
+		{
+			const T s = m_OrientationS[index], i = m_OrientationI[index], j = m_OrientationJ[index], k = m_OrientationK[index];
+			const Matrix3<T> rotation(1 - 2 * (j * j + k * k), 2 * (i * j - s * k), 2 * (i * k + s * j),
+				2 * (i * j + s * k), 1 - 2 * (i * i + k * k), 2 * (j * k - s * i),
+				2 * (i * k - s * j), 2 * (j * k + s * i), 1 - 2 * (i * i + j * j));
+			return rotation * m_InverseInertia[index] * Matrix3<T>::Transpose(rotation);
+		}
+
+		//Adds a world-space force through the center of mass, applied by the next Integrate.
+		inline void AddForce(uint32_t index, const Vector3<T>& force)
+		{
+			m_ForceX[index] += force.x;
+			m_ForceY[index] += force.y;
+			m_ForceZ[index] += force.z;
+		}
+		//Adds a world-space torque, applied by the next Integrate.
+		inline void AddTorque(uint32_t index, const Vector3<T>& torque)
+		{
+			m_TorqueX[index] += torque.x;
+			m_TorqueY[index] += torque.y;
+			m_TorqueZ[index] += torque.z;
+		}
+		//Adds a world-space force applied at a world-space point, as a force and the torque about the center of mass.
+		void AddForceAtPoint(uint32_t index, const Vector3<T>& force, const Vector3<T>& point)
+		{
+			const T rx = point.x - m_PositionX[index], ry = point.y - m_PositionY[index], rz = point.z - m_PositionZ[index];
+			AddForce(index, force);
+			AddTorque(index, Vector3<T>(ry * force.z - rz * force.y, rz * force.x - rx * force.z, rx * force.y - ry * force.x));
+		}
+
+		//Advances every body by dt with semi-implicit (symplectic) Euler: the velocities are updated from the accumulated forces and
+		//torques and gravity, then the position and orientation from the new velocities. Static bodies (inverse mass 0) do not fall.
+		//The gyroscopic term is not included. The accumulated forces and torques are cleared.
+		void Integrate(T dt, const Vector3<T>& gravity, ExecutionPolicy policy = ExecutionPolicy::ParallelSimd)
+		{
+			const size_t count = GetCount();
+			const T tolerance = m_DriftTolerance;
+			Parallel::For(policy, count, Parallel::GetChunkSize(count, 4096), [&](size_t begin, size_t end)
+			{
+				for (size_t idx = begin; idx < end; idx++)
+				{
+					const T inverseMass = m_InverseMass[idx];
+					const T gravityScale = inverseMass > 0 ? dt : 0;
+					const T vx = m_LinearVelocityX[idx] + m_ForceX[idx] * inverseMass * dt + gravity.x * gravityScale;
+					const T vy = m_LinearVelocityY[idx] + m_ForceY[idx] * inverseMass * dt + gravity.y * gravityScale;
+					const T vz = m_LinearVelocityZ[idx] + m_ForceZ[idx] * inverseMass * dt + gravity.z * gravityScale;
+					m_LinearVelocityX[idx] = vx;
+					m_LinearVelocityY[idx] = vy;
+					m_LinearVelocityZ[idx] = vz;
+					m_PositionX[idx] += vx * dt;
+					m_PositionY[idx] += vy * dt;
+					m_PositionZ[idx] += vz * dt;
+
+					//Angular acceleration R * I^-1 * R^T * torque, rotating the torque into body space and back rather than building the world tensor.
+					T s = m_OrientationS[idx], i = m_OrientationI[idx], j = m_OrientationJ[idx], k = m_OrientationK[idx];
+					T tx = m_TorqueX[idx], ty = m_TorqueY[idx], tz = m_TorqueZ[idx];
+					Rotate(s, i, j, k, tx, ty, tz, true);
+					const Matrix3<T>& inertia = m_InverseInertia[idx];
+					T ax = inertia.a * tx + inertia.b * ty + inertia.c * tz;
+					T ay = inertia.d * tx + inertia.e * ty + inertia.f * tz;
+					T az = inertia.g * tx + inertia.h * ty + inertia.i * tz;
+					Rotate(s, i, j, k, ax, ay, az, false);
+					const T wx = m_AngularVelocityX[idx] + ax * dt;
+					const T wy = m_AngularVelocityY[idx] + ay * dt;
+					const T wz = m_AngularVelocityZ[idx] + az * dt;
+					m_AngularVelocityX[idx] = wx;
+					m_AngularVelocityY[idx] = wy;
+					m_AngularVelocityZ[idx] = wz;
+
+					IntegrateOrientation(s, i, j, k, wx, wy, wz, dt, tolerance);
+					m_OrientationS[idx] = s;
+					m_OrientationI[idx] = i;
+					m_OrientationJ[idx] = j;
+					m_OrientationK[idx] = k;
+
+					m_ForceX[idx] = m_ForceY[idx] = m_ForceZ[idx] = 0;
+					m_TorqueX[idx] = m_TorqueY[idx] = m_TorqueZ[idx] = 0;
+				}
+			});
+		}
+
+		//Returns the largest |1 - |q|^2| of the orientations, the drift not yet corrected.
+		T GetMaxDrift() const
+		{
+			T drift = 0;
+			for (size_t idx = 0; idx < GetCount(); idx++)
+			{
+				const T lengthSq = m_OrientationS[idx] * m_OrientationS[idx] + m_OrientationI[idx] * m_OrientationI[idx] +
+					m_OrientationJ[idx] * m_OrientationJ[idx] + m_OrientationK[idx] * m_OrientationK[idx];
+				drift = std::max(drift, std::abs(1 - lengthSq));
+			}
+			return drift;
+		}
+	};
+
+	typedef RigidBodies<float> floatRigidBodies;
+	typedef RigidBodies<double> doubleRigidBodies;
+}
@@ -1,10 +1,11 @@
 #pragma once
 #include "../mars_common.h"
+#include "../Other/Instrumentation.h"
 
 namespace mars
 {
+	template<typename T> class Vector3;
 	template<typename T> class Vector4;
-	template<typename T> class Matrix4;
 
 	class Quaternion
 	{
@@ -21,6 +22,7 @@ namespace mars
 		template<typename T>
 		Quaternion(double angle, const Vector3<T>& axis)
 		{
+			MARS_INSTRUMENT(QuaternionFromAxisAngle);
 			Vector3<double> scaledAxis = Vector3(axis.x, axis.y, axis.z);
 			scaledAxis *= sin(angle / 2.0);
 
@@ -80,6 +82,7 @@ namespace mars
 		//Normalises the input object.
 		static Quaternion Normalise(const Quaternion& other)
 		{
+			MARS_INSTRUMENT(QuaternionNormalise);
 			Quaternion temp = other;
 			double length = sqrt(temp.s * temp.s + temp.i * temp.i + temp.j * temp.j + temp.k * temp.k);
 			if (length > 0.0)
@@ -89,6 +92,8 @@ namespace mars
 				temp.j /= length;
 				temp.k /= length;
 			}
+			else
+				MARS_INSTRUMENT_EVENT(ZeroLengthNormalise);
 
 			return temp;
 		}
@@ -96,6 +101,7 @@ namespace mars
 		//Spherically-Linearly interpolate between two Quaternions.
 		static Quaternion Slerp(const Quaternion& start, const Quaternion& end, double t)
 		{
+			MARS_INSTRUMENT(QuaternionSlerp);
 			//https://www.euclideanspace.com/maths/algebra/realNormedAlgebra/quaternions/slerp/index.htm
 
 			Quaternion q_start = Quaternion::Normalise(start);
@@ -116,6 +122,8 @@ namespace mars
 			double a = sin((1.0 - t) * theta);
 			double b = sin(t * theta);
 			double c = sin(theta);
+			if (c == 0.0)
+				MARS_INSTRUMENT_EVENT(DegenerateSlerp);
 
 			double s = q_start.s * (a / c) + q_end.s * (b / c);
 			double i = q_start.i * (a / c) + q_end.i * (b / c);
@@ -165,8 +173,8 @@ namespace mars
 				0, 0, 0, 1);
 		}
 		//Converts the input object to a new Quaternion.
-		template<typename T>
-		static Quaternion FromRotationMatrix4(const Matrix4<T>& input)
+		template<typename T, StorageOrder O>
+		static Quaternion FromRotationMatrix4(const Matrix4<T, O>& input)
 		{
 			Quaternion q;
 			const double& a = static_cast<double>(input.a);
@@ -0,0 +1,256 @@
+#pragma once
+#include "../mars_common.h"
+
+namespace mars
+{
+	//Mixes a 64-bit value; used to seed the generator lanes and to derive per-dimension scrambling seeds.
+	inline uint64_t SplitMix64(uint64_t& state)
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	//Converts the upper 24 bits of a 32-bit value to a float in [0, 1).
+	inline float UIntToUnitFloat(uint32_t x)
+	{
+		return static_cast<float>(x >> 8) * (1.0f / 16777216.0f);
+	}
+
+	//xoshiro128+ generator running Lanes independent streams in SoA state, so each step is a few lane-wise shifts and xors.
+	//https://prng.di.unimi.it/
+	template<size_t Lanes = 8>
+	class Xoshiro128Plus
+	{
+	private:
+		uint32_t m_State[4][Lanes];
+
+		static inline uint32_t Rotl(uint32_t x, int k)
+		{
+			return (x << k) | (x >> (32 - k));
+		}
+
+	public:
+		//Constructs a Xoshiro128Plus from the seed.
+		explicit Xoshiro128Plus(uint64_t seed = 0)
+		{
+			Seed(seed);
+		}
+
+		//Seeds every lane from the seed via SplitMix64.
+		void Seed(uint64_t seed)
+		{
+			for (size_t lane = 0; lane < Lanes; lane++)
+			{
+				uint64_t a = SplitMix64(seed);
+				uint64_t b = SplitMix64(seed);
+				m_State[0][lane] = static_cast<uint32_t>(a);
+				m_State[1][lane] = static_cast<uint32_t>(a >> 32);
+				m_State[2][lane] = static_cast<uint32_t>(b);
+				m_State[3][lane] = static_cast<uint32_t>(b >> 32) | 1u;
+			}
+		}
+
+		//Generates one 32-bit value per lane.
+		void NextUInt(uint32_t output[Lanes])
+		{
+			for (size_t lane = 0; lane < Lanes; lane++)
+			{
+				const uint32_t result = m_State[0][lane] + m_State[3][lane];
+				const uint32_t t = m_State[1][lane] << 9;
+				m_State[2][lane] ^= m_State[0][lane];
+				m_State[3][lane] ^= m_State[1][lane];
+				m_State[1][lane] ^= m_State[2][lane];
+				m_State[0][lane] ^= m_State[3][lane];
+				m_State[2][lane] ^= t;
+				m_State[3][lane] = Rotl(m_State[3][lane], 11);
+				output[lane] = result;
+			}
+		}
+
+		//Generates one float in [0, 1) per lane.
+		void NextFloat(float output[Lanes])
+		{
+			uint32_t bits[Lanes];
+			NextUInt(bits);
+			for (size_t lane = 0; lane < Lanes; lane++)
+				output[lane] = UIntToUnitFloat(bits[lane]);
+		}
+
+		//Fills the output with floats in [0, 1).
+		void Fill(std::span<float> output)
+		{
+			float lanes[Lanes];
+			size_t idx = 0;
+			for (; idx + Lanes <= output.size(); idx += Lanes)
+				NextFloat(&output[idx]);
+			if (idx < output.size())
+			{
+				NextFloat(lanes);
+				std::copy(lanes, lanes + (output.size() - idx), output.begin() + idx);
+			}
+		}
+
+		static constexpr size_t GetLaneCount() { return Lanes; }
+	};
+
+	//PCG32 (XSH-RR) generator running Lanes independent streams in SoA state.
+	//https://www.pcg-random.org/
+	template<size_t Lanes = 8>
+	class PCG32
+	{
+	private:
+		static constexpr uint64_t Multiplier = 6364136223846793005ull;
+
+		uint64_t m_State[Lanes];
+		uint64_t m_Increment[Lanes];
+
+	public:
+		//Constructs a PCG32 from the seed.
+		explicit PCG32(uint64_t seed = 0)
+		{
+			Seed(seed);
+		}
+
+		//Seeds every lane with its own state and stream via SplitMix64.
+		void Seed(uint64_t seed)
+		{
+			for (size_t lane = 0; lane < Lanes; lane++)
+			{
+				m_Increment[lane] = (SplitMix64(seed) << 1u) | 1u;
+				m_State[lane] = SplitMix64(seed) + m_Increment[lane];
+			}
+		}
+
+		//Generates one 32-bit value per lane.
+		void NextUInt(uint32_t output[Lanes])
+		{
+			for (size_t lane = 0; lane < Lanes; lane++)
+			{
+				const uint64_t old = m_State[lane];
+				m_State[lane] = old * Multiplier + m_Increment[lane];
+				const uint32_t xorshifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+				const uint32_t rot = static_cast<uint32_t>(old >> 59u);
+				output[lane] = (xorshifted >> rot) | (xorshifted << ((32u - rot) & 31u));
+			}
+		}
+
+		//Generates one float in [0, 1) per lane.
+		void NextFloat(float output[Lanes])
+		{
+			uint32_t bits[Lanes];
+			NextUInt(bits);
+			for (size_t lane = 0; lane < Lanes; lane++)
+				output[lane] = UIntToUnitFloat(bits[lane]);
+		}
+
+		//Fills the output with floats in [0, 1).
+		void Fill(std::span<float> output)
+		{
+			float lanes[Lanes];
+			size_t idx = 0;
+			for (; idx + Lanes <= output.size(); idx += Lanes)
+				NextFloat(&output[idx]);
+			if (idx < output.size())
+			{
+				NextFloat(lanes);
+				std::copy(lanes, lanes + (output.size() - idx), output.begin() + idx);
+			}
+		}
+
+		static constexpr size_t GetLaneCount() { return Lanes; }
+	};
+
+	//Low-discrepancy sequences for quasi-Monte Carlo sampling.
+	class LowDiscrepancy
+	{
+	public:
+		//Reverses the bits of a 32-bit value.
+		static uint32_t ReverseBits(uint32_t x)
+		{
+			x = (x << 16) | (x >> 16);
+			x = ((x & 0x00FF00FFu) << 8) | ((x & 0xFF00FF00u) >> 8);
+			x = ((x & 0x0F0F0F0Fu) << 4) | ((x & 0xF0F0F0F0u) >> 4);
+			x = ((x & 0x33333333u) << 2) | ((x & 0xCCCCCCCCu) >> 2);
+			x = ((x & 0x55555555u) << 1) | ((x & 0xAAAAAAAAu) >> 1);
+			return x;
+		}
+
+		//Returns the radical inverse of the index in the base, i.e. the index-th element of the van der Corput sequence.
+		static float RadicalInverse(uint32_t base, uint64_t index)
+		{
+			if (base == 2)
+				return static_cast<float>(ReverseBits(static_cast<uint32_t>(index)) >> 8) * (1.0f / 16777216.0f);
+
+			const double invBase = 1.0 / static_cast<double>(base);
+			double invBaseN = 1.0;
+			uint64_t reversed = 0;
+			while (index)
+			{
+				uint64_t next = index / base;
+				reversed = reversed * base + (index - next * base);
+				invBaseN *= invBase;
+				index = next;
+			}
+			return std::min(static_cast<float>(static_cast<double>(reversed) * invBaseN), 0x1.fffffep-1f);
+		}
+
+		//Fills output with the Halton sequence of the prime base, starting at firstIndex. One call per dimension, e.g. bases 2, 3, 5, 7.
+		static void Halton(uint32_t base, uint64_t firstIndex, std::span<float> output)
+		{
+			for (size_t idx = 0; idx < output.size(); idx++)
+				output[idx] = RadicalInverse(base, firstIndex + idx);
+		}
+
+		//Returns the index-th point of the first two dimensions of the Sobol sequence, as 32-bit fixed point values.
+		static void Sobol2D(uint32_t index, uint32_t& x, uint32_t& y)
+		{
+			x = ReverseBits(index);
+			y = 0;
+			for (uint32_t v = 1u << 31; index; index >>= 1, v ^= v >> 1)
+			{
+				if (index & 1)
+					y ^= v;
+			}
+		}
+
+		//Laine-Karras style hash permutation, Owen scrambling when applied to bit-reversed values.
+		//https://psychopath.io/post/2021_01_30_building_a_better_lk_hash
+		static uint32_t LaineKarrasPermutation(uint32_t x, uint32_t seed)
+		{
+			x ^= x * 0x3d20adeau;
+			x += seed;
+			x *= (seed >> 16) | 1u;
+			x ^= x * 0x05526c56u;
+			x ^= x * 0x53a22864u;
+			return x;
+		}
+
+		//Nested uniform (Owen) scramble of a 32-bit fixed point value.
+		static uint32_t NestedUniformScramble(uint32_t x, uint32_t seed)
+		{
+			return ReverseBits(LaineKarrasPermutation(ReverseBits(x), seed));
+		}
+
+		//Fills x and y with the 2D Sobol sequence with Owen scrambling and a shuffled index, starting at firstIndex.
+		//Use a different seed per pair of dimensions for decorrelated higher-dimensional samples.
+		//https://jcgt.org/published/0009/04/01/
+		static void SobolOwen2D(uint32_t seed, uint32_t firstIndex, std::span<float> x, std::span<float> y)
+		{
+			uint64_t state = seed;
+			const uint32_t indexSeed = static_cast<uint32_t>(SplitMix64(state));
+			const uint32_t xSeed = static_cast<uint32_t>(SplitMix64(state));
+			const uint32_t ySeed = static_cast<uint32_t>(SplitMix64(state));
+
+			const size_t count = std::min(x.size(), y.size());
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				uint32_t sx, sy;
+				Sobol2D(NestedUniformScramble(firstIndex + static_cast<uint32_t>(idx), indexSeed), sx, sy);
+				x[idx] = UIntToUnitFloat(NestedUniformScramble(sx, xSeed));
+				y[idx] = UIntToUnitFloat(NestedUniformScramble(sy, ySeed));
+			}
+		}
+	};
+}
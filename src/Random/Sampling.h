@@ -0,0 +1,157 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector3.h"
+#include "../Vector/VectorSoA.h"
+#include "Random.h"
+
+namespace mars
+{
+	//Batched warps from uniform samples in [0, 1)^2 to common Monte Carlo domains, writing SoA output.
+	//Each warp takes its uniform inputs explicitly, so the same code serves pseudo-random and low-discrepancy samples;
+	//the generator overloads draw the uniforms a block at a time. Directions are in a z-up frame.
+	class Sampling
+	{
+	private:
+		static constexpr size_t BlockSize = 256;
+
+		//Draws blocks of (u1, u2) from the generator and passes each block to warp(offset, u1, u2).
+		template<typename Generator, typename WarpFunc>
+		static void ForEachBlock(Generator& rng, size_t count, WarpFunc&& warp)
+		{
+			float u1[BlockSize], u2[BlockSize];
+			for (size_t base = 0; base < count; base += BlockSize)
+			{
+				const size_t blockCount = std::min(BlockSize, count - base);
+				rng.Fill(std::span<float>(u1, blockCount));
+				rng.Fill(std::span<float>(u2, blockCount));
+				warp(base, std::span<const float>(u1, blockCount), std::span<const float>(u2, blockCount));
+			}
+		}
+
+		//Returns the number of samples that fit both the inputs and output from offset on.
+		static size_t GetSampleCount(std::span<const float> u1, std::span<const float> u2, size_t outputCount, size_t offset)
+		{
+			return std::min({ u1.size(), u2.size(), outputCount > offset ? outputCount - offset : size_t(0) });
+		}
+
+	public:
+		//Uniformly distributed directions on the unit sphere. Writes min(u1.size(), u2.size(), output.GetCount() - offset) samples to output starting at offset.
+		static void UniformSphere(std::span<const float> u1, std::span<const float> u2, float3SoA& output, size_t offset = 0)
+		{
+			const size_t count = GetSampleCount(u1, u2, output.GetCount(), offset);
+			float* x = output.GetComponent(0).data() + offset;
+			float* y = output.GetComponent(1).data() + offset;
+			float* z = output.GetComponent(2).data() + offset;
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				const float cosTheta = 1.0f - 2.0f * u1[idx];
+				const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+				const float phi = static_cast<float>(tau) * u2[idx];
+				x[idx] = sinTheta * std::cos(phi);
+				y[idx] = sinTheta * std::sin(phi);
+				z[idx] = cosTheta;
+			}
+		}
+
+		//Uniformly distributed directions on the z-up unit hemisphere.
+		static void UniformHemisphere(std::span<const float> u1, std::span<const float> u2, float3SoA& output, size_t offset = 0)
+		{
+			const size_t count = GetSampleCount(u1, u2, output.GetCount(), offset);
+			float* x = output.GetComponent(0).data() + offset;
+			float* y = output.GetComponent(1).data() + offset;
+			float* z = output.GetComponent(2).data() + offset;
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				const float cosTheta = u1[idx];
+				const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+				const float phi = static_cast<float>(tau) * u2[idx];
+				x[idx] = sinTheta * std::cos(phi);
+				y[idx] = sinTheta * std::sin(phi);
+				z[idx] = cosTheta;
+			}
+		}
+
+		//Cosine-weighted directions on the z-up unit hemisphere (pdf = cos(theta) / pi).
+		static void CosineHemisphere(std::span<const float> u1, std::span<const float> u2, float3SoA& output, size_t offset = 0)
+		{
+			const size_t count = GetSampleCount(u1, u2, output.GetCount(), offset);
+			float* x = output.GetComponent(0).data() + offset;
+			float* y = output.GetComponent(1).data() + offset;
+			float* z = output.GetComponent(2).data() + offset;
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				const float r = std::sqrt(u1[idx]);
+				const float phi = static_cast<float>(tau) * u2[idx];
+				x[idx] = r * std::cos(phi);
+				y[idx] = r * std::sin(phi);
+				z[idx] = std::sqrt(std::max(0.0f, 1.0f - u1[idx]));
+			}
+		}
+
+		//Uniformly distributed points on the unit disk.
+		static void UniformDisk(std::span<const float> u1, std::span<const float> u2, float2SoA& output, size_t offset = 0)
+		{
+			const size_t count = GetSampleCount(u1, u2, output.GetCount(), offset);
+			float* x = output.GetComponent(0).data() + offset;
+			float* y = output.GetComponent(1).data() + offset;
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				const float r = std::sqrt(u1[idx]);
+				const float phi = static_cast<float>(tau) * u2[idx];
+				x[idx] = r * std::cos(phi);
+				y[idx] = r * std::sin(phi);
+			}
+		}
+
+		//Uniformly distributed points on the triangle (a, b, c).
+		static void UniformTriangle(std::span<const float> u1, std::span<const float> u2, const float3& a, const float3& b, const float3& c, float3SoA& output, size_t offset = 0)
+		{
+			const size_t count = GetSampleCount(u1, u2, output.GetCount(), offset);
+			float* x = output.GetComponent(0).data() + offset;
+			float* y = output.GetComponent(1).data() + offset;
+			float* z = output.GetComponent(2).data() + offset;
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				const float s = std::sqrt(u1[idx]);
+				const float b0 = 1.0f - s;
+				const float b1 = u2[idx] * s;
+				const float b2 = 1.0f - b0 - b1;
+				x[idx] = a.x * b0 + b.x * b1 + c.x * b2;
+				y[idx] = a.y * b0 + b.y * b1 + c.y * b2;
+				z[idx] = a.z * b0 + b.z * b1 + c.z * b2;
+			}
+		}
+
+		//Fills output with uniformly distributed directions on the unit sphere drawn from the generator.
+		template<typename Generator>
+		static void UniformSphere(Generator& rng, float3SoA& output)
+		{
+			ForEachBlock(rng, output.GetCount(), [&](size_t offset, std::span<const float> u1, std::span<const float> u2) { UniformSphere(u1, u2, output, offset); });
+		}
+		//Fills output with uniformly distributed directions on the z-up unit hemisphere drawn from the generator.
+		template<typename Generator>
+		static void UniformHemisphere(Generator& rng, float3SoA& output)
+		{
+			ForEachBlock(rng, output.GetCount(), [&](size_t offset, std::span<const float> u1, std::span<const float> u2) { UniformHemisphere(u1, u2, output, offset); });
+		}
+		//Fills output with cosine-weighted directions on the z-up unit hemisphere drawn from the generator.
+		template<typename Generator>
+		static void CosineHemisphere(Generator& rng, float3SoA& output)
+		{
+			ForEachBlock(rng, output.GetCount(), [&](size_t offset, std::span<const float> u1, std::span<const float> u2) { CosineHemisphere(u1, u2, output, offset); });
+		}
+		//Fills output with uniformly distributed points on the unit disk drawn from the generator.
+		template<typename Generator>
+		static void UniformDisk(Generator& rng, float2SoA& output)
+		{
+			ForEachBlock(rng, output.GetCount(), [&](size_t offset, std::span<const float> u1, std::span<const float> u2) { UniformDisk(u1, u2, output, offset); });
+		}
+		//Fills output with uniformly distributed points on the triangle (a, b, c) drawn from the generator.
+		template<typename Generator>
+		static void UniformTriangle(Generator& rng, const float3& a, const float3& b, const float3& c, float3SoA& output)
+		{
+			ForEachBlock(rng, output.GetCount(), [&](size_t offset, std::span<const float> u1, std::span<const float> u2) { UniformTriangle(u1, u2, a, b, c, output, offset); });
+		}
+	};
+}
@@ -0,0 +1,346 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Other/Parallel.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector3.h"
+#include <limits>
+#include <vector>
+
+namespace mars
+{
+	//k-d tree over 3D points in an implicit layout: the points are permuted so that every node is the median of its index range
+	//[begin, end), with the left subtree in [begin, mid) and the right in [mid + 1, end). Ranges of at most LeafSize points are leaves.
+	//Apart from the permutation, the tree holds one split axis per point and SoA copies of the points in tree order, so there is
+	//no per-node allocation. Build and the batched queries run across threads.
+	template<typename T>
+	class KdTree
+	{
+	public:
+		static constexpr uint32_t LeafSize = 8;
+		//Largest point count Build accepts. Point indices are 32-bit, with UINT32_MAX marking an empty result slot.
+		static constexpr size_t MaxCount = std::numeric_limits<uint32_t>::max();
+
+	private:
+		struct Range
+		{
+			uint32_t begin, end;
+		};
+
+		std::vector<uint32_t> m_Indices;
+		std::vector<uint8_t> m_SplitAxes;
+		std::vector<T> m_Coordinates[3];
+
+		//Picks the axis of largest spread of the range and partitions it around its median. Returns the split position.
+		uint32_t Split(std::span<const Vector3<T>> points, uint32_t begin, uint32_t end)
+		{
+			T minimum[3] = { std::numeric_limits<T>::max(), std::numeric_limits<T>::max(), std::numeric_limits<T>::max() };
+			T maximum[3] = { std::numeric_limits<T>::lowest(), std::numeric_limits<T>::lowest(), std::numeric_limits<T>::lowest() };
+			for (uint32_t idx = begin; idx < end; idx++)
+			{
+				const Vector3<T>& p = points[m_Indices[idx]];
+				minimum[0] = std::min(minimum[0], p.x);
+				maximum[0] = std::max(maximum[0], p.x);
+				minimum[1] = std::min(minimum[1], p.y);
+				maximum[1] = std::max(maximum[1], p.y);
+				minimum[2] = std::min(minimum[2], p.z);
+				maximum[2] = std::max(maximum[2], p.z);
+			}
+			uint8_t axis = 0;
+			if (maximum[1] - minimum[1] > maximum[axis] - minimum[axis])
+				axis = 1;
+			if (maximum[2] - minimum[2] > maximum[axis] - minimum[axis])
+				axis = 2;
+
+			const uint32_t mid = begin + (end - begin) / 2;
+			auto coordinate = [&](uint32_t index) { const Vector3<T>& p = points[index]; return axis == 0 ? p.x : axis == 1 ? p.y : p.z; };
+			std::nth_element(m_Indices.begin() + begin, m_Indices.begin() + mid, m_Indices.begin() + end,
+				[&](uint32_t a, uint32_t b) { return coordinate(a) < coordinate(b); });
+			m_SplitAxes[mid] = axis;
+			return mid;
+		}
+
+		void BuildRecursive(std::span<const Vector3<T>> points, uint32_t begin, uint32_t end)
+		{
+			if (end - begin <= LeafSize)
+				return;
+			const uint32_t mid = Split(points, begin, end);
+			BuildRecursive(points, begin, mid);
+			BuildRecursive(points, mid + 1, end);
+		}
+
+		inline T DistanceSq(uint32_t slot, const Vector3<T>& query) const
+		{
+			const T dx = m_Coordinates[0][slot] - query.x, dy = m_Coordinates[1][slot] - query.y, dz = m_Coordinates[2][slot] - query.z;
+			return dx * dx + dy * dy + dz * dz;
+		}
+
+		//Bounded max-heap of the k best candidates, held in the caller's output arrays.
+		struct NearestHeap
+		{
+			uint32_t* indices;
+			T* distancesSq;
+			size_t capacity;
+			size_t count;
+			T limitSq;
+
+			inline T GetWorst() const { return count < capacity ? limitSq : distancesSq[0]; }
+
+			void Push(uint32_t index, T distanceSq)
+			{
+				if (distanceSq > GetWorst())
+					return;
+				size_t hole;
+				if (count < capacity)
+				{
+					//Sift up from the new leaf.
+					hole = count++;
+					while (hole > 0 && distancesSq[(hole - 1) / 2] < distanceSq)
+					{
+						distancesSq[hole] = distancesSq[(hole - 1) / 2];
+						indices[hole] = indices[(hole - 1) / 2];
+						hole = (hole - 1) / 2;
+					}
+				}
+				else
+				{
+					//Replace the worst at the root and sift down.
+					hole = 0;
+					while (true)
+					{
+						size_t child = 2 * hole + 1;
+						if (child >= count)
+							break;
+						if (child + 1 < count && distancesSq[child + 1] > distancesSq[child])
+							child++;
+						if (distancesSq[child] <= distanceSq)
+							break;
+						distancesSq[hole] = distancesSq[child];
+						indices[hole] = indices[child];
+						hole = child;
+					}
+				}
+				distancesSq[hole] = distanceSq;
+				indices[hole] = index;
+			}
+
+			//Sorts the candidates by increasing distance.
+			void Sort()
+			{
+				for (size_t end = count; end > 1; end--)
+				{
+					const uint32_t index = indices[end - 1];
+					const T distanceSq = distancesSq[end - 1];
+					indices[end - 1] = indices[0];
+					distancesSq[end - 1] = distancesSq[0];
+					const size_t heapCount = end - 1;
+					size_t hole = 0;
+					while (true)
+					{
+						size_t child = 2 * hole + 1;
+						if (child >= heapCount)
+							break;
+						if (child + 1 < heapCount && distancesSq[child + 1] > distancesSq[child])
+							child++;
+						if (distancesSq[child] <= distanceSq)
+							break;
+						distancesSq[hole] = distancesSq[child];
+						indices[hole] = indices[child];
+						hole = child;
+					}
+					distancesSq[hole] = distanceSq;
+					indices[hole] = index;
+				}
+			}
+		};
+
+		void SearchNearest(uint32_t begin, uint32_t end, const Vector3<T>& query, NearestHeap& heap) const
+		{
+			if (end - begin <= LeafSize)
+			{
+				for (uint32_t slot = begin; slot < end; slot++)
+					heap.Push(m_Indices[slot], DistanceSq(slot, query));
+				return;
+			}
+			const uint32_t mid = begin + (end - begin) / 2;
+			const uint8_t axis = m_SplitAxes[mid];
+			const T diff = (axis == 0 ? query.x : axis == 1 ? query.y : query.z) - m_Coordinates[axis][mid];
+			heap.Push(m_Indices[mid], DistanceSq(mid, query));
+			if (diff < 0)
+			{
+				SearchNearest(begin, mid, query, heap);
+				if (diff * diff <= heap.GetWorst())
+					SearchNearest(mid + 1, end, query, heap);
+			}
+			else
+			{
+				SearchNearest(mid + 1, end, query, heap);
+				if (diff * diff <= heap.GetWorst())
+					SearchNearest(begin, mid, query, heap);
+			}
+		}
+
+		template<typename F>
+		void SearchRadius(uint32_t begin, uint32_t end, const Vector3<T>& query, T radiusSq, F&& func) const
+		{
+			if (end - begin <= LeafSize)
+			{
+				for (uint32_t slot = begin; slot < end; slot++)
+				{
+					const T distanceSq = DistanceSq(slot, query);
+					if (distanceSq <= radiusSq)
+						func(m_Indices[slot], distanceSq);
+				}
+				return;
+			}
+			const uint32_t mid = begin + (end - begin) / 2;
+			const uint8_t axis = m_SplitAxes[mid];
+			const T diff = (axis == 0 ? query.x : axis == 1 ? query.y : query.z) - m_Coordinates[axis][mid];
+			const T distanceSq = DistanceSq(mid, query);
+			if (distanceSq <= radiusSq)
+				func(m_Indices[mid], distanceSq);
+			if (diff <= 0 || diff * diff <= radiusSq)
+				SearchRadius(begin, mid, query, radiusSq, func);
+			if (diff >= 0 || diff * diff <= radiusSq)
+				SearchRadius(mid + 1, end, query, radiusSq, func);
+		}
+
+	public:
+		//Constructs an empty KdTree.
+		KdTree() {}
+		//Constructs a KdTree over the points.
+		explicit KdTree(std::span<const Vector3<T>> points)
+		{
+			Build(points);
+		}
+
+		//Destructs the KdTree.
+		~KdTree() {}
+
+		//Builds the tree over the points. The top levels split their ranges in parallel, then the subtrees are built in parallel.
+		//Returns false, leaving the tree empty, if there are more than MaxCount points.
+		bool Build(std::span<const Vector3<T>> points)
+		{
+			if (points.size() > MaxCount)
+			{
+				m_Indices.clear();
+				m_SplitAxes.clear();
+				for (std::vector<T>& coordinates : m_Coordinates)
+					coordinates.clear();
+				return false;
+			}
+			const uint32_t count = static_cast<uint32_t>(points.size());
+			m_Indices.resize(count);
+			m_SplitAxes.assign(count, 0);
+			for (uint32_t idx = 0; idx < count; idx++)
+				m_Indices[idx] = idx;
+
+			const size_t taskTarget = 4 * static_cast<size_t>(Parallel::GetThreadCount());
+			std::vector<Range> ranges = { { 0, count } };
+			while (ranges.size() < taskTarget)
+			{
+				std::vector<Range> next(2 * ranges.size());
+				Parallel::For(ranges.size(), 1, [&](size_t begin, size_t end)
+				{
+					for (size_t idx = begin; idx < end; idx++)
+					{
+						const Range range = ranges[idx];
+						if (range.end - range.begin <= LeafSize)
+						{
+							next[2 * idx] = range;
+							next[2 * idx + 1] = { range.end, range.end };
+							continue;
+						}
+						const uint32_t mid = Split(points, range.begin, range.end);
+						next[2 * idx] = { range.begin, mid };
+						next[2 * idx + 1] = { mid + 1, range.end };
+					}
+				});
+				bool split = false;
+				for (const Range& range : next)
+					split = split || range.end - range.begin > LeafSize;
+				ranges = std::move(next);
+				if (!split)
+					break;
+			}
+			Parallel::For(ranges.size(), 1, [&](size_t begin, size_t end)
+			{
+				for (size_t idx = begin; idx < end; idx++)
+					BuildRecursive(points, ranges[idx].begin, ranges[idx].end);
+			});
+
+			for (size_t axis = 0; axis < 3; axis++)
+				m_Coordinates[axis].resize(count);
+			Parallel::For(count, 4096, [&](size_t begin, size_t end)
+			{
+				for (size_t slot = begin; slot < end; slot++)
+				{
+					const Vector3<T>& p = points[m_Indices[slot]];
+					m_Coordinates[0][slot] = p.x;
+					m_Coordinates[1][slot] = p.y;
+					m_Coordinates[2][slot] = p.z;
+				}
+			});
+			return true;
+		}
+
+		//Finds the k nearest points to the query within maxDistance, writing their indices and squared distances in increasing order.
+		//Writes min(k, indices.size(), distancesSq.size()) entries at most and returns the number found.
+		size_t FindNearest(const Vector3<T>& query, size_t k, std::span<uint32_t> indices, std::span<T> distancesSq, T maxDistance = std::numeric_limits<T>::max()) const
+		{
+			NearestHeap heap = { indices.data(), distancesSq.data(), std::min({ k, indices.size(), distancesSq.size() }), 0,
+				maxDistance < std::sqrt(std::numeric_limits<T>::max()) ? maxDistance * maxDistance : std::numeric_limits<T>::max() };
+			if (heap.capacity == 0 || m_Indices.empty())
+				return 0;
+			SearchNearest(0, static_cast<uint32_t>(m_Indices.size()), query, heap);
+			heap.Sort();
+			return heap.count;
+		}
+		//Finds the k nearest points to every query, across threads. The results of query i are at [i * k, (i + 1) * k);
+		//slots without a point (fewer than k within maxDistance) get index UINT32_MAX and an infinite distance.
+		//Processes min(queries.size(), indices.size() / k, distancesSq.size() / k) queries.
+		void FindNearest(std::span<const Vector3<T>> queries, size_t k, std::span<uint32_t> indices, std::span<T> distancesSq, T maxDistance = std::numeric_limits<T>::max()) const
+		{
+			if (k == 0)
+				return;
+			const size_t count = std::min({ queries.size(), indices.size() / k, distancesSq.size() / k });
+			Parallel::For(count, 64, [&](size_t begin, size_t end)
+			{
+				for (size_t idx = begin; idx < end; idx++)
+				{
+					const size_t found = FindNearest(queries[idx], k, indices.subspan(idx * k, k), distancesSq.subspan(idx * k, k), maxDistance);
+					for (size_t slot = found; slot < k; slot++)
+					{
+						indices[idx * k + slot] = std::numeric_limits<uint32_t>::max();
+						distancesSq[idx * k + slot] = std::numeric_limits<T>::infinity();
+					}
+				}
+			});
+		}
+
+		//Calls func(index, distanceSq) for every point within the radius of the query.
+		template<typename F>
+		void ForEachInRadius(const Vector3<T>& query, T radius, F&& func) const
+		{
+			if (!m_Indices.empty())
+				SearchRadius(0, static_cast<uint32_t>(m_Indices.size()), query, radius * radius, func);
+		}
+		//Appends the indices of the points within the radius of the query to results. Returns the number appended.
+		size_t QueryRadius(const Vector3<T>& query, T radius, std::vector<uint32_t>& results) const
+		{
+			const size_t previous = results.size();
+			ForEachInRadius(query, radius, [&](uint32_t index, T) { results.push_back(index); });
+			return results.size() - previous;
+		}
+		//Finds the points within the radius of every query, across threads. The neighbours of query i are
+		//neighbours[offsets[i]] to neighbours[offsets[i + 1] - 1], in the same order as the single query.
+		void QueryRadius(std::span<const Vector3<T>> queries, T radius, std::vector<size_t>& offsets, std::vector<uint32_t>& neighbours) const
+		{
+			Parallel::Gather(queries.size(), 256, offsets, neighbours, [&](size_t idx, std::vector<uint32_t>& results) { return QueryRadius(queries[idx], radius, results); });
+		}
+
+		inline size_t GetCount() const { return m_Indices.size(); }
+	};
+
+	typedef KdTree<float> floatKdTree;
+	typedef KdTree<double> doubleKdTree;
+}
@@ -0,0 +1,231 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Other/Parallel.h"
+#include "../Quaternion/Quaternion.h"
+#include "../Vector/Vector3.h"
+#include <atomic>
+#include <vector>
+
+namespace mars
+{
+	//Uniform grid of cubic cells over float3 points, with the int3 cell coordinates hashed into a fixed-size bucket table.
+	//Build is a counting sort: the bucket of every point is counted with atomics, a prefix sum gives the bucket ranges, and
+	//the points are scattered into one flat array. Points within a bucket are kept in index order, so the layout does not
+	//depend on the thread count. Sorted copies of the positions are kept for cache-coherent queries.
+	class SpatialHashGrid
+	{
+	public:
+		//Largest point count Build accepts: the bucket table of twice the count must be indexable by the 32-bit hash and offsets.
+		static constexpr size_t MaxCount = size_t(1) << 31;
+
+	private:
+		static constexpr size_t ChunkSize = 4096;
+
+		float m_CellSize;
+		float m_InvCellSize;
+		uint32_t m_BucketMask;
+		std::vector<uint32_t> m_BucketStart;
+		std::vector<uint32_t> m_SortedIndices;
+		std::vector<float> m_SortedX, m_SortedY, m_SortedZ;
+
+		//Calls func(bucket) once for every distinct bucket overlapped by the cells in [minimum, maximum].
+		template<typename F>
+		void ForEachBucket(const int3& minimum, const int3& maximum, F&& func) const
+		{
+			constexpr size_t InlineCapacity = 125;
+			uint32_t inlineBuckets[InlineCapacity];
+			std::vector<uint32_t> heapBuckets;
+			const size_t cellCount = static_cast<size_t>(maximum.x - minimum.x + 1) * (maximum.y - minimum.y + 1) * (maximum.z - minimum.z + 1);
+			uint32_t* buckets = inlineBuckets;
+			if (cellCount > InlineCapacity)
+			{
+				heapBuckets.resize(cellCount);
+				buckets = heapBuckets.data();
+			}
+
+			size_t count = 0;
+			for (int32_t z = minimum.z; z <= maximum.z; z++)
+			{
+				for (int32_t y = minimum.y; y <= maximum.y; y++)
+				{
+					for (int32_t x = minimum.x; x <= maximum.x; x++)
+						buckets[count++] = HashCell(int3(x, y, z));
+				}
+			}
+			//Several cells can share a bucket; visit each bucket once so no point is reported twice.
+			std::sort(buckets, buckets + count);
+			const uint32_t* end = std::unique(buckets, buckets + count);
+			for (const uint32_t* bucket = buckets; bucket != end; bucket++)
+				func(*bucket);
+		}
+
+	public:
+		//Constructs a SpatialHashGrid with the cell size, usually the query radius.
+		explicit SpatialHashGrid(float cellSize = 1.0f)
+			: m_CellSize(cellSize), m_InvCellSize(1.0f / cellSize), m_BucketMask(0) {}
+
+		//Destructs the SpatialHashGrid.
+		~SpatialHashGrid() {}
+
+		//Returns the cell containing the position.
+		int3 GetCell(const float3& position) const
+		{
+			return int3(static_cast<int32_t>(std::floor(position.x * m_InvCellSize)),
+				static_cast<int32_t>(std::floor(position.y * m_InvCellSize)),
+				static_cast<int32_t>(std::floor(position.z * m_InvCellSize)));
+		}
+		//Returns the bucket of the cell (Teschner et al. spatial hash).
+		uint32_t HashCell(const int3& cell) const
+		{
+			return ((static_cast<uint32_t>(cell.x) * 73856093u) ^ (static_cast<uint32_t>(cell.y) * 19349663u) ^ (static_cast<uint32_t>(cell.z) * 83492791u)) & m_BucketMask;
+		}
+
+		//Builds the grid over the positions, across threads. The bucket table has the next power of two of at least twice the point count.
+		//Returns false, leaving the grid empty, if there are more than MaxCount positions.
+		bool Build(std::span<const float3> positions)
+		{
+			const size_t count = positions.size();
+			if (count > MaxCount)
+			{
+				m_BucketMask = 0;
+				m_BucketStart.clear();
+				m_SortedIndices.clear();
+				m_SortedX.clear();
+				m_SortedY.clear();
+				m_SortedZ.clear();
+				return false;
+			}
+			size_t bucketCount = 1;
+			while (bucketCount < 2 * count)
+				bucketCount <<= 1;
+			m_BucketMask = static_cast<uint32_t>(bucketCount - 1);
+
+			//Count the points per bucket, remembering each point's bucket.
+			std::vector<uint32_t> pointBuckets(count);
+			std::vector<uint32_t> bucketCounts(bucketCount, 0);
+			Parallel::For(count, ChunkSize, [&](size_t begin, size_t end)
+			{
+				for (size_t idx = begin; idx < end; idx++)
+				{
+					const uint32_t bucket = HashCell(GetCell(positions[idx]));
+					pointBuckets[idx] = bucket;
+					std::atomic_ref<uint32_t>(bucketCounts[bucket]).fetch_add(1, std::memory_order_relaxed);
+				}
+			});
+
+			//Exclusive prefix sum: per-chunk totals, a scan over the chunks, then the scan within each chunk.
+			m_BucketStart.assign(bucketCount + 1, 0);
+			const size_t chunkCount = (bucketCount + ChunkSize - 1) / ChunkSize;
+			std::vector<uint32_t> chunkOffsets(chunkCount + 1, 0);
+			Parallel::For(chunkCount, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t chunk = begin; chunk < end; chunk++)
+				{
+					uint32_t sum = 0;
+					for (size_t bucket = chunk * ChunkSize; bucket < std::min<size_t>((chunk + 1) * ChunkSize, bucketCount); bucket++)
+						sum += bucketCounts[bucket];
+					chunkOffsets[chunk + 1] = sum;
+				}
+			});
+			for (size_t chunk = 0; chunk < chunkCount; chunk++)
+				chunkOffsets[chunk + 1] += chunkOffsets[chunk];
+			Parallel::For(chunkCount, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t chunk = begin; chunk < end; chunk++)
+				{
+					uint32_t sum = chunkOffsets[chunk];
+					for (size_t bucket = chunk * ChunkSize; bucket < std::min<size_t>((chunk + 1) * ChunkSize, bucketCount); bucket++)
+					{
+						m_BucketStart[bucket] = sum;
+						sum += bucketCounts[bucket];
+					}
+				}
+			});
+			m_BucketStart[bucketCount] = static_cast<uint32_t>(count);
+
+			//Scatter, reusing the counts as cursors, then restore index order within each bucket.
+			m_SortedIndices.resize(count);
+			Parallel::For(count, ChunkSize, [&](size_t begin, size_t end)
+			{
+				for (size_t idx = begin; idx < end; idx++)
+				{
+					const uint32_t bucket = pointBuckets[idx];
+					const uint32_t slot = std::atomic_ref<uint32_t>(bucketCounts[bucket]).fetch_sub(1, std::memory_order_relaxed) - 1;
+					m_SortedIndices[m_BucketStart[bucket] + slot] = static_cast<uint32_t>(idx);
+				}
+			});
+			Parallel::For(bucketCount, ChunkSize, [&](size_t begin, size_t end)
+			{
+				for (size_t bucket = begin; bucket < end; bucket++)
+					std::sort(m_SortedIndices.begin() + m_BucketStart[bucket], m_SortedIndices.begin() + m_BucketStart[bucket + 1]);
+			});
+
+			m_SortedX.resize(count);
+			m_SortedY.resize(count);
+			m_SortedZ.resize(count);
+			Parallel::For(count, ChunkSize, [&](size_t begin, size_t end)
+			{
+				for (size_t idx = begin; idx < end; idx++)
+				{
+					const float3& position = positions[m_SortedIndices[idx]];
+					m_SortedX[idx] = position.x;
+					m_SortedY[idx] = position.y;
+					m_SortedZ[idx] = position.z;
+				}
+			});
+			return true;
+		}
+
+		//Calls func(index, distanceSq) for every point within the radius of the center, where index is into the positions given to Build.
+		template<typename F>
+		void ForEachInRadius(const float3& center, float radius, F&& func) const
+		{
+			if (m_SortedIndices.empty())
+				return;
+			const float radiusSq = radius * radius;
+			const int3 minimum = GetCell(float3(center.x - radius, center.y - radius, center.z - radius));
+			const int3 maximum = GetCell(float3(center.x + radius, center.y + radius, center.z + radius));
+			ForEachBucket(minimum, maximum, [&](uint32_t bucket)
+			{
+				for (uint32_t slot = m_BucketStart[bucket]; slot < m_BucketStart[bucket + 1]; slot++)
+				{
+					const float dx = m_SortedX[slot] - center.x, dy = m_SortedY[slot] - center.y, dz = m_SortedZ[slot] - center.z;
+					const float distanceSq = dx * dx + dy * dy + dz * dz;
+					if (distanceSq <= radiusSq)
+						func(m_SortedIndices[slot], distanceSq);
+				}
+			});
+		}
+		//Appends the indices of the points within the radius of the center to results. Returns the number appended.
+		size_t QueryRadius(const float3& center, float radius, std::vector<uint32_t>& results) const
+		{
+			const size_t previous = results.size();
+			ForEachInRadius(center, radius, [&](uint32_t index, float) { results.push_back(index); });
+			return results.size() - previous;
+		}
+		//Finds the points within the radius of every center, across threads. The neighbours of center i are
+		//neighbours[offsets[i]] to neighbours[offsets[i + 1] - 1], in the same order as the single query.
+		void QueryRadius(std::span<const float3> centers, float radius, std::vector<size_t>& offsets, std::vector<uint32_t>& neighbours) const
+		{
+			Parallel::Gather(centers.size(), 256, offsets, neighbours, [&](size_t idx, std::vector<uint32_t>& results) { return QueryRadius(centers[idx], radius, results); });
+		}
+
+		//Writes the per-point input in cell order, output[i] = input[GetSortedIndices()[i]], across threads.
+		//Reordering the particle arrays this way and rebuilding keeps neighbours close in memory.
+		template<typename T>
+		void Reorder(std::span<const T> input, std::span<T> output) const
+		{
+			const size_t count = std::min({ input.size(), output.size(), m_SortedIndices.size() });
+			Parallel::For(count, ChunkSize, [&](size_t begin, size_t end)
+			{
+				for (size_t idx = begin; idx < end; idx++)
+					output[idx] = input[m_SortedIndices[idx]];
+			});
+		}
+
+		inline float GetCellSize() const { return m_CellSize; }
+		inline size_t GetCount() const { return m_SortedIndices.size(); }
+		//Returns the point indices in cell (bucket) order.
+		inline std::span<const uint32_t> GetSortedIndices() const { return m_SortedIndices; }
+	};
+}
@@ -0,0 +1,166 @@
+#pragma once
+#include "../mars_common.h"
+#include "../Other/Instrumentation.h"
+
+namespace mars
+{
+	template<typename T> class Vector2;
+	template<typename T> class Vector3;
+	template<typename T> class Vector4;
+
+	//Fixed-size vector of N components. All component-wise operations are unrolled at compile-time.
+	template<typename T, size_t N>
+	class Vector
+	{
+		static_assert(N > 0, "Vector must have at least one component.");
+
+	public:
+		T data[N];
+
+		//Constructs a Vector of 0.
+		Vector()
+			: data{} {}
+		//Constructs a Vector taking N components.
+		template<typename... Args> requires (sizeof...(Args) == N && N > 1)
+		Vector(Args... args)
+			: data{ static_cast<T>(args)... } {}
+		//Constructs a Vector where every component is the input.
+		explicit Vector(T value)
+		{
+			Unroll<N>([&](auto idx) { data[idx] = value; });
+		}
+		//Constructs a Vector from a Vector2.
+		Vector(const Vector2<T>& other) requires (N == 2)
+			: data{ other.x, other.y } {}
+		//Constructs a Vector from a Vector3.
+		Vector(const Vector3<T>& other) requires (N == 3)
+			: data{ other.x, other.y, other.z } {}
+		//Constructs a Vector from a Vector4.
+		Vector(const Vector4<T>& other) requires (N == 4)
+			: data{ other.x, other.y, other.z, other.w } {}
+
+		//Vector2 operator implicit cast.
+		operator Vector2<T>() const requires (N == 2) { return Vector2<T>(data[0], data[1]); }
+		//Vector3 operator implicit cast.
+		operator Vector3<T>() const requires (N == 3) { return Vector3<T>(data[0], data[1], data[2]); }
+		//Vector4 operator implicit cast.
+		operator Vector4<T>() const requires (N == 4) { return Vector4<T>(data[0], data[1], data[2], data[3]); }
+
+		//Returns the component at the index.
+		T& operator[](size_t index) { return data[index]; }
+		//Returns the component at the index.
+		const T& operator[](size_t index) const { return data[index]; }
+
+		//Takes the dot product of two Vectors.
+		template<std::floating_point U>
+		static U Dot(const Vector& a, const Vector& b)
+		{
+			T result = 0;
+			Unroll<N>([&](auto idx) { result += a.data[idx] * b.data[idx]; });
+			return static_cast<U>(result);
+		}
+
+		//Returns the length of the Vector.
+		template<std::floating_point U>
+		U Length() const
+		{
+			return static_cast<U>(sqrt(Dot<double>(*this, *this)));
+		}
+
+		//Normalise the current object.
+		Vector Normalise()
+		{
+			*this = Normalise(*this);
+			return *this;
+		}
+		//Normalise the input object and return a new Vector.
+		static Vector Normalise(const Vector& other)
+		{
+			MARS_INSTRUMENT(VectorNormalise);
+			double length = other.Length<double>();
+			if (length > 0.0)
+				return other * static_cast<T>(1.0 / length);
+			MARS_INSTRUMENT_EVENT(ZeroLengthNormalise);
+			return other;
+		}
+
+		//Adds two Vectors.
+		Vector operator+ (const Vector& other) const
+		{
+			Vector result;
+			Unroll<N>([&](auto idx) { result.data[idx] = data[idx] + other.data[idx]; });
+			return result;
+		}
+		//Adds a Vector to the current object.
+		Vector& operator+= (const Vector& other)
+		{
+			*this = *this + other;
+			return *this;
+		}
+		//Subtracts two Vectors.
+		Vector operator- (const Vector& other) const
+		{
+			Vector result;
+			Unroll<N>([&](auto idx) { result.data[idx] = data[idx] - other.data[idx]; });
+			return result;
+		}
+		//Subtracts a Vector from the current object.
+		Vector& operator-= (const Vector& other)
+		{
+			*this = *this - other;
+			return *this;
+		}
+		//Scales the Vector by the scaler a. The scaler go on the rhs of the object.
+		Vector operator* (T a) const
+		{
+			Vector result;
+			Unroll<N>([&](auto idx) { result.data[idx] = data[idx] * a; });
+			return result;
+		}
+		//Scales the current object by the scaler a. The scaler go on the rhs of the object.
+		Vector& operator*= (T a)
+		{
+			*this = *this * a;
+			return *this;
+		}
+		//Divides the Vector by the scaler a. The scaler go on the rhs of the object.
+		Vector operator/ (T a) const
+		{
+			Vector result;
+			Unroll<N>([&](auto idx) { result.data[idx] = data[idx] / a; });
+			return result;
+		}
+		//Divides the current object by the scaler a. The scaler go on the rhs of the object.
+		Vector& operator/= (T a)
+		{
+			*this = *this / a;
+			return *this;
+		}
+
+		//Compare the Vector with another Vector. If it's equal, it'll return true.
+		bool operator== (const Vector& other) const
+		{
+			bool result = true;
+			Unroll<N>([&](auto idx) { result = result && (data[idx] == other.data[idx]); });
+			return result;
+		}
+		//Compare the Vector with another Vector. If it's not equal, it'll return true.
+		bool operator!= (const Vector& other) const
+		{
+			return !(*this == other);
+		}
+
+		//Output stream operator.
+		friend std::ostream& operator<< (std::ostream& stream, const Vector& output)
+		{
+			SetOstream(stream);
+			for (size_t idx = 0; idx < N; idx++)
+				stream << output.data[idx] << (idx + 1 < N ? ", " : "");
+			ResetOstream(stream);
+			return stream;
+		}
+
+		inline const T* const GetData() const { return data; }
+		constexpr static inline size_t GetSize() { return sizeof(Vector); }
+	};
+}
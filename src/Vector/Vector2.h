@@ -1,5 +1,6 @@
 #pragma once
 #include "../mars_common.h"
+#include "../Other/Instrumentation.h"
 #include "../Conversion/Cartesian2DandPolarCoord.h"
 
 namespace mars
@@ -24,6 +25,8 @@ namespace mars
 		//Constructs a Vector2 from another Vector2.
 		Vector2(const Vector2& copy)
 			: x(copy.x), y(copy.y) {}
+		//Copies another Vector2 into the current object.
+		Vector2& operator=(const Vector2& copy) = default;
 		//Constructs a Vector2 from the struct CoordCartesian2D.
 		Vector2(const CoordCartesian2D& other)
 			: x(static_cast<T>(other.x)), y(static_cast<T>(other.y)) {}
@@ -57,11 +60,12 @@ namespace mars
 		//Normalise the input object and return a new Vector2.
 		static Vector2 Normalise(const Vector2& other)
 		{
+			MARS_INSTRUMENT(VectorNormalise);
 			double length = other.Length<double>();
 			if (length > 0.0)
 				return other * static_cast<T>(1.0 / length);
-			else
-				return other;
+			MARS_INSTRUMENT_EVENT(ZeroLengthNormalise);
+			return other;
 		}
 
 		//Returns the length of the Vector2.
@@ -1,5 +1,6 @@
 #pragma once
 #include "../mars_common.h"
+#include "../Other/Instrumentation.h"
 #include "../Conversion/Cartesian3DandSphericalCoord.h"
 
 namespace mars
@@ -26,6 +27,8 @@ namespace mars
 		//Constructs a Vector3 from another Vector3.
 		Vector3(const Vector3& copy)
 			: x(copy.x), y(copy.y), z(copy.z) {}
+		//Copies another Vector3 into the current object.
+		Vector3& operator=(const Vector3& copy) = default;
 		//Constructs a Vector3 from the struct CoordCartesian3D.
 		Vector3(const CoordCartesian3D& other)
 			: x(static_cast<T>(other.x)), y(static_cast<T>(other.y)), z(static_cast<T>(other.z)) {}
@@ -72,11 +75,12 @@ namespace mars
 		//Normalise the input object and return a new Vector3.
 		static Vector3 Normalise(const Vector3& other)
 		{
+			MARS_INSTRUMENT(VectorNormalise);
 			double length = other.Length<double>();
 			if (length > 0.0)
 				return other * static_cast<T>(1.0 / length);
-			else
-				return other;
+			MARS_INSTRUMENT_EVENT(ZeroLengthNormalise);
+			return other;
 		}
 
 		//Returns the length of the Vector3.
@@ -1,5 +1,6 @@
 #pragma once
 #include "../mars_common.h"
+#include "../Other/Instrumentation.h"
 
 namespace mars
 {
@@ -26,6 +27,8 @@ namespace mars
 		//Constructs a Vector4 from another Vector4.
 		Vector4(const Vector4& copy)
 			: x(copy.x), y(copy.y), z(copy.z), w(copy.w) {}
+		//Copies another Vector4 into the current object.
+		Vector4& operator=(const Vector4& copy) = default;
 		//Constructs a Vector4 from two Vector2 in the form of the first Vector2 go into x, y and the second Vector2 go into z, w.
 		Vector4(const Vector2<T>& a, const Vector2<T>& b)
 			: x(a.x), y(a.y), z(b.x), w(b.y) {}
@@ -57,11 +60,12 @@ namespace mars
 		//Normalise the input object and return a new Vector4.
 		static Vector4 Normalise(const Vector4& other)
 		{
+			MARS_INSTRUMENT(VectorNormalise);
 			double length = other.Length<double>();
 			if (length > 0.0)
 				return other * static_cast<T>(1.0 / length);
-			else
-				return other;
+			MARS_INSTRUMENT_EVENT(ZeroLengthNormalise);
+			return other;
 		}
 
 		//Returns the length of the Vector4.
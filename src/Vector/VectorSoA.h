@@ -0,0 +1,61 @@
+#pragma once
+#include "../mars_common.h"
+#include "Vector.h"
+#include <vector>
+
+namespace mars
+{
+	//Array of N-component vectors stored as N separate component arrays (structure of arrays), for batched kernels.
+	template<typename T, size_t N>
+	class VectorSoA
+	{
+	private:
+		std::vector<T> m_Components[N];
+
+	public:
+		//Constructs an empty VectorSoA.
+		VectorSoA() {}
+		//Constructs a VectorSoA of count vectors of 0.
+		explicit VectorSoA(size_t count)
+		{
+			Resize(count);
+		}
+
+		//Destructs the VectorSoA.
+		~VectorSoA() {}
+
+		//Resizes every component array to count.
+		void Resize(size_t count)
+		{
+			for (size_t c = 0; c < N; c++)
+				m_Components[c].resize(count);
+		}
+
+		//Returns the vector at the index.
+		Vector<T, N> Get(size_t index) const
+		{
+			Vector<T, N> result;
+			Unroll<N>([&](auto c) { result.data[c] = m_Components[c][index]; });
+			return result;
+		}
+		//Sets the vector at the index.
+		void Set(size_t index, const Vector<T, N>& value)
+		{
+			Unroll<N>([&](auto c) { m_Components[c][index] = value.data[c]; });
+		}
+
+		//Returns the array of the component c.
+		std::span<T> GetComponent(size_t c) { return m_Components[c]; }
+		//Returns the array of the component c.
+		std::span<const T> GetComponent(size_t c) const { return m_Components[c]; }
+
+		inline size_t GetCount() const { return m_Components[0].size(); }
+	};
+
+	typedef VectorSoA<float, 2> float2SoA;
+	typedef VectorSoA<double, 2> double2SoA;
+	typedef VectorSoA<float, 3> float3SoA;
+	typedef VectorSoA<double, 3> double3SoA;
+	typedef VectorSoA<float, 4> float4SoA;
+	typedef VectorSoA<double, 4> double4SoA;
+}
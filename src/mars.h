@@ -1,17 +1,55 @@
 #pragma once
 
+#include "Animation/AnimationClip.h"
+
 #include "Conversion/Cartesian2DandPolarCoord.h"
 #include "Conversion/Cartesian3DandSphericalCoord.h"
 #include "Conversion/ConvertDegAndRad.h"
 
+#include "Curve/Curve.h"
+
+#include "Geometry/AABB.h"
+#include "Geometry/OBB.h"
+#include "Geometry/Predicates.h"
+
+#include "Graphics/CameraRelative.h"
+#include "Graphics/ClusteredLights.h"
+#include "Graphics/OcclusionBuffer.h"
+#include "Graphics/ShadowCascades.h"
+
+#include "IO/BinaryFile.h"
+#include "IO/Text.h"
+
+#include "Layout/BufferLayout.h"
+
+#include "Matrix/Matrix.h"
 #include "Matrix/Matrix2.h"
 #include "Matrix/Matrix3.h"
 #include "Matrix/Matrix4.h"
+#include "Matrix/MatrixBlock.h"
+#include "Matrix/Decomposition.h"
+#include "Matrix/LinearSolver.h"
 
+#include "Mesh/MeshUtilities.h"
+
+#include "Noise/Noise.h"
+
+#include "Other/Instrumentation.h"
+#include "Other/Parallel.h"
 #include "Other/UtilityFinctions.h"
 
+#include "Physics/RigidBodies.h"
+
 #include "Quaternion/Quaternion.h"
 
+#include "Random/Random.h"
+#include "Random/Sampling.h"
+
+#include "Spatial/KdTree.h"
+#include "Spatial/SpatialHashGrid.h"
+
+#include "Vector/Vector.h"
 #include "Vector/Vector2.h"
 #include "Vector/Vector3.h"
 #include "Vector/Vector4.h"
+#include "Vector/VectorSoA.h"
@@ -5,6 +5,8 @@
 #include <cmath>
 #include <algorithm>
 #include <functional>
+#include <span>
+#include <utility>
 
 //Ostream Settings
 namespace mars
@@ -28,4 +30,34 @@ namespace mars
 	}
 }
 
+//Matrix Storage Order
+namespace mars
+{
+	//Order of the Matrix2/3/4 components in memory. RowMajor is the default; ColumnMajor matches the default GLSL/SPIR-V matrix layout,
+	//so the raw data can be uploaded without a transpose.
+	enum class StorageOrder : uint8_t
+	{
+		RowMajor,
+		ColumnMajor
+	};
+
+	template<typename T, StorageOrder O = StorageOrder::RowMajor> class Matrix2;
+	template<typename T, StorageOrder O = StorageOrder::RowMajor> class Matrix3;
+	template<typename T, StorageOrder O = StorageOrder::RowMajor> class Matrix4;
+}
+
+//Compile-time Helpers
+namespace mars
+{
+	//Calls func(std::integral_constant<size_t, I>) for I in [0, N), expanded at compile-time.
+	template<size_t N, typename F>
+	constexpr inline void Unroll(F&& func)
+	{
+		[&]<size_t... I>(std::index_sequence<I...>)
+		{
+			(func(std::integral_constant<size_t, I>{}), ...);
+		}(std::make_index_sequence<N>{});
+	}
+}
+
 #include "Conversion/ConvertDegAndRad.h"
@@ -0,0 +1,82 @@
+#include "mars.h"
+#include "TestCommon.h"
+#include <random>
+#include <vector>
+
+using namespace mars;
+
+//The froxel test as written before it was made branch-free: sphere against the AABB, and the cone against the bounding sphere
+//of the froxel with a square root.
+static bool ScalarTouches(const floatAABB& froxel, const float3& position, float radius, const float3& direction, float cosAngle, float sinAngle)
+{
+	const float dx = std::max({ froxel.minimum.x - position.x, 0.0f, position.x - froxel.maximum.x });
+	const float dy = std::max({ froxel.minimum.y - position.y, 0.0f, position.y - froxel.maximum.y });
+	const float dz = std::max({ froxel.minimum.z - position.z, 0.0f, position.z - froxel.maximum.z });
+	if (dx * dx + dy * dy + dz * dz > radius * radius)
+		return false;
+	if (cosAngle <= -1.0f)
+		return true;
+
+	const float3 center = froxel.GetCenter();
+	const float froxelRadius = froxel.GetHalfExtents().Length<float>();
+	const float vx = center.x - position.x, vy = center.y - position.y, vz = center.z - position.z;
+	const float along = vx * direction.x + vy * direction.y + vz * direction.z;
+	const float closest = cosAngle * std::sqrt(std::max(vx * vx + vy * vy + vz * vz - along * along, 0.0f)) - along * sinAngle;
+	return closest <= froxelRadius && along >= -froxelRadius;
+}
+
+//Spot lights up to 150 degrees, so cones wider than a half-space take the other side of the squared comparison.
+static void AssignMatchesScalarTest()
+{
+	const float zNear = 0.3f, zFar = 60.0f;
+	ClusteredLights clusters(8, 6, 12);
+	MARS_CHECK(clusters.Build(float4x4::Perspective(1.1, 1.6f, zNear, zFar, false, false), zNear, zFar));
+
+	std::mt19937 rng(17);
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+	std::vector<ClusterPointLight> pointLights(150);
+	std::vector<ClusterSpotLight> spotLights(250);
+	for (ClusterPointLight& light : pointLights)
+	{
+		light.position = float3(distribution(rng) * 60 - 30, distribution(rng) * 20 - 10, distribution(rng) * 70 - 5);
+		light.radius = 0.5f + distribution(rng) * 6;
+	}
+	for (ClusterSpotLight& light : spotLights)
+	{
+		light.position = float3(distribution(rng) * 60 - 30, distribution(rng) * 20 - 10, distribution(rng) * 70 - 5);
+		light.range = 1 + distribution(rng) * 12;
+		light.direction = float3::Normalise(float3(distribution(rng) - 0.5f, distribution(rng) - 0.5f, distribution(rng) - 0.5f));
+		light.angle = 0.05f + distribution(rng) * 2.55f;
+	}
+	clusters.Assign(float4x4::Identity(), std::span<const ClusterPointLight>(pointLights), std::span<const ClusterSpotLight>(spotLights));
+
+	size_t mismatches = 0, assigned = 0;
+	std::vector<uint32_t> expected;
+	for (size_t cluster = 0; cluster < clusters.GetClusterCount(); cluster++)
+	{
+		const floatAABB& froxel = clusters.GetFroxel(cluster);
+		expected.clear();
+		for (size_t idx = 0; idx < pointLights.size(); idx++)
+		{
+			if (ScalarTouches(froxel, pointLights[idx].position, pointLights[idx].radius, float3(0, 0, 1), -1.0f, 0.0f))
+				expected.push_back(static_cast<uint32_t>(idx));
+		}
+		for (size_t idx = 0; idx < spotLights.size(); idx++)
+		{
+			const ClusterSpotLight& light = spotLights[idx];
+			if (ScalarTouches(froxel, light.position, light.range, float3::Normalise(light.direction), std::cos(light.angle), std::sin(light.angle)))
+				expected.push_back(static_cast<uint32_t>(pointLights.size() + idx));
+		}
+		const std::span<const uint32_t> lights = clusters.GetLights(cluster);
+		mismatches += !std::equal(lights.begin(), lights.end(), expected.begin(), expected.end());
+		assigned += lights.size();
+	}
+	MARS_CHECK(mismatches == 0);
+	MARS_CHECK(assigned > 0);
+}
+
+int main()
+{
+	AssignMatchesScalarTest();
+	return MARS_TEST_RESULT();
+}
@@ -0,0 +1,126 @@
+#include "mars.h"
+#include "TestCommon.h"
+#include <random>
+#include <vector>
+
+using namespace mars;
+
+static void CheckNear(const float3x3& a, const float3x3& b, float tolerance)
+{
+	MARS_CHECK_NEAR(a.a, b.a, tolerance); MARS_CHECK_NEAR(a.b, b.b, tolerance); MARS_CHECK_NEAR(a.c, b.c, tolerance);
+	MARS_CHECK_NEAR(a.d, b.d, tolerance); MARS_CHECK_NEAR(a.e, b.e, tolerance); MARS_CHECK_NEAR(a.f, b.f, tolerance);
+	MARS_CHECK_NEAR(a.g, b.g, tolerance); MARS_CHECK_NEAR(a.h, b.h, tolerance); MARS_CHECK_NEAR(a.i, b.i, tolerance);
+}
+
+//21 matrices, so the last block of 8 lanes is only partly filled.
+static std::vector<float3x3> RandomMatrices()
+{
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> distribution(-2.0f, 2.0f);
+	std::vector<float3x3> result(21);
+	for (float3x3& m : result)
+		m = float3x3(distribution(rng), distribution(rng), distribution(rng), distribution(rng), distribution(rng), distribution(rng), distribution(rng), distribution(rng), distribution(rng));
+	result[3] = float3x3(0, 0, 0, 0, 0, 0, 0, 0, 0);
+	result[4] = float3x3(2, 0, 0, 0, -3, 0, 0, 0, 1);
+	return result;
+}
+
+static void BatchedSVDMatchesSingle()
+{
+	const std::vector<float3x3> inputs = RandomMatrices();
+	std::vector<SVD3<float>> outputs(inputs.size());
+	Decomposition::SVD(std::span<const float3x3>(inputs), std::span<SVD3<float>>(outputs));
+	for (size_t idx = 0; idx < inputs.size(); idx++)
+	{
+		const SVD3<float> single = Decomposition::SVD(inputs[idx]);
+		CheckNear(outputs[idx].U, single.U, 1e-6f);
+		CheckNear(outputs[idx].V, single.V, 1e-6f);
+		MARS_CHECK_NEAR(outputs[idx].singularValues.x, single.singularValues.x, 1e-6f);
+		MARS_CHECK_NEAR(outputs[idx].singularValues.y, single.singularValues.y, 1e-6f);
+		MARS_CHECK_NEAR(outputs[idx].singularValues.z, single.singularValues.z, 1e-6f);
+
+		const Vector3<float> sigma = single.singularValues;
+		CheckNear(single.U * float3x3(sigma.x, 0, 0, 0, sigma.y, 0, 0, 0, sigma.z) * float3x3::Transpose(single.V), inputs[idx], 1e-5f);
+	}
+}
+
+static void BatchedPolarMatchesSingle()
+{
+	const std::vector<float3x3> inputs = RandomMatrices();
+	std::vector<float3x3> rotations(inputs.size()), stretches(inputs.size());
+	Decomposition::Polar<16>(std::span<const float3x3>(inputs), std::span<float3x3>(rotations), std::span<float3x3>(stretches));
+	for (size_t idx = 0; idx < inputs.size(); idx++)
+	{
+		const Polar3<float> single = Decomposition::Polar(inputs[idx]);
+		CheckNear(rotations[idx], single.R, 1e-6f);
+		CheckNear(stretches[idx], single.S, 1e-6f);
+		CheckNear(rotations[idx] * stretches[idx], inputs[idx], 1e-5f);
+	}
+}
+
+static void BatchedSymmetricEigenMatchesSingle()
+{
+	std::vector<float3x3> inputs = RandomMatrices();
+	for (float3x3& m : inputs)
+		m = m * float3x3::Transpose(m);
+	std::vector<SymmetricEigen3<float>> outputs(inputs.size());
+	Decomposition::SymmetricEigen(std::span<const float3x3>(inputs), std::span<SymmetricEigen3<float>>(outputs));
+	for (size_t idx = 0; idx < inputs.size(); idx++)
+	{
+		const SymmetricEigen3<float> single = Decomposition::SymmetricEigen(inputs[idx]);
+		CheckNear(outputs[idx].eigenvectors, single.eigenvectors, 1e-6f);
+		MARS_CHECK_NEAR(outputs[idx].eigenvalues.x, single.eigenvalues.x, 1e-6f);
+		MARS_CHECK_NEAR(outputs[idx].eigenvalues.y, single.eigenvalues.y, 1e-6f);
+		MARS_CHECK_NEAR(outputs[idx].eigenvalues.z, single.eigenvalues.z, 1e-6f);
+	}
+}
+
+//1003 points far from the origin, so the last block is not a whole number of lanes.
+static void CovarianceMatchesTwoPass()
+{
+	std::mt19937 rng(11);
+	std::normal_distribution<float> distribution(0.0f, 1.0f);
+	std::vector<float3> points(1003);
+	for (float3& p : points)
+		p = float3(1000.0f + 3.0f * distribution(rng), -500.0f + distribution(rng), 0.5f * distribution(rng));
+
+	double mean[3] = {};
+	for (const float3& p : points)
+	{
+		mean[0] += p.x;
+		mean[1] += p.y;
+		mean[2] += p.z;
+	}
+	for (double& m : mean)
+		m /= static_cast<double>(points.size());
+	double expected[3][3] = {};
+	for (const float3& p : points)
+	{
+		const double d[3] = { p.x - mean[0], p.y - mean[1], p.z - mean[2] };
+		for (int r = 0; r < 3; r++)
+			for (int c = 0; c < 3; c++)
+				expected[r][c] += d[r] * d[c] / static_cast<double>(points.size());
+	}
+
+	const Covariance3<float> covariance = Covariance3<float>::Compute(std::span<const float3>(points));
+	const float3x3 matrix = covariance.GetMatrix();
+	MARS_CHECK(covariance.count == points.size());
+	MARS_CHECK_NEAR(covariance.mean.x, mean[0], 1e-3);
+	MARS_CHECK_NEAR(covariance.mean.y, mean[1], 1e-3);
+	MARS_CHECK_NEAR(covariance.mean.z, mean[2], 1e-3);
+	MARS_CHECK_NEAR(matrix.a, expected[0][0], 1e-3);
+	MARS_CHECK_NEAR(matrix.b, expected[0][1], 1e-3);
+	MARS_CHECK_NEAR(matrix.c, expected[0][2], 1e-3);
+	MARS_CHECK_NEAR(matrix.e, expected[1][1], 1e-3);
+	MARS_CHECK_NEAR(matrix.f, expected[1][2], 1e-3);
+	MARS_CHECK_NEAR(matrix.i, expected[2][2], 1e-3);
+}
+
+int main()
+{
+	BatchedSVDMatchesSingle();
+	BatchedPolarMatchesSingle();
+	BatchedSymmetricEigenMatchesSingle();
+	CovarianceMatchesTwoPass();
+	return MARS_TEST_RESULT();
+}
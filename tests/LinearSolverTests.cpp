@@ -0,0 +1,70 @@
+#include "mars.h"
+#include "TestCommon.h"
+#include <random>
+#include <vector>
+
+using namespace mars;
+
+static void CheckNear(const Vector<float, 4>& a, const Vector<float, 4>& b, float tolerance)
+{
+	for (size_t idx = 0; idx < 4; idx++)
+		MARS_CHECK_NEAR(a.data[idx], b.data[idx], tolerance);
+}
+
+//1003 systems, so the last block of 8 lanes is only partly filled. System 5 is singular.
+static void BatchedLUMatchesSingle()
+{
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::vector<float4x4> matrices(1003);
+	std::vector<float4> rhs(matrices.size()), solutions(matrices.size());
+	for (size_t idx = 0; idx < matrices.size(); idx++)
+	{
+		Matrix<float, 4, 4> m;
+		for (float& x : m.data)
+			x = distribution(rng);
+		matrices[idx] = m;
+		rhs[idx] = float4(distribution(rng), distribution(rng), distribution(rng), distribution(rng));
+	}
+	matrices[5] = float4x4();
+
+	const bool valid = LU<float, 4>::Solve(std::span<const float4x4>(matrices), std::span<const float4>(rhs), std::span<float4>(solutions));
+	MARS_CHECK(!valid);
+	for (size_t idx = 0; idx < matrices.size(); idx++)
+	{
+		const LU<float, 4> lu(matrices[idx]);
+		MARS_CHECK(lu.IsSingular() == (idx == 5));
+		CheckNear(Vector<float, 4>(solutions[idx]), lu.Solve(Vector<float, 4>(rhs[idx])), 1e-6f);
+	}
+}
+
+static void BatchedCholeskyMatchesSingle()
+{
+	const double3x3 spd(4, 12, -16, 12, 37, -43, -16, -43, 98);
+	std::vector<double3x3> matrices(17, spd);
+	std::vector<double3> rhs(matrices.size()), solutions(matrices.size());
+	for (size_t idx = 0; idx < matrices.size(); idx++)
+		rhs[idx] = double3(1.0, 2.0, static_cast<double>(idx));
+
+	MARS_CHECK((Cholesky<double, 3>::Solve(std::span<const double3x3>(matrices), std::span<const double3>(rhs), std::span<double3>(solutions))));
+	const Cholesky<double, 3> single(spd);
+	for (size_t idx = 0; idx < matrices.size(); idx++)
+	{
+		const Vector<double, 3> expected = single.Solve(Vector<double, 3>(rhs[idx]));
+		MARS_CHECK_NEAR(solutions[idx].x, expected.data[0], 1e-12);
+		MARS_CHECK_NEAR(solutions[idx].y, expected.data[1], 1e-12);
+		MARS_CHECK_NEAR(solutions[idx].z, expected.data[2], 1e-12);
+	}
+
+	//A matrix that is not positive definite gets a solution of 0 and makes the batch fail.
+	matrices[16] = double3x3(1, 2, 0, 2, 1, 0, 0, 0, 1);
+	MARS_CHECK(!(Cholesky<double, 3>::Solve(std::span<const double3x3>(matrices), std::span<const double3>(rhs), std::span<double3>(solutions))));
+	MARS_CHECK(solutions[16].x == 0.0 && solutions[16].y == 0.0 && solutions[16].z == 0.0);
+}
+
+int main()
+{
+	BatchedLUMatchesSingle();
+	BatchedCholeskyMatchesSingle();
+	return MARS_TEST_RESULT();
+}
@@ -0,0 +1,48 @@
+#include "mars.h"
+#include "TestCommon.h"
+#include <vector>
+
+using namespace mars;
+
+//Query idx appends idx + 1 copies of idx.
+static size_t AppendCopies(size_t idx, std::vector<uint32_t>& results)
+{
+	results.insert(results.end(), idx + 1, static_cast<uint32_t>(idx));
+	return idx + 1;
+}
+
+static void GatherBuildsCompressedRows()
+{
+	std::vector<size_t> offsets;
+	std::vector<uint32_t> values;
+	MARS_CHECK(Parallel::Gather(1000, 7, offsets, values, AppendCopies));
+	MARS_CHECK(offsets.size() == 1001);
+	MARS_CHECK(values.size() == 1000 * 1001 / 2);
+	bool rowsMatch = offsets[0] == 0;
+	for (size_t idx = 0; idx < 1000 && rowsMatch; idx++)
+	{
+		rowsMatch = offsets[idx + 1] - offsets[idx] == idx + 1;
+		for (size_t value = offsets[idx]; value < offsets[idx + 1]; value++)
+			rowsMatch = rowsMatch && values[value] == idx;
+	}
+	MARS_CHECK(rowsMatch);
+}
+
+//A total of 500 * 501 / 2 = 125250 values does not fit in 16-bit offsets; the prefix sum must not wrap and overrun values.
+static void GatherRejectsTotalsTheOffsetsCannotHold()
+{
+	std::vector<uint16_t> offsets(3, 1);
+	std::vector<uint32_t> values(3, 1);
+	MARS_CHECK(!Parallel::Gather(500, 64, offsets, values, AppendCopies));
+	MARS_CHECK(offsets.empty() && values.empty());
+
+	MARS_CHECK(Parallel::Gather(300, 64, offsets, values, AppendCopies));
+	MARS_CHECK(offsets.size() == 301 && offsets.back() == 300 * 301 / 2);
+}
+
+int main()
+{
+	GatherBuildsCompressedRows();
+	GatherRejectsTotalsTheOffsetsCannotHold();
+	return MARS_TEST_RESULT();
+}
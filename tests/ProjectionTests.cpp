@@ -0,0 +1,49 @@
+#include "mars.h"
+#include "TestCommon.h"
+
+using namespace mars;
+
+//Returns the NDC depth of the point at view-space depth z on the view axis.
+static double NdcDepth(const double4x4& projection, double z)
+{
+	const double4 clip = projection * double4(0, 0, z, 1);
+	return clip.z / clip.w;
+}
+
+static void RightHandedPerspectiveDepthRange()
+{
+	const double zNear = 0.5, zFar = 100.0;
+	const double4x4 projection = double4x4::Perspective(1.0, 1.5f, static_cast<float>(zNear), static_cast<float>(zFar), false, true);
+	//Before the fix, the depth scale C and offset E had the opposite sign for right-handed projections.
+	double4x4 previous = projection;
+	previous.k = -previous.k;
+	previous.l = -previous.l;
+
+	MARS_CHECK_NEAR(NdcDepth(previous, -zNear), 0.0, 1e-6);
+	MARS_CHECK_NEAR(NdcDepth(previous, -zFar), -1.0, 1e-6);
+	MARS_CHECK_NEAR(NdcDepth(projection, -zNear), 0.0, 1e-6);
+	MARS_CHECK_NEAR(NdcDepth(projection, -zFar), 1.0, 1e-6);
+
+	const double4x4 reversed = double4x4::Perspective(1.0, 1.5f, static_cast<float>(zNear), static_cast<float>(zFar), true, true);
+	MARS_CHECK_NEAR(NdcDepth(reversed, -zNear), 1.0, 1e-6);
+	MARS_CHECK_NEAR(NdcDepth(reversed, -zFar), 0.0, 1e-6);
+
+	const double4x4 offset = double4x4::PerspectiveOffset(-0.4, 0.6, -0.5, 0.3, static_cast<float>(zNear), static_cast<float>(zFar), false, true);
+	MARS_CHECK_NEAR(NdcDepth(offset, -zNear), 0.0, 1e-6);
+	MARS_CHECK_NEAR(NdcDepth(offset, -zFar), 1.0, 1e-6);
+}
+
+static void LeftHandedPerspectiveDepthRange()
+{
+	const double zNear = 0.5, zFar = 100.0;
+	const double4x4 projection = double4x4::Perspective(1.0, 1.5f, static_cast<float>(zNear), static_cast<float>(zFar));
+	MARS_CHECK_NEAR(NdcDepth(projection, zNear), 0.0, 1e-6);
+	MARS_CHECK_NEAR(NdcDepth(projection, zFar), 1.0, 1e-6);
+}
+
+int main()
+{
+	RightHandedPerspectiveDepthRange();
+	LeftHandedPerspectiveDepthRange();
+	return MARS_TEST_RESULT();
+}
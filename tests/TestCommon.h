@@ -0,0 +1,18 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+//Each test is a standalone program over the header-only library, e.g. g++ -std=c++20 -I../src ProjectionTests.cpp, returning non-zero on failure.
+namespace mars::test
+{
+	inline int& GetFailures()
+	{
+		static int failures = 0;
+		return failures;
+	}
+}
+
+#define MARS_CHECK(condition) do { if (!(condition)) { std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); mars::test::GetFailures()++; } } while (0)
+#define MARS_CHECK_NEAR(a, b, tolerance) MARS_CHECK(std::abs((a) - (b)) <= (tolerance))
+#define MARS_TEST_RESULT() (mars::test::GetFailures() == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
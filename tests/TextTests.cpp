@@ -0,0 +1,69 @@
+#include "mars.h"
+#include "TestCommon.h"
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace mars;
+
+static void Float3RoundTrip()
+{
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> distribution(-1e6f, 1e6f);
+	std::vector<float3> values(100), parsed(100);
+	for (float3& v : values)
+		v = float3(distribution(rng), distribution(rng), distribution(rng) * 1e-9f);
+
+	const std::string text = Text::ToString(std::span<const float3>(values));
+	MARS_CHECK(Text::FromString(text, std::span<float3>(parsed)) == values.size());
+	for (size_t idx = 0; idx < values.size(); idx++)
+		MARS_CHECK(parsed[idx].x == values[idx].x && parsed[idx].y == values[idx].y && parsed[idx].z == values[idx].z);
+}
+
+static bool Equal(const float4x4& a, const float4x4& b)
+{
+	const Matrix<float, 4, 4> ma(a), mb(b);
+	for (size_t idx = 0; idx < 16; idx++)
+		if (ma.data[idx] != mb.data[idx])
+			return false;
+	return true;
+}
+
+static void Float4x4RoundTrip()
+{
+	const float4x4 value(1, -2, 3.5f, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, -0.25f);
+	float4x4 parsed;
+	std::stringstream stream;
+	stream << value;
+	MARS_CHECK(Text::FromString(stream.str(), std::span<float4x4>(&parsed, 1)) == 1);
+	MARS_CHECK(Equal(parsed, value));
+
+	const std::string text = Text::ToString(std::span<const float4x4>(&value, 1));
+	parsed = float4x4();
+	MARS_CHECK(Text::FromString(text, std::span<float4x4>(&parsed, 1)) == 1);
+	MARS_CHECK(Equal(parsed, value));
+}
+
+//operator<< writes quaternions as "+1.000, +2.000i, +3.000j, +4.000k"; the units must not stop the parse.
+static void QuaternionRoundTrip()
+{
+	const Quaternion values[2] = { Quaternion(1, 2, 3, 4), Quaternion(-0.5, 0.25, -8, 16.125) };
+	Quaternion parsed[2];
+	std::stringstream stream;
+	stream << values[0] << values[1];
+	MARS_CHECK(Text::FromString(stream.str(), std::span<Quaternion>(parsed)) == 2);
+	for (size_t idx = 0; idx < 2; idx++)
+		MARS_CHECK(parsed[idx].s == values[idx].s && parsed[idx].i == values[idx].i && parsed[idx].j == values[idx].j && parsed[idx].k == values[idx].k);
+
+	const std::string text = Text::ToString(std::span<const Quaternion>(values));
+	MARS_CHECK(Text::FromString(text, std::span<Quaternion>(parsed)) == 2);
+	MARS_CHECK(parsed[1].s == -0.5 && parsed[1].k == 16.125);
+}
+
+int main()
+{
+	Float3RoundTrip();
+	Float4x4RoundTrip();
+	QuaternionRoundTrip();
+	return MARS_TEST_RESULT();
+}